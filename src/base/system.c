@@ -1,5 +1,9 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+	#define _GNU_SOURCE /* recvmmsg, sendmmsg */
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -1188,6 +1192,162 @@ int net_udp_recv(NETSOCKET sock, NETADDR *addr, void *data, int maxsize)
 	return -1; /* error */
 }
 
+#if defined(CONF_PLATFORM_LINUX)
+enum
+{
+	NET_MMSG_BATCH = 64
+};
+
+typedef union
+{
+	struct sockaddr sa;
+	struct sockaddr_in sa4;
+	struct sockaddr_in6 sa6;
+} NET_SOCKADDR_ANY;
+#endif
+
+int net_udp_send_batch(NETSOCKET sock, const NETDATAGRAM *datagrams, int num)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	struct mmsghdr msgs[NET_MMSG_BATCH];
+	struct iovec iovecs[NET_MMSG_BATCH];
+	NET_SOCKADDR_ANY addrs[NET_MMSG_BATCH];
+	int sent = 0;
+	int i = 0;
+
+	while(i < num)
+	{
+		int type = datagrams[i].addr.type;
+		int s = type == NETTYPE_IPV4 ? sock.ipv4sock : type == NETTYPE_IPV6 ? sock.ipv6sock : -1;
+		int count = 0;
+		int done = 0;
+		int k;
+
+		/* broadcasts and sockets we don't have take the slow path */
+		if(s < 0)
+		{
+			if(net_udp_send(sock, &datagrams[i].addr, datagrams[i].data, datagrams[i].size) >= 0)
+				sent++;
+			i++;
+			continue;
+		}
+
+		/* collect a run of packets of the same address family */
+		mem_zero(msgs, sizeof(msgs));
+		while(i+count < num && count < NET_MMSG_BATCH && (int)datagrams[i+count].addr.type == type)
+		{
+			const NETDATAGRAM *d = &datagrams[i+count];
+			if(type == NETTYPE_IPV4)
+			{
+				netaddr_to_sockaddr_in(&d->addr, &addrs[count].sa4);
+				msgs[count].msg_hdr.msg_namelen = sizeof(addrs[count].sa4);
+			}
+			else
+			{
+				netaddr_to_sockaddr_in6(&d->addr, &addrs[count].sa6);
+				msgs[count].msg_hdr.msg_namelen = sizeof(addrs[count].sa6);
+			}
+			iovecs[count].iov_base = d->data;
+			iovecs[count].iov_len = d->size;
+			msgs[count].msg_hdr.msg_name = &addrs[count].sa;
+			msgs[count].msg_hdr.msg_iov = &iovecs[count];
+			msgs[count].msg_hdr.msg_iovlen = 1;
+			count++;
+		}
+
+		while(done < count)
+		{
+			int n = sendmmsg(s, &msgs[done], count-done, 0);
+			if(n <= 0)
+				break;
+			done += n;
+		}
+		for(k = 0; k < done; k++)
+		{
+			network_stats.sent_bytes += datagrams[i+k].size;
+			network_stats.sent_packets++;
+		}
+		sent += done;
+
+		/* send what the batch didn't take one by one */
+		for(k = done; k < count; k++)
+		{
+			if(net_udp_send(sock, &datagrams[i+k].addr, datagrams[i+k].data, datagrams[i+k].size) >= 0)
+				sent++;
+		}
+		i += count;
+	}
+	return sent;
+#else
+	int sent = 0;
+	int i;
+	for(i = 0; i < num; i++)
+	{
+		if(net_udp_send(sock, &datagrams[i].addr, datagrams[i].data, datagrams[i].size) >= 0)
+			sent++;
+	}
+	return sent;
+#endif
+}
+
+int net_udp_recv_batch(NETSOCKET sock, NETDATAGRAM *datagrams, int num, int maxsize)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	struct mmsghdr msgs[NET_MMSG_BATCH];
+	struct iovec iovecs[NET_MMSG_BATCH];
+	NET_SOCKADDR_ANY addrs[NET_MMSG_BATCH];
+	int sockets[2];
+	int received = 0;
+	int s, i;
+
+	sockets[0] = sock.ipv4sock;
+	sockets[1] = sock.ipv6sock;
+	for(s = 0; s < 2 && received < num; s++)
+	{
+		int count = num-received;
+		int n;
+		if(sockets[s] < 0)
+			continue;
+		if(count > NET_MMSG_BATCH)
+			count = NET_MMSG_BATCH;
+
+		mem_zero(msgs, sizeof(msgs[0])*count);
+		for(i = 0; i < count; i++)
+		{
+			iovecs[i].iov_base = datagrams[received+i].data;
+			iovecs[i].iov_len = maxsize;
+			msgs[i].msg_hdr.msg_name = &addrs[i].sa;
+			msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+			msgs[i].msg_hdr.msg_iov = &iovecs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		n = recvmmsg(sockets[s], msgs, count, MSG_WAITFORONE, 0);
+		for(i = 0; i < n; i++)
+		{
+			sockaddr_to_netaddr(&addrs[i].sa, &datagrams[received+i].addr);
+			datagrams[received+i].size = msgs[i].msg_len;
+			network_stats.recv_bytes += msgs[i].msg_len;
+			network_stats.recv_packets++;
+		}
+		if(n > 0)
+			received += n;
+	}
+	return received;
+#else
+	int received = 0;
+	while(received < num)
+	{
+		int bytes = net_udp_recv(sock, &datagrams[received].addr, datagrams[received].data, maxsize);
+		if(bytes <= 0)
+			break;
+		datagrams[received].size = bytes;
+		received++;
+	}
+	return received;
+#endif
+}
+
 int net_udp_close(NETSOCKET sock)
 {
 	return priv_net_close_all_sockets(sock);
@@ -657,6 +657,46 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 */
 int net_udp_recv(NETSOCKET sock, NETADDR *addr, void *data, int maxsize);
 
+typedef struct
+{
+	NETADDR addr;
+	void *data;
+	int size;
+} NETDATAGRAM;
+
+/*
+	Function: net_udp_send_batch
+		Sends several packets over an UDP socket, using as few system
+		calls as the platform allows.
+
+	Parameters:
+		sock - Socket to use.
+		datagrams - Packets to send, each with its destination, data and size.
+		num - Number of packets.
+
+	Returns:
+		The number of packets that got sent.
+*/
+int net_udp_send_batch(NETSOCKET sock, const NETDATAGRAM *datagrams, int num);
+
+/*
+	Function: net_udp_recv_batch
+		Recives the packets that are waiting on an UDP socket, using as
+		few system calls as the platform allows.
+
+	Parameters:
+		sock - Socket to use.
+		datagrams - Packets to fill in. The data of each has to point to a
+			buffer of maxsize bytes, addr and size are set for every
+			packet recived.
+		num - Maximum number of packets to recive.
+		maxsize - Size of each data buffer.
+
+	Returns:
+		The number of packets recived, 0 if there were none.
+*/
+int net_udp_recv_batch(NETSOCKET sock, NETDATAGRAM *datagrams, int num, int maxsize);
+
 /*
 	Function: net_udp_close
 		Closes an UDP socket.
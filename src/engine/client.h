@@ -186,6 +186,9 @@ public:
 	virtual const char *NetVersionHashReal() const = 0;
 	virtual int ClientVersion() const = 0;
 
+	// times the OnRender of every component, for benchmarks
+	virtual void SetRenderProfiling(bool Enabled) = 0;
+	virtual int ReportRenderProfile(void (*pfnLine)(const char *pLine, void *pUser), void *pUser) const = 0;
 };
 
 extern IGameClient *CreateGameClient();
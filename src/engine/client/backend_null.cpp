@@ -0,0 +1,309 @@
+#include <base/detect.h>
+
+#include <base/tl/threading.h>
+
+#include "graphics_threaded.h"
+#include "backend_null.h"
+
+static unsigned HashData(const void *pData, unsigned Size, unsigned Hash)
+{
+	const unsigned char *pBytes = (const unsigned char *)pData;
+	for(unsigned i = 0; i < Size; i++)
+		Hash = (Hash^pBytes[i])*16777619u;
+	return Hash;
+}
+
+CGraphicsBackend_Null::CGraphicsBackend_Null(const char *pDumpFilename)
+{
+	mem_zero(m_aTextureMemory, sizeof(m_aTextureMemory));
+	m_TextureMemoryUsage = 0;
+	m_Width = 0;
+	m_Height = 0;
+	m_HasLastState = false;
+	str_copy(m_aDumpFilename, pDumpFilename ? pDumpFilename : "", sizeof(m_aDumpFilename));
+	m_DumpFile = 0;
+	ResetStats();
+}
+
+CGraphicsBackend_Null::~CGraphicsBackend_Null()
+{
+	if(m_DumpFile)
+		io_close(m_DumpFile);
+}
+
+int CGraphicsBackend_Null::Init(const char *pName, int *Screen, int *pWindowWidth, int *pWindowHeight, int *pScreenWidth, int *pScreenHeight, int FsaaSamples, int Flags, int *pDesktopWidth, int *pDesktopHeight)
+{
+	if(m_aDumpFilename[0])
+	{
+		m_DumpFile = io_open(m_aDumpFilename, IOFLAG_WRITE);
+		if(!m_DumpFile)
+		{
+			dbg_msg("gfx", "failed to open command dump '%s'", m_aDumpFilename);
+			return -1;
+		}
+	}
+
+	// there is no desktop, the window gets the size it asks for
+	if(*pWindowWidth == 0 || *pWindowHeight == 0)
+	{
+		*pWindowWidth = 1280;
+		*pWindowHeight = 720;
+	}
+	*Screen = 0;
+	*pScreenWidth = m_Width = *pWindowWidth;
+	*pScreenHeight = m_Height = *pWindowHeight;
+	*pDesktopWidth = m_Width;
+	*pDesktopHeight = m_Height;
+	return 0;
+}
+
+int CGraphicsBackend_Null::Shutdown()
+{
+	if(m_DumpFile)
+	{
+		io_close(m_DumpFile);
+		m_DumpFile = 0;
+	}
+	return 0;
+}
+
+bool CGraphicsBackend_Null::GetDesktopResolution(int Index, int *pDesktopWidth, int *pDesktopHeight)
+{
+	*pDesktopWidth = m_Width;
+	*pDesktopHeight = m_Height;
+	return Index == 0;
+}
+
+void CGraphicsBackend_Null::ResetStats()
+{
+	mem_zero(&m_Stats, sizeof(m_Stats));
+	m_HasLastState = false;
+}
+
+const char *CGraphicsBackend_Null::CommandName(unsigned Cmd)
+{
+	switch(Cmd)
+	{
+	case CCommandBuffer::CMD_NOP: return "nop";
+	case CCommandBuffer::CMD_RUNBUFFER: return "runbuffer";
+	case CCommandBuffer::CMD_SIGNAL: return "signal";
+	case CCommandBuffer::CMD_TEXTURE_CREATE: return "texture_create";
+	case CCommandBuffer::CMD_TEXTURE_DESTROY: return "texture_destroy";
+	case CCommandBuffer::CMD_TEXTURE_UPDATE: return "texture_update";
+	case CCommandBuffer::CMD_BUFFER_DESTROY: return "buffer_destroy";
+	case CCommandBuffer::CMD_CLEAR: return "clear";
+	case CCommandBuffer::CMD_RENDER: return "render";
+	case CCommandBuffer::CMD_RENDER_BUFFER: return "render_buffer";
+	case CCommandBuffer::CMD_SWAP: return "swap";
+	case CCommandBuffer::CMD_VSYNC: return "vsync";
+	case CCommandBuffer::CMD_SCREENSHOT: return "screenshot";
+	case CCommandBuffer::CMD_VIDEOMODES: return "videomodes";
+	}
+	return "unknown";
+}
+
+void CGraphicsBackend_Null::CountState(const CCommandBuffer::SState &State)
+{
+	if(m_HasLastState)
+	{
+		if(!State.Equals(m_LastState))
+			m_Stats.m_NumStateChanges++;
+		if(State.m_Texture != m_LastState.m_Texture || State.m_TextureArrayIndex != m_LastState.m_TextureArrayIndex)
+			m_Stats.m_NumTextureChanges++;
+	}
+	m_LastState = State;
+	m_HasLastState = true;
+}
+
+void CGraphicsBackend_Null::Dump(const CCommandBuffer::SCommand *pBaseCommand)
+{
+	char aLine[512];
+	const char *pName = CommandName(pBaseCommand->m_Cmd);
+	const CCommandBuffer::SState *pState = 0;
+	unsigned Hash = 2166136261u;
+
+	switch(pBaseCommand->m_Cmd)
+	{
+	case CCommandBuffer::CMD_TEXTURE_CREATE:
+		{
+			const CCommandBuffer::SCommand_Texture_Create *pCommand = static_cast<const CCommandBuffer::SCommand_Texture_Create *>(pBaseCommand);
+			str_format(aLine, sizeof(aLine), "%s slot=%d size=%dx%d format=%d store=%d flags=%d data=%08x\n", pName, pCommand->m_Slot, pCommand->m_Width, pCommand->m_Height,
+				pCommand->m_Format, pCommand->m_StoreFormat, pCommand->m_Flags, HashData(pCommand->m_pData, pCommand->m_Width*pCommand->m_Height*pCommand->m_PixelSize, Hash));
+		}
+		break;
+	case CCommandBuffer::CMD_TEXTURE_UPDATE:
+		{
+			const CCommandBuffer::SCommand_Texture_Update *pCommand = static_cast<const CCommandBuffer::SCommand_Texture_Update *>(pBaseCommand);
+			str_format(aLine, sizeof(aLine), "%s slot=%d rect=%d,%d,%d,%d format=%d\n", pName, pCommand->m_Slot,
+				pCommand->m_X, pCommand->m_Y, pCommand->m_Width, pCommand->m_Height, pCommand->m_Format);
+		}
+		break;
+	case CCommandBuffer::CMD_TEXTURE_DESTROY:
+		str_format(aLine, sizeof(aLine), "%s slot=%d\n", pName, static_cast<const CCommandBuffer::SCommand_Texture_Destroy *>(pBaseCommand)->m_Slot);
+		break;
+	case CCommandBuffer::CMD_CLEAR:
+		{
+			const CCommandBuffer::SColor &Color = static_cast<const CCommandBuffer::SCommand_Clear *>(pBaseCommand)->m_Color;
+			str_format(aLine, sizeof(aLine), "%s color=%.3f,%.3f,%.3f\n", pName, Color.r, Color.g, Color.b);
+		}
+		break;
+	case CCommandBuffer::CMD_RENDER:
+		{
+			const CCommandBuffer::SCommand_Render *pCommand = static_cast<const CCommandBuffer::SCommand_Render *>(pBaseCommand);
+			int NumVertices = pCommand->m_PrimCount*(pCommand->m_PrimType == CCommandBuffer::PRIMTYPE_QUADS ? 4 : 2);
+			pState = &pCommand->m_State;
+			str_format(aLine, sizeof(aLine), "%s %s prims=%u vertices=%08x", pName, pCommand->m_PrimType == CCommandBuffer::PRIMTYPE_QUADS ? "quads" : "lines",
+				pCommand->m_PrimCount, HashData(pCommand->m_pVertices, NumVertices*sizeof(CCommandBuffer::SVertex), Hash));
+		}
+		break;
+	case CCommandBuffer::CMD_RENDER_BUFFER:
+		{
+			const CCommandBuffer::SCommand_RenderBuffer *pCommand = static_cast<const CCommandBuffer::SCommand_RenderBuffer *>(pBaseCommand);
+			pState = &pCommand->m_State;
+			for(unsigned i = 0; i < pCommand->m_NumRanges; i++)
+				Hash = HashData(pCommand->m_pVertices+pCommand->m_pRanges[i].m_FirstVertex, pCommand->m_pRanges[i].m_NumVertices*sizeof(CCommandBuffer::SBufferVertex), Hash);
+			str_format(aLine, sizeof(aLine), "%s ranges=%u color=%.3f,%.3f,%.3f,%.3f vertices=%08x", pName, pCommand->m_NumRanges,
+				pCommand->m_Color.r, pCommand->m_Color.g, pCommand->m_Color.b, pCommand->m_Color.a, Hash);
+		}
+		break;
+	case CCommandBuffer::CMD_SWAP:
+		str_format(aLine, sizeof(aLine), "%s frame=%lld\n", pName, m_Stats.m_NumFrames);
+		break;
+	default:
+		str_format(aLine, sizeof(aLine), "%s\n", pName);
+	}
+	io_write(m_DumpFile, aLine, str_length(aLine));
+
+	if(pState)
+	{
+		str_format(aLine, sizeof(aLine), " texture=%d:%d dim=%d blend=%d wrap=%d,%d screen=%.2f,%.2f,%.2f,%.2f clip=%d",
+			pState->m_Texture, pState->m_TextureArrayIndex, pState->m_Dimension, pState->m_BlendMode, pState->m_WrapModeU, pState->m_WrapModeV,
+			pState->m_ScreenTL.x, pState->m_ScreenTL.y, pState->m_ScreenBR.x, pState->m_ScreenBR.y, pState->m_ClipEnable);
+		io_write(m_DumpFile, aLine, str_length(aLine));
+		if(pState->m_ClipEnable)
+		{
+			str_format(aLine, sizeof(aLine), ",%d,%d,%d,%d", pState->m_ClipX, pState->m_ClipY, pState->m_ClipW, pState->m_ClipH);
+			io_write(m_DumpFile, aLine, str_length(aLine));
+		}
+		io_write_newline(m_DumpFile);
+	}
+}
+
+bool CGraphicsBackend_Null::RunCommand(const CCommandBuffer::SCommand *pBaseCommand)
+{
+	switch(pBaseCommand->m_Cmd)
+	{
+	case CCommandBuffer::CMD_NOP:
+		break;
+	case CCommandBuffer::CMD_SIGNAL:
+		static_cast<const CCommandBuffer::SCommand_Signal *>(pBaseCommand)->m_pSemaphore->signal();
+		break;
+	case CCommandBuffer::CMD_BUFFER_DESTROY:
+		mem_free(static_cast<const CCommandBuffer::SCommand_Buffer_Destroy *>(pBaseCommand)->m_pVertices);
+		break;
+	case CCommandBuffer::CMD_TEXTURE_CREATE:
+		{
+			const CCommandBuffer::SCommand_Texture_Create *pCommand = static_cast<const CCommandBuffer::SCommand_Texture_Create *>(pBaseCommand);
+			int MemSize = pCommand->m_Width*pCommand->m_Height*pCommand->m_PixelSize;
+			m_TextureMemoryUsage += MemSize-m_aTextureMemory[pCommand->m_Slot];
+			m_aTextureMemory[pCommand->m_Slot] = MemSize;
+			m_Stats.m_TextureUploadBytes += MemSize;
+			mem_free(pCommand->m_pData);
+		}
+		break;
+	case CCommandBuffer::CMD_TEXTURE_UPDATE:
+		{
+			const CCommandBuffer::SCommand_Texture_Update *pCommand = static_cast<const CCommandBuffer::SCommand_Texture_Update *>(pBaseCommand);
+			m_Stats.m_TextureUploadBytes += pCommand->m_Width*pCommand->m_Height*(pCommand->m_Format == CCommandBuffer::TEXFORMAT_ALPHA ? 1 : pCommand->m_Format == CCommandBuffer::TEXFORMAT_RGB ? 3 : 4);
+			mem_free(pCommand->m_pData);
+		}
+		break;
+	case CCommandBuffer::CMD_TEXTURE_DESTROY:
+		{
+			int Slot = static_cast<const CCommandBuffer::SCommand_Texture_Destroy *>(pBaseCommand)->m_Slot;
+			m_TextureMemoryUsage -= m_aTextureMemory[Slot];
+			m_aTextureMemory[Slot] = 0;
+		}
+		break;
+	case CCommandBuffer::CMD_RENDER:
+		{
+			const CCommandBuffer::SCommand_Render *pCommand = static_cast<const CCommandBuffer::SCommand_Render *>(pBaseCommand);
+			CountState(pCommand->m_State);
+			m_Stats.m_NumDrawCalls++;
+			m_Stats.m_NumVertices += pCommand->m_PrimCount*(pCommand->m_PrimType == CCommandBuffer::PRIMTYPE_QUADS ? 4 : 2);
+		}
+		break;
+	case CCommandBuffer::CMD_RENDER_BUFFER:
+		{
+			const CCommandBuffer::SCommand_RenderBuffer *pCommand = static_cast<const CCommandBuffer::SCommand_RenderBuffer *>(pBaseCommand);
+			CountState(pCommand->m_State);
+			m_Stats.m_NumDrawCalls += pCommand->m_NumRanges;
+			for(unsigned i = 0; i < pCommand->m_NumRanges; i++)
+				m_Stats.m_NumVertices += pCommand->m_pRanges[i].m_NumVertices;
+		}
+		break;
+	case CCommandBuffer::CMD_SWAP:
+		m_Stats.m_NumFrames++;
+		break;
+	case CCommandBuffer::CMD_VSYNC:
+		*static_cast<const CCommandBuffer::SCommand_VSync *>(pBaseCommand)->m_pRetOk = true;
+		break;
+	case CCommandBuffer::CMD_SCREENSHOT:
+		{
+			// there is nothing to read back, the shot comes out black
+			const CCommandBuffer::SCommand_Screenshot *pCommand = static_cast<const CCommandBuffer::SCommand_Screenshot *>(pBaseCommand);
+			int w = pCommand->m_W == -1 ? m_Width : pCommand->m_W;
+			int h = pCommand->m_H == -1 ? m_Height : pCommand->m_H;
+			pCommand->m_pImage->m_Width = w;
+			pCommand->m_pImage->m_Height = h;
+			pCommand->m_pImage->m_Format = CImageInfo::FORMAT_RGB;
+			pCommand->m_pImage->m_pData = mem_alloc(w*h*3, 1);
+			mem_zero(pCommand->m_pImage->m_pData, w*h*3);
+		}
+		break;
+	case CCommandBuffer::CMD_VIDEOMODES:
+		{
+			const CCommandBuffer::SCommand_VideoModes *pCommand = static_cast<const CCommandBuffer::SCommand_VideoModes *>(pBaseCommand);
+			*pCommand->m_pNumModes = 0;
+			if(pCommand->m_MaxModes > 0)
+			{
+				pCommand->m_pModes[0].m_Width = m_Width;
+				pCommand->m_pModes[0].m_Height = m_Height;
+				pCommand->m_pModes[0].m_Red = 8;
+				pCommand->m_pModes[0].m_Green = 8;
+				pCommand->m_pModes[0].m_Blue = 8;
+				*pCommand->m_pNumModes = 1;
+			}
+		}
+		break;
+	case CCommandBuffer::CMD_CLEAR:
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+void CGraphicsBackend_Null::RunBuffer(CCommandBuffer *pBuffer)
+{
+	unsigned CmdIndex = 0;
+	while(1)
+	{
+		const CCommandBuffer::SCommand *pBaseCommand = pBuffer->GetCommand(&CmdIndex);
+		if(pBaseCommand == 0x0)
+			break;
+
+		if(pBaseCommand->m_Cmd < NUM_CORE_COMMANDS)
+			m_Stats.m_aNumCommands[pBaseCommand->m_Cmd]++;
+
+		// the dump has to go first, the data of the texture commands gets freed by running them
+		if(m_DumpFile)
+			Dump(pBaseCommand);
+
+		if(RunCommand(pBaseCommand))
+			continue;
+
+		dbg_msg("graphics", "unknown command %d", pBaseCommand->m_Cmd);
+	}
+}
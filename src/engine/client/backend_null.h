@@ -0,0 +1,74 @@
+#pragma once
+
+#include "graphics_threaded.h"
+
+// graphics backend without a window or a context, runs the command buffers right away and
+// only counts what they hold. can write every command to a file, to diff the rendering of two builds
+class CGraphicsBackend_Null : public IGraphicsBackend
+{
+public:
+	enum
+	{
+		NUM_CORE_COMMANDS = CCommandBuffer::CMD_VIDEOMODES+1,
+	};
+
+	struct CStats
+	{
+		int64 m_NumFrames;
+		int64 m_aNumCommands[NUM_CORE_COMMANDS];
+		int64 m_NumDrawCalls; // one per render command, one per range of a buffer render
+		int64 m_NumVertices;
+		int64 m_NumStateChanges; // render commands with another state than the one before
+		int64 m_NumTextureChanges;
+		int64 m_TextureUploadBytes;
+	};
+
+	CGraphicsBackend_Null(const char *pDumpFilename);
+	virtual ~CGraphicsBackend_Null();
+
+	virtual int Init(const char *pName, int *Screen, int *pWindowWidth, int *pWindowHeight, int *pScreenWidth, int *pScreenHeight, int FsaaSamples, int Flags, int *pDesktopWidth, int *pDesktopHeight);
+	virtual int Shutdown();
+
+	virtual int MemoryUsage() const { return m_TextureMemoryUsage; }
+	virtual int GetTextureArraySize() const { return 1; }
+
+	virtual int GetNumScreens() const { return 1; }
+
+	virtual void Minimize() {}
+	virtual void Maximize() {}
+	virtual bool Fullscreen(bool State) { return false; }
+	virtual void SetWindowBordered(bool State) {}
+	virtual bool SetWindowScreen(int Index) { return Index == 0; }
+	virtual bool GetDesktopResolution(int Index, int *pDesktopWidth, int *pDesktopHeight);
+	virtual int GetWindowScreen() { return 0; }
+	virtual int WindowActive() { return 1; }
+	virtual int WindowOpen() { return 1; }
+
+	virtual void RunBuffer(CCommandBuffer *pBuffer);
+	virtual int NumQueued() const { return 0; }
+	virtual void WaitForQueue(int MaxQueued) {}
+	virtual bool IsIdle() const { return true; }
+	virtual void WaitForIdle() {}
+
+	const CStats *Stats() const { return &m_Stats; }
+	void ResetStats();
+
+	static const char *CommandName(unsigned Cmd);
+
+private:
+	CStats m_Stats;
+	int m_aTextureMemory[CCommandBuffer::MAX_TEXTURES];
+	int m_TextureMemoryUsage;
+	int m_Width;
+	int m_Height;
+
+	CCommandBuffer::SState m_LastState;
+	bool m_HasLastState;
+
+	char m_aDumpFilename[512];
+	IOHANDLE m_DumpFile;
+
+	void CountState(const CCommandBuffer::SState &State);
+	void Dump(const CCommandBuffer::SCommand *pBaseCommand);
+	bool RunCommand(const CCommandBuffer::SCommand *pBaseCommand);
+};
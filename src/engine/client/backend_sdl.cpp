@@ -34,14 +34,14 @@ void CGraphicsBackend_Threaded::ThreadFunc(void *pUser)
 	while(!pThis->m_Shutdown)
 	{
 		pThis->m_Activity.wait();
-		if(pThis->m_pBuffer)
+		while(pThis->m_QueueStart != pThis->m_QueueEnd)
 		{
 			#ifdef CONF_PLATFORM_MACOSX
 				CAutoreleasePool AutoreleasePool;
 			#endif
-			pThis->m_pProcessor->RunBuffer(pThis->m_pBuffer);
+			pThis->m_pProcessor->RunBuffer(pThis->m_apQueue[pThis->m_QueueStart%MAX_QUEUED]);
 			sync_barrier();
-			pThis->m_pBuffer = 0x0;
+			pThis->m_QueueStart++;
 			pThis->m_BufferDone.signal();
 		}
 	}
@@ -49,7 +49,8 @@ void CGraphicsBackend_Threaded::ThreadFunc(void *pUser)
 
 CGraphicsBackend_Threaded::CGraphicsBackend_Threaded()
 {
-	m_pBuffer = 0x0;
+	m_QueueStart = 0;
+	m_QueueEnd = 0;
 	m_pProcessor = 0x0;
 	m_pThread = 0x0;
 }
@@ -72,20 +73,32 @@ void CGraphicsBackend_Threaded::StopProcessor()
 
 void CGraphicsBackend_Threaded::RunBuffer(CCommandBuffer *pBuffer)
 {
-	WaitForIdle();
-	m_pBuffer = pBuffer;
+	WaitForQueue(MAX_QUEUED-1);
+	m_apQueue[m_QueueEnd%MAX_QUEUED] = pBuffer;
+	sync_barrier();
+	m_QueueEnd++;
 	m_Activity.signal();
 }
 
+int CGraphicsBackend_Threaded::NumQueued() const
+{
+	return m_QueueEnd-m_QueueStart;
+}
+
+void CGraphicsBackend_Threaded::WaitForQueue(int MaxQueued)
+{
+	while(NumQueued() > MaxQueued)
+		m_BufferDone.wait();
+}
+
 bool CGraphicsBackend_Threaded::IsIdle() const
 {
-	return m_pBuffer == 0x0;
+	return NumQueued() == 0;
 }
 
 void CGraphicsBackend_Threaded::WaitForIdle()
 {
-	while(m_pBuffer != 0x0)
-		m_BufferDone.wait();
+	WaitForQueue(0);
 }
 
 
@@ -96,12 +109,18 @@ void CCommandProcessorFragment_General::Cmd_Signal(const CCommandBuffer::SComman
 	pCommand->m_pSemaphore->signal();
 }
 
+void CCommandProcessorFragment_General::Cmd_Buffer_Destroy(const CCommandBuffer::SCommand_Buffer_Destroy *pCommand)
+{
+	mem_free(pCommand->m_pVertices);
+}
+
 bool CCommandProcessorFragment_General::RunCommand(const CCommandBuffer::SCommand * pBaseCommand)
 {
 	switch(pBaseCommand->m_Cmd)
 	{
 	case CCommandBuffer::CMD_NOP: break;
 	case CCommandBuffer::CMD_SIGNAL: Cmd_Signal(static_cast<const CCommandBuffer::SCommand_Signal *>(pBaseCommand)); break;
+	case CCommandBuffer::CMD_BUFFER_DESTROY: Cmd_Buffer_Destroy(static_cast<const CCommandBuffer::SCommand_Buffer_Destroy *>(pBaseCommand)); break;
 	default: return false;
 	}
 
@@ -465,6 +484,21 @@ void CCommandProcessorFragment_OpenGL::Cmd_Render(const CCommandBuffer::SCommand
 	};
 }
 
+void CCommandProcessorFragment_OpenGL::Cmd_RenderBuffer(const CCommandBuffer::SCommand_RenderBuffer *pCommand)
+{
+	SetState(pCommand->m_State);
+
+	glVertexPointer(3, GL_FLOAT, sizeof(CCommandBuffer::SBufferVertex), (char*)pCommand->m_pVertices);
+	glTexCoordPointer(3, GL_FLOAT, sizeof(CCommandBuffer::SBufferVertex), (char*)pCommand->m_pVertices + sizeof(float)*3);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glColor4f(pCommand->m_Color.r, pCommand->m_Color.g, pCommand->m_Color.b, pCommand->m_Color.a);
+
+	for(unsigned i = 0; i < pCommand->m_NumRanges; i++)
+		glDrawArrays(GL_QUADS, pCommand->m_pRanges[i].m_FirstVertex, pCommand->m_pRanges[i].m_NumVertices);
+}
+
 void CCommandProcessorFragment_OpenGL::Cmd_Screenshot(const CCommandBuffer::SCommand_Screenshot *pCommand)
 {
 	// fetch image data
@@ -518,6 +552,7 @@ bool CCommandProcessorFragment_OpenGL::RunCommand(const CCommandBuffer::SCommand
 	case CCommandBuffer::CMD_TEXTURE_UPDATE: Cmd_Texture_Update(static_cast<const CCommandBuffer::SCommand_Texture_Update *>(pBaseCommand)); break;
 	case CCommandBuffer::CMD_CLEAR: Cmd_Clear(static_cast<const CCommandBuffer::SCommand_Clear *>(pBaseCommand)); break;
 	case CCommandBuffer::CMD_RENDER: Cmd_Render(static_cast<const CCommandBuffer::SCommand_Render *>(pBaseCommand)); break;
+	case CCommandBuffer::CMD_RENDER_BUFFER: Cmd_RenderBuffer(static_cast<const CCommandBuffer::SCommand_RenderBuffer *>(pBaseCommand)); break;
 	case CCommandBuffer::CMD_SCREENSHOT: Cmd_Screenshot(static_cast<const CCommandBuffer::SCommand_Screenshot *>(pBaseCommand)); break;
 	default: return false;
 	}
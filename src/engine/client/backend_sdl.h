@@ -53,6 +53,8 @@ public:
 	CGraphicsBackend_Threaded();
 
 	virtual void RunBuffer(CCommandBuffer *pBuffer);
+	virtual int NumQueued() const;
+	virtual void WaitForQueue(int MaxQueued);
 	virtual bool IsIdle() const;
 	virtual void WaitForIdle();
 
@@ -61,8 +63,13 @@ protected:
 	void StopProcessor();
 
 private:
+	// buffers wait here until the render thread gets to them. only the main
+	// thread moves the end and only the render thread the start
+	CCommandBuffer *m_apQueue[MAX_QUEUED];
+	volatile unsigned m_QueueStart;
+	volatile unsigned m_QueueEnd;
+
 	ICommandProcessor *m_pProcessor;
-	CCommandBuffer * volatile m_pBuffer;
 	volatile bool m_Shutdown;
 	semaphore m_Activity;
 	semaphore m_BufferDone;
@@ -76,6 +83,7 @@ class CCommandProcessorFragment_General
 {
 	void Cmd_Nop();
 	void Cmd_Signal(const CCommandBuffer::SCommand_Signal *pCommand);
+	void Cmd_Buffer_Destroy(const CCommandBuffer::SCommand_Buffer_Destroy *pCommand);
 public:
 	bool RunCommand(const CCommandBuffer::SCommand * pBaseCommand);
 };
@@ -133,6 +141,7 @@ private:
 	void Cmd_Texture_Create(const CCommandBuffer::SCommand_Texture_Create *pCommand);
 	void Cmd_Clear(const CCommandBuffer::SCommand_Clear *pCommand);
 	void Cmd_Render(const CCommandBuffer::SCommand_Render *pCommand);
+	void Cmd_RenderBuffer(const CCommandBuffer::SCommand_RenderBuffer *pCommand);
 	void Cmd_Screenshot(const CCommandBuffer::SCommand_Screenshot *pCommand);
 
 public:
@@ -40,6 +40,7 @@
 #include <mastersrv/mastersrv.h>
 #include <versionsrv/versionsrv.h>
 
+#include "backend_null.h"
 #include "contacts.h"
 #include "serverbrowser.h"
 #include "client.h"
@@ -242,6 +243,7 @@ void CSmoothTime::Update(CGraph *pGraph, int64 Target, int TimeLeft, int AdjustD
 CClient::CClient() : m_DemoPlayer(&m_SnapshotDelta), m_DemoRecorder(&m_SnapshotDelta)
 {
 	m_pEditor = 0;
+	m_NumOwnInterfaces = 0;
 	m_pInput = 0;
 	m_pGraphics = 0;
 	m_pSound = 0;
@@ -424,18 +426,25 @@ const char *CClient::LatestVersion() const
 	return m_aVersionStr;
 }
 
-// TODO: OPT: do this alot smarter!
 const int *CClient::GetInput(int Tick) const
 {
-	int Best = -1;
-	for(int i = 0; i < 200; i++)
+	// the inputs are stored in the order of their ticks, so the newest one
+	// that is not ahead of the tick is the one that was active then
+	for(int i = 1; i <= 200; i++)
 	{
-		if(m_aInputs[i].m_Tick <= Tick && (Best == -1 || m_aInputs[Best].m_Tick < m_aInputs[i].m_Tick))
-			Best = i;
+		int Index = (m_CurrentInput-i+200)%200;
+		if(m_aInputs[Index].m_Tick == -1)
+			break;
+		if(m_aInputs[Index].m_Tick <= Tick)
+			return (const int *)m_aInputs[Index].m_aData;
 	}
 
-	if(Best != -1)
-		return (const int *)m_aInputs[Best].m_aData;
+	// no input sent for that tick yet
+	for(int i = 0; i < 200; i++)
+	{
+		if(m_aInputs[i].m_Tick == -1 && Tick >= -1)
+			return (const int *)m_aInputs[i].m_aData;
+	}
 	return 0;
 }
 
@@ -715,6 +724,11 @@ void CClient::DebugRender()
 	str_format(aBuffer, sizeof(aBuffer), "pred: %d ms",
 		(int)((m_PredictedTime.Get(Now)-m_GameTime.Get(Now))*1000/(float)time_freq()));
 	Graphics()->QuadsText(2, 70, 16, aBuffer);
+
+	int NumDraws, NumRenderCommands;
+	Graphics()->GetDrawStats(&NumDraws, &NumRenderCommands);
+	str_format(aBuffer, sizeof(aBuffer), "draws: %d render commands: %d", NumDraws, NumRenderCommands);
+	Graphics()->QuadsText(2, 82, 16, aBuffer);
 	Graphics()->QuadsEnd();
 
 	// render graphs
@@ -1614,25 +1628,30 @@ void DemoPlayer()->SetPause(int paused)
 		demorec_playback_unpause();
 }*/
 
+void CClient::UpdateDemoTimers()
+{
+	if(m_DemoPlayer.IsPlaying())
+	{
+		// update timers
+		const CDemoPlayer::CPlaybackInfo *pInfo = m_DemoPlayer.Info();
+		m_CurGameTick = pInfo->m_Info.m_CurrentTick;
+		m_PrevGameTick = pInfo->m_PreviousTick;
+		m_GameIntraTick = pInfo->m_IntraTick;
+		m_GameTickTime = pInfo->m_TickTime;
+	}
+	else
+	{
+		// disconnect on error
+		Disconnect();
+	}
+}
+
 void CClient::Update()
 {
 	if(State() == IClient::STATE_DEMOPLAYBACK)
 	{
 		m_DemoPlayer.Update();
-		if(m_DemoPlayer.IsPlaying())
-		{
-			// update timers
-			const CDemoPlayer::CPlaybackInfo *pInfo = m_DemoPlayer.Info();
-			m_CurGameTick = pInfo->m_Info.m_CurrentTick;
-			m_PrevGameTick = pInfo->m_PreviousTick;
-			m_GameIntraTick = pInfo->m_IntraTick;
-			m_GameTickTime = pInfo->m_TickTime;
-		}
-		else
-		{
-			// disconnect on error
-			Disconnect();
-		}
+		UpdateDemoTimers();
 	}
 	else if(State() == IClient::STATE_ONLINE && m_RecivedSnapshots >= 3)
 	{
@@ -1784,6 +1803,70 @@ void CClient::VersionUpdate()
 	}
 }
 
+bool CClient::CreateInterfaces(IKernel *pKernel, int argc, const char **argv, bool Editor) // ignore_convention
+{
+	pKernel->RegisterInterface(this);
+	RegisterInterfaces();
+
+	// create the components
+	int FlagMask = CFGFLAG_CLIENT;
+	IEngine *pEngine = CreateEngine("Teeworlds");
+	IConsole *pConsole = CreateConsole(FlagMask);
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_CLIENT, argc, argv); // ignore_convention
+	IConfig *pConfig = CreateConfig();
+	IEngineSound *pEngineSound = CreateEngineSound();
+	IEngineInput *pEngineInput = CreateEngineInput();
+	IEngineTextRender *pEngineTextRender = CreateEngineTextRender();
+	IEngineMap *pEngineMap = CreateEngineMap();
+	IEngineMasterServer *pEngineMasterServer = CreateEngineMasterServer();
+
+	m_NumOwnInterfaces = 0;
+	m_apOwnInterfaces[m_NumOwnInterfaces++] = pEngine;
+	m_apOwnInterfaces[m_NumOwnInterfaces++] = pConsole;
+	m_apOwnInterfaces[m_NumOwnInterfaces++] = pStorage;
+	m_apOwnInterfaces[m_NumOwnInterfaces++] = pConfig;
+	m_apOwnInterfaces[m_NumOwnInterfaces++] = pEngineSound;
+	m_apOwnInterfaces[m_NumOwnInterfaces++] = pEngineInput;
+	m_apOwnInterfaces[m_NumOwnInterfaces++] = pEngineTextRender;
+	m_apOwnInterfaces[m_NumOwnInterfaces++] = pEngineMap;
+	m_apOwnInterfaces[m_NumOwnInterfaces++] = pEngineMasterServer;
+
+	bool RegisterFail = false;
+
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(pEngine);
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConsole);
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConfig);
+
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineSound*>(pEngineSound)); // register as both
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<ISound*>(pEngineSound));
+
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineInput*>(pEngineInput)); // register as both
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IInput*>(pEngineInput));
+
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineTextRender*>(pEngineTextRender)); // register as both
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<ITextRender*>(pEngineTextRender));
+
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMap*>(pEngineMap)); // register as both
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMap*>(pEngineMap));
+
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMasterServer*>(pEngineMasterServer)); // register as both
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMasterServer*>(pEngineMasterServer));
+
+	if(Editor)
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(CreateEditor());
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(CreateGameClient());
+	RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
+
+	return !RegisterFail;
+}
+
+void CClient::DestroyInterfaces()
+{
+	for(int i = 0; i < m_NumOwnInterfaces; i++)
+		delete m_apOwnInterfaces[i];
+	m_NumOwnInterfaces = 0;
+}
+
 void CClient::RegisterInterfaces()
 {
 	Kernel()->RegisterInterface(static_cast<IDemoRecorder*>(&m_DemoRecorder));
@@ -2176,6 +2259,110 @@ void CClient::Run()
 	}
 }
 
+static void BenchmarkLineCB(const char *pLine, void *pUser)
+{
+	dbg_msg("bench", "%s", pLine);
+}
+
+int CClient::RunBenchmark(const char *pDemo, int Fps, const char *pDumpFilename)
+{
+	m_LocalStartTime = time_get();
+	m_SnapshotParts = 0;
+	m_MenuStartTime = time_get();
+
+	// init graphics, the null backend takes every frame without rendering it
+	CGraphicsBackend_Null *pBackend = new CGraphicsBackend_Null(pDumpFilename);
+	{
+		m_pGraphics = CreateEngineGraphicsThreaded(pBackend);
+
+		bool RegisterFail = false;
+		RegisterFail = RegisterFail || !Kernel()->RegisterInterface(static_cast<IEngineGraphics*>(m_pGraphics)); // register graphics as both
+		RegisterFail = RegisterFail || !Kernel()->RegisterInterface(static_cast<IGraphics*>(m_pGraphics));
+
+		if(RegisterFail || m_pGraphics->Init() != 0)
+		{
+			dbg_msg("bench", "couldn't init graphics");
+			return -1;
+		}
+	}
+
+	// no sound, no input and no sockets
+	g_Config.m_SndInit = 0;
+	m_SoundInitFailed = Sound()->Init() != 0;
+	Kernel()->RequestInterface<IEngineTextRender>()->Init();
+
+	if(!LoadData())
+		return -1;
+
+	GameClient()->OnInit();
+	m_pConsole->StoreCommands(false);
+
+	const char *pError = DemoPlayer_Play(pDemo, IStorage::TYPE_ALL);
+	if(pError)
+	{
+		dbg_msg("bench", "couldn't play demo '%s': %s", pDemo, pError);
+		GameClient()->OnShutdown();
+		m_pGraphics->Shutdown();
+		m_pSound->Shutdown();
+		return -1;
+	}
+
+	// the loading is done, only the frames count
+	GameClient()->SetRenderProfiling(true);
+	pBackend->ResetStats();
+
+	int64 FrameTime = time_freq()/Fps;
+	int64 StartTime = time_get();
+	int64 RenderTime = 0;
+	int NumFrames = 0;
+	while(State() == IClient::STATE_DEMOPLAYBACK && !m_DemoPlayer.BaseInfo()->m_Paused)
+	{
+		m_DemoPlayer.Advance(FrameTime);
+		UpdateDemoTimers();
+		if(State() != IClient::STATE_DEMOPLAYBACK)
+			break;
+		GameClient()->OnUpdate();
+
+		// the time of the frames doesn't depend on how long they take
+		NumFrames++;
+		m_RenderFrames++;
+		m_RenderFrameTime = 1.0f/Fps;
+		m_LocalTime = NumFrames/(float)Fps;
+
+		int64 RenderStart = time_get();
+		Render();
+		m_pGraphics->Swap();
+		RenderTime += time_get()-RenderStart;
+	}
+
+	double Seconds = (time_get()-StartTime)/(double)time_freq();
+	dbg_msg("bench", "demo '%s', %d frames at %d fps in %.3fs, %.2fus per frame, %.2fus of it rendering",
+		pDemo, NumFrames, Fps, Seconds, Seconds*1000000.0/max(NumFrames, 1), RenderTime*1000000.0/time_freq()/max(NumFrames, 1));
+	GameClient()->ReportRenderProfile(BenchmarkLineCB, this);
+
+	const CGraphicsBackend_Null::CStats *pStats = pBackend->Stats();
+	double Frames = (double)max(pStats->m_NumFrames, (int64)1);
+	int64 NumCommands = 0;
+	for(int i = 0; i < CGraphicsBackend_Null::NUM_CORE_COMMANDS; i++)
+		NumCommands += pStats->m_aNumCommands[i];
+	dbg_msg("bench", "per frame: %.1f commands, %.1f draw calls, %.1f vertices, %.1f state changes, %.1f texture changes, %.0f bytes uploaded",
+		NumCommands/Frames, pStats->m_NumDrawCalls/Frames, pStats->m_NumVertices/Frames, pStats->m_NumStateChanges/Frames,
+		pStats->m_NumTextureChanges/Frames, pStats->m_TextureUploadBytes/Frames);
+	for(int i = 0; i < CGraphicsBackend_Null::NUM_CORE_COMMANDS; i++)
+	{
+		if(pStats->m_aNumCommands[i])
+			dbg_msg("bench", "%-16s %lld, %.1f per frame", CGraphicsBackend_Null::CommandName(i), pStats->m_aNumCommands[i], pStats->m_aNumCommands[i]/Frames);
+	}
+
+	GameClient()->SetRenderProfiling(false);
+	GameClient()->OnShutdown();
+	Disconnect();
+
+	m_pGraphics->Shutdown();
+	m_pSound->Shutdown();
+	return 0;
+}
+
 int64 CClient::TickStartTime(int Tick)
 {
 	return m_MenuStartTime + (time_freq()*Tick)/m_GameTickSpeed;
@@ -2520,7 +2707,7 @@ void CClient::RegisterCommands()
 	m_pConsole->Chain("gfx_vsync", ConchainWindowVSync, this);
 }
 
-static CClient *CreateClient()
+CClient *CreateClient()
 {
 	CClient *pClient = static_cast<CClient *>(mem_alloc(sizeof(CClient), 1));
 	mem_zero(pClient, sizeof(CClient));
@@ -2550,173 +2737,3 @@ void CClient::DoVersionSpecificActions()
 	Prediction Latency
 		Upstream latency
 */
-#if defined(CONF_PLATFORM_MACOSX)
-extern "C" int SDL_main(int argc, char **argv_) // ignore_convention
-{
-	const char **argv = const_cast<const char **>(argv_);
-#else
-int main(int argc, const char **argv) // ignore_convention
-{
-#endif
-#if defined(CONF_FAMILY_WINDOWS)
-	bool QuickEditMode = false;
-	for(int i = 1; i < argc; i++) // ignore_convention
-	{
-		if(str_comp("--quickeditmode", argv[i]) == 0) // ignore_convention
-		{
-			QuickEditMode = true;
-		}
-	}
-#endif
-
-	bool UseDefaultConfig = false;
-	for(int i = 1; i < argc; i++) // ignore_convention
-	{
-		if(str_comp("-d", argv[i]) == 0 || str_comp("--default", argv[i]) == 0) // ignore_convention
-		{
-			UseDefaultConfig = true;
-			break;
-		}
-	}
-
-	if(secure_random_init() != 0)
-	{
-		dbg_msg("secure", "could not initialize secure RNG");
-		return -1;
-	}
-
-	CClient *pClient = CreateClient();
-	IKernel *pKernel = IKernel::Create();
-	pKernel->RegisterInterface(pClient);
-	pClient->RegisterInterfaces();
-
-	// create the components
-	int FlagMask = CFGFLAG_CLIENT;
-	IEngine *pEngine = CreateEngine("Teeworlds");
-	IConsole *pConsole = CreateConsole(FlagMask);
-	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_CLIENT, argc, argv); // ignore_convention
-	IConfig *pConfig = CreateConfig();
-	IEngineSound *pEngineSound = CreateEngineSound();
-	IEngineInput *pEngineInput = CreateEngineInput();
-	IEngineTextRender *pEngineTextRender = CreateEngineTextRender();
-	IEngineMap *pEngineMap = CreateEngineMap();
-	IEngineMasterServer *pEngineMasterServer = CreateEngineMasterServer();
-
-	{
-		bool RegisterFail = false;
-
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pEngine);
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConsole);
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConfig);
-
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineSound*>(pEngineSound)); // register as both
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<ISound*>(pEngineSound));
-
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineInput*>(pEngineInput)); // register as both
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IInput*>(pEngineInput));
-
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineTextRender*>(pEngineTextRender)); // register as both
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<ITextRender*>(pEngineTextRender));
-
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMap*>(pEngineMap)); // register as both
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMap*>(pEngineMap));
-
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMasterServer*>(pEngineMasterServer)); // register as both
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMasterServer*>(pEngineMasterServer));
-
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(CreateEditor());
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(CreateGameClient());
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
-
-		if(RegisterFail)
-			return -1;
-	}
-
-	pEngine->Init();
-	pConfig->Init(FlagMask);
-	pEngineMasterServer->Init();
-	pEngineMasterServer->Load();
-
-	// register all console commands
-	pClient->RegisterCommands();
-
-	// init client's interfaces
-	pClient->InitInterfaces();
-
-	pKernel->RequestInterface<IGameClient>()->OnConsoleInit();
-
-	if(!UseDefaultConfig)
-	{
-		// execute config file
-		if(!pConsole->ExecuteFile(SETTINGS_FILENAME ".cfg"))
-			pConsole->ExecuteFile("settings.cfg"); // fallback to legacy naming scheme
-
-		// execute autoexec file
-		pConsole->ExecuteFile("autoexec.cfg");
-
-		// parse the command line arguments
-		if(argc > 1) // ignore_convention
-		{
-			const char *pAddress = 0;
-			if(argc == 2)
-			{
-				pAddress = str_startswith(argv[1], "teeworlds:");
-			}
-			if(pAddress)
-			{
-				pClient->ConnectOnStart(pAddress);
-			}
-			else
-			{
-				pConsole->ParseArguments(argc - 1, &argv[1]);
-			}
-		}
-	}
-#if defined(CONF_FAMILY_WINDOWS)
-	bool HideConsole = false;
-	#ifdef CONF_RELEASE
-	if(!(g_Config.m_ShowConsoleWindow&2))
-	#else
-	if(!(g_Config.m_ShowConsoleWindow&1))
-	#endif
-	{
-		HideConsole = true;
-		FreeConsole();
-	}
-	else if(!QuickEditMode)
-		dbg_console_init();
-#endif
-
-	pClient->DoVersionSpecificActions();
-
-	// restore empty config strings to their defaults
-	pConfig->RestoreStrings();
-
-	pClient->Engine()->InitLogfile();
-
-	// run the client
-	dbg_msg("client", "starting...");
-	pClient->Run();
-
-	// write down the config and quit
-	pConfig->Save();
-
-#if defined(CONF_FAMILY_WINDOWS)
-	if(!HideConsole && !QuickEditMode)
-		dbg_console_cleanup();
-#endif
-	// free components
-	mem_free(pClient);
-	delete pKernel;
-	delete pEngine;
-	delete pConsole;
-	delete pStorage;
-	delete pConfig;
-	delete pEngineSound;
-	delete pEngineInput;
-	delete pEngineTextRender;
-	delete pEngineMap;
-	delete pEngineMasterServer;
-
-	return 0;
-}
@@ -54,6 +54,15 @@ public:
 
 class CClient : public IClient, public CDemoPlayer::IListner
 {
+	enum
+	{
+		MAX_OWN_INTERFACES=16,
+	};
+
+	// the components created by CreateInterfaces
+	IInterface *m_apOwnInterfaces[MAX_OWN_INTERFACES];
+	int m_NumOwnInterfaces;
+
 	// needed interfaces
 	IEngine *m_pEngine;
 	IEditor *m_pEditor;
@@ -278,14 +287,23 @@ public:
 	virtual void OnDemoPlayerSnapshot(void *pData, int Size);
 	virtual void OnDemoPlayerMessage(void *pData, int Size);
 
+	void UpdateDemoTimers();
 	void Update();
 
+	// creates the engine components and registers them and the client with the kernel, the
+	// editor only when it is wanted. DestroyInterfaces frees the components again on exit
+	bool CreateInterfaces(IKernel *pKernel, int argc, const char **argv, bool Editor); // ignore_convention
+	void DestroyInterfaces();
 	void RegisterInterfaces();
 	void InitInterfaces();
 
 	bool LimitFps();
 	void Run();
 
+	// plays a demo without window, sound or network as fast as it goes, with a fixed time
+	// per frame. the frames go to the null backend, the dump file gets all of its commands
+	int RunBenchmark(const char *pDemo, int Fps, const char *pDumpFilename);
+
 	void ConnectOnStart(const char *pAddress);
 	void DoVersionSpecificActions();
 
@@ -330,4 +348,6 @@ public:
 	void ToggleWindowBordered();
 	void ToggleWindowVSync();
 };
+
+extern CClient *CreateClient();
 #endif
@@ -34,29 +34,12 @@ static CVideoMode g_aFakeModes[] = {
 	{1920,1440,8,8,8}, {1920,2400,8,8,8}, {2048,1536,8,8,8}
 };
 
-void CGraphics_Threaded::FlushVertices()
+CCommandBuffer::SVertex *CGraphics_Threaded::AddRenderCommand(const CCommandBuffer::SState &State, unsigned PrimType, int NumVerts)
 {
-	if(m_NumVertices == 0)
-		return;
-
-	int NumVerts = m_NumVertices;
-	m_NumVertices = 0;
-
 	CCommandBuffer::SCommand_Render Cmd;
-	Cmd.m_State = m_State;
-
-	if(m_Drawing == DRAWING_QUADS)
-	{
-		Cmd.m_PrimType = CCommandBuffer::PRIMTYPE_QUADS;
-		Cmd.m_PrimCount = NumVerts/4;
-	}
-	else if(m_Drawing == DRAWING_LINES)
-	{
-		Cmd.m_PrimType = CCommandBuffer::PRIMTYPE_LINES;
-		Cmd.m_PrimCount = NumVerts/2;
-	}
-	else
-		return;
+	Cmd.m_State = State;
+	Cmd.m_PrimType = PrimType;
+	Cmd.m_PrimCount = PrimType == CCommandBuffer::PRIMTYPE_QUADS ? NumVerts/4 : NumVerts/2;
 
 	Cmd.m_pVertices = (CCommandBuffer::SVertex *)m_pCommandBuffer->AllocData(sizeof(CCommandBuffer::SVertex)*NumVerts);
 	if(Cmd.m_pVertices == 0x0)
@@ -68,7 +51,7 @@ void CGraphics_Threaded::FlushVertices()
 		if(Cmd.m_pVertices == 0x0)
 		{
 			dbg_msg("graphics", "failed to allocate data for vertices");
-			return;
+			return 0x0;
 		}
 	}
 
@@ -82,17 +65,155 @@ void CGraphics_Threaded::FlushVertices()
 		if(Cmd.m_pVertices == 0x0)
 		{
 			dbg_msg("graphics", "failed to allocate data for vertices");
-			return;
+			return 0x0;
 		}
 
 		if(!m_pCommandBuffer->AddCommand(Cmd))
 		{
 			dbg_msg("graphics", "failed to allocate memory for render command");
-			return;
+			return 0x0;
+		}
+	}
+
+	m_NumRenderCommands++;
+	return Cmd.m_pVertices;
+}
+
+void CGraphics_Threaded::BatchVertices(unsigned PrimType, int NumVerts)
+{
+	if(m_NumBatches == MAX_BATCHES || m_NumBatchDraws == MAX_BATCH_DRAWS || m_NumBatchVertices+NumVerts > MAX_VERTICES)
+		FlushBatches();
+
+	// bounds of the draw in the screen, 0..1 on both axes. lines are thin
+	// and rare, they just take the whole screen
+	float aBounds[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+	float ScreenW = m_State.m_ScreenBR.x-m_State.m_ScreenTL.x;
+	float ScreenH = m_State.m_ScreenBR.y-m_State.m_ScreenTL.y;
+	if(PrimType == CCommandBuffer::PRIMTYPE_QUADS && ScreenW != 0.0f && ScreenH != 0.0f)
+	{
+		float MinX = m_aVertices[0].m_Pos.x, MaxX = MinX;
+		float MinY = m_aVertices[0].m_Pos.y, MaxY = MinY;
+		for(int i = 1; i < NumVerts; i++)
+		{
+			MinX = min(MinX, m_aVertices[i].m_Pos.x);
+			MaxX = max(MaxX, m_aVertices[i].m_Pos.x);
+			MinY = min(MinY, m_aVertices[i].m_Pos.y);
+			MaxY = max(MaxY, m_aVertices[i].m_Pos.y);
+		}
+		// a flipped screen flips the bounds too
+		float x0 = (MinX-m_State.m_ScreenTL.x)/ScreenW, x1 = (MaxX-m_State.m_ScreenTL.x)/ScreenW;
+		float y0 = (MinY-m_State.m_ScreenTL.y)/ScreenH, y1 = (MaxY-m_State.m_ScreenTL.y)/ScreenH;
+		aBounds[0] = min(x0, x1);
+		aBounds[1] = min(y0, y1);
+		aBounds[2] = max(x0, x1);
+		aBounds[3] = max(y0, y1);
+	}
+
+	// look for a batch with the same state. with gfx_batch_draws 1 only the last
+	// one, that never changes the order. with 2 also older ones, as long as the
+	// draw doesn't overlap any batch it would move ahead of. additive blending
+	// doesn't care about the order, those may overlap each other
+	CBatch *pBatch = 0x0;
+	int MinBatch = g_Config.m_GfxBatchDraws >= 2 ? max(m_NumBatches-MAX_BATCH_SEARCH, 0) : max(m_NumBatches-1, 0);
+	bool Additive = m_State.m_BlendMode == CCommandBuffer::BLEND_ADDITIVE;
+	for(int b = m_NumBatches-1; b >= MinBatch; b--)
+	{
+		CBatch *pOther = &m_aBatches[b];
+		if(pOther->m_PrimType == PrimType && pOther->m_State.Equals(m_State))
+		{
+			pBatch = pOther;
+			break;
 		}
+
+		bool Overlaps = aBounds[0] < pOther->m_aBounds[2] && pOther->m_aBounds[0] < aBounds[2] &&
+			aBounds[1] < pOther->m_aBounds[3] && pOther->m_aBounds[1] < aBounds[3];
+		if(Overlaps && !(Additive && pOther->m_State.m_BlendMode == CCommandBuffer::BLEND_ADDITIVE))
+			break;
+	}
+
+	if(!pBatch)
+	{
+		pBatch = &m_aBatches[m_NumBatches++];
+		pBatch->m_State = m_State;
+		pBatch->m_PrimType = PrimType;
+		pBatch->m_NumVertices = 0;
+		pBatch->m_FirstDraw = -1;
+		pBatch->m_LastDraw = -1;
+		mem_copy(pBatch->m_aBounds, aBounds, sizeof(aBounds));
+	}
+	else
+	{
+		pBatch->m_aBounds[0] = min(pBatch->m_aBounds[0], aBounds[0]);
+		pBatch->m_aBounds[1] = min(pBatch->m_aBounds[1], aBounds[1]);
+		pBatch->m_aBounds[2] = max(pBatch->m_aBounds[2], aBounds[2]);
+		pBatch->m_aBounds[3] = max(pBatch->m_aBounds[3], aBounds[3]);
+	}
+
+	// link the draw to the batch
+	int Draw = m_NumBatchDraws++;
+	m_aBatchDraws[Draw].m_FirstVertex = m_NumBatchVertices;
+	m_aBatchDraws[Draw].m_NumVertices = NumVerts;
+	m_aBatchDraws[Draw].m_Next = -1;
+	if(pBatch->m_LastDraw == -1)
+		pBatch->m_FirstDraw = Draw;
+	else
+		m_aBatchDraws[pBatch->m_LastDraw].m_Next = Draw;
+	pBatch->m_LastDraw = Draw;
+	pBatch->m_NumVertices += NumVerts;
+
+	mem_copy(&m_aBatchVertices[m_NumBatchVertices], m_aVertices, sizeof(CCommandBuffer::SVertex)*NumVerts);
+	m_NumBatchVertices += NumVerts;
+}
+
+void CGraphics_Threaded::FlushBatches()
+{
+	for(int b = 0; b < m_NumBatches; b++)
+	{
+		const CBatch *pBatch = &m_aBatches[b];
+		CCommandBuffer::SVertex *pVertices = AddRenderCommand(pBatch->m_State, pBatch->m_PrimType, pBatch->m_NumVertices);
+		if(!pVertices)
+			continue;
+
+		for(int d = pBatch->m_FirstDraw; d != -1; d = m_aBatchDraws[d].m_Next)
+		{
+			mem_copy(pVertices, &m_aBatchVertices[m_aBatchDraws[d].m_FirstVertex], sizeof(CCommandBuffer::SVertex)*m_aBatchDraws[d].m_NumVertices);
+			pVertices += m_aBatchDraws[d].m_NumVertices;
+		}
+	}
+
+	m_NumBatches = 0;
+	m_NumBatchDraws = 0;
+	m_NumBatchVertices = 0;
+}
+
+void CGraphics_Threaded::FlushVertices()
+{
+	if(m_NumVertices == 0)
+		return;
+
+	int NumVerts = m_NumVertices;
+	m_NumVertices = 0;
+
+	unsigned PrimType;
+	if(m_Drawing == DRAWING_QUADS)
+		PrimType = CCommandBuffer::PRIMTYPE_QUADS;
+	else if(m_Drawing == DRAWING_LINES)
+		PrimType = CCommandBuffer::PRIMTYPE_LINES;
+	else
+		return;
+
+	m_NumDraws++;
+	if(g_Config.m_GfxBatchDraws)
+	{
+		BatchVertices(PrimType, NumVerts);
+		return;
 	}
 
-	mem_copy(Cmd.m_pVertices, m_aVertices, sizeof(CCommandBuffer::SVertex)*NumVerts);
+	// draws from before the batching got turned off go first
+	FlushBatches();
+	CCommandBuffer::SVertex *pVertices = AddRenderCommand(m_State, PrimType, NumVerts);
+	if(pVertices)
+		mem_copy(pVertices, m_aVertices, sizeof(CCommandBuffer::SVertex)*NumVerts);
 }
 
 void CGraphics_Threaded::AddVertices(int Count)
@@ -118,8 +239,10 @@ void CGraphics_Threaded::Rotate4(const CCommandBuffer::SPoint &rCenter, CCommand
 	}
 }
 
-CGraphics_Threaded::CGraphics_Threaded()
+CGraphics_Threaded::CGraphics_Threaded(IGraphicsBackend *pBackend)
 {
+	m_pBackend = pBackend;
+
 	m_State.m_ScreenTL.x = 0;
 	m_State.m_ScreenTL.y = 0;
 	m_State.m_ScreenBR.x = 0;
@@ -134,12 +257,25 @@ CGraphics_Threaded::CGraphics_Threaded()
 	m_State.m_WrapModeU = WRAP_REPEAT;
 	m_State.m_WrapModeV = WRAP_REPEAT;
 
+	m_NumCommandBuffers = 0;
 	m_CurrentCommandBuffer = 0;
 	m_pCommandBuffer = 0x0;
-	m_apCommandBuffers[0] = 0x0;
-	m_apCommandBuffers[1] = 0x0;
+	for(int i = 0; i < MAX_CMDBUFFERS; i++)
+		m_apCommandBuffers[i] = 0x0;
+
+	m_FrameStart = 0;
+	m_FrameWaitTime = 0;
+	m_QueueDepth = 0;
+	mem_zero(&m_FrameStats, sizeof(m_FrameStats));
 
 	m_NumVertices = 0;
+	m_NumBatches = 0;
+	m_NumBatchDraws = 0;
+	m_NumBatchVertices = 0;
+	m_NumDraws = 0;
+	m_NumRenderCommands = 0;
+	m_LastFrameDraws = 0;
+	m_LastFrameRenderCommands = 0;
 
 	m_ScreenWidth = -1;
 	m_ScreenHeight = -1;
@@ -149,6 +285,9 @@ CGraphics_Threaded::CGraphics_Threaded()
 
 	m_TextureMemoryUsage = 0;
 
+	for(int i = 0; i < MAX_QUADBUFFERS; i++)
+		m_aQuadBuffers[i].m_pVertices = 0x0;
+
 	m_RenderEnable = true;
 	m_DoScreenshot = false;
 }
@@ -273,6 +412,7 @@ int CGraphics_Threaded::UnloadTexture(CTextureHandle *Index)
 	if(!Index->IsValid())
 		return 0;
 
+	FlushBatches();
 	CCommandBuffer::SCommand_Texture_Destroy Cmd;
 	Cmd.m_Slot = Index->Id();
 	m_pCommandBuffer->AddCommand(Cmd);
@@ -305,6 +445,7 @@ static int ImageFormatToPixelSize(int Format)
 
 int CGraphics_Threaded::LoadTextureRawSub(CTextureHandle TextureID, int x, int y, int Width, int Height, int Format, const void *pData)
 {
+	FlushBatches();
 	CCommandBuffer::SCommand_Texture_Update Cmd;
 	Cmd.m_Slot = TextureID.Id();
 	Cmd.m_X = x;
@@ -337,6 +478,7 @@ IGraphics::CTextureHandle CGraphics_Threaded::LoadTextureRaw(int Width, int Heig
 	m_FirstFreeTexture = m_aTextureIndices[Tex];
 	m_aTextureIndices[Tex] = -1;
 
+	FlushBatches();
 	CCommandBuffer::SCommand_Texture_Create Cmd;
 	Cmd.m_Slot = Tex;
 	Cmd.m_Width = Width;
@@ -450,12 +592,29 @@ int CGraphics_Threaded::LoadPNG(CImageInfo *pImg, const char *pFilename, int Sto
 	return 1;
 }
 
-void CGraphics_Threaded::KickCommandBuffer()
+void CGraphics_Threaded::KickCommandBuffer(bool EndOfFrame)
 {
 	m_pBackend->RunBuffer(m_pCommandBuffer);
+	m_QueueDepth = m_pBackend->NumQueued();
+
+	// the next buffer in the ring is still queued when the backend has as many
+	// as there are buffers. rather than waiting for it a new one goes in between.
+	// whole frames may only get gfx_cmd_buffers ahead of the backend, the
+	// buffers of a frame that overflows one can go up to the maximum
+	int MaxQueued = EndOfFrame ? g_Config.m_GfxCmdBuffers : MAX_CMDBUFFERS;
+	if(m_QueueDepth >= m_NumCommandBuffers && m_NumCommandBuffers < MaxQueued)
+	{
+		for(int i = m_NumCommandBuffers; i > m_CurrentCommandBuffer+1; i--)
+			m_apCommandBuffers[i] = m_apCommandBuffers[i-1];
+		m_apCommandBuffers[m_CurrentCommandBuffer+1] = new CCommandBuffer(CMDBUFFER_SIZE, CMDBUFFER_DATA_SIZE);
+		m_NumCommandBuffers++;
+	}
+
+	int64 WaitStart = time_get();
+	m_pBackend->WaitForQueue(min(MaxQueued, m_NumCommandBuffers)-1);
+	m_FrameWaitTime += time_get()-WaitStart;
 
-	// swap buffer
-	m_CurrentCommandBuffer ^= 1;
+	m_CurrentCommandBuffer = (m_CurrentCommandBuffer+1)%m_NumCommandBuffers;
 	m_pCommandBuffer = m_apCommandBuffers[m_CurrentCommandBuffer];
 	m_pCommandBuffer->Reset();
 }
@@ -466,6 +625,7 @@ void CGraphics_Threaded::ScreenshotDirect(const char *pFilename)
 	CImageInfo Image;
 	mem_zero(&Image, sizeof(Image));
 
+	FlushBatches();
 	CCommandBuffer::SCommand_Screenshot Cmd;
 	Cmd.m_pImage = &Image;
 	Cmd.m_X = 0; Cmd.m_Y = 0;
@@ -507,6 +667,7 @@ void CGraphics_Threaded::TextureSet(CTextureHandle TextureID)
 
 void CGraphics_Threaded::Clear(float r, float g, float b)
 {
+	FlushBatches();
 	CCommandBuffer::SCommand_Clear Cmd;
 	Cmd.m_Color.r = r;
 	Cmd.m_Color.g = g;
@@ -737,6 +898,123 @@ void CGraphics_Threaded::QuadsText(float x, float y, float Size, const char *pTe
 	}
 }
 
+IGraphics::CQuadBufferHandle CGraphics_Threaded::CreateQuadBuffer(const CQuadBufferItem *pItems, int Num)
+{
+	if(Num <= 0)
+		return CQuadBufferHandle();
+
+	// with the tileset fallback system the texture can change from quad to quad, a buffer can't do that
+	int Dimension = 2;
+	for(int i = 0; i < Num; i++)
+		if(pItems[i].m_TextureIndex >= 0)
+			Dimension = 3;
+	if(Dimension == 3 && m_pBackend->GetTextureArraySize() > 1)
+		return CQuadBufferHandle();
+
+	int Slot = 0;
+	while(Slot < MAX_QUADBUFFERS && m_aQuadBuffers[Slot].m_pVertices)
+		Slot++;
+	if(Slot == MAX_QUADBUFFERS)
+	{
+		dbg_msg("graphics", "no free quad buffer");
+		return CQuadBufferHandle();
+	}
+
+	CCommandBuffer::SBufferVertex *pVertices = (CCommandBuffer::SBufferVertex *)mem_alloc(sizeof(CCommandBuffer::SBufferVertex)*4*Num, sizeof(void*));
+	for(int i = 0; i < Num; i++)
+	{
+		const CQuadBufferItem *pItem = &pItems[i];
+		CCommandBuffer::SBufferVertex *pQuad = &pVertices[4*i];
+		pQuad[0].m_Pos.x = pItem->m_Quad.m_X;
+		pQuad[0].m_Pos.y = pItem->m_Quad.m_Y;
+		pQuad[1].m_Pos.x = pItem->m_Quad.m_X + pItem->m_Quad.m_Width;
+		pQuad[1].m_Pos.y = pItem->m_Quad.m_Y;
+		pQuad[2].m_Pos.x = pItem->m_Quad.m_X + pItem->m_Quad.m_Width;
+		pQuad[2].m_Pos.y = pItem->m_Quad.m_Y + pItem->m_Quad.m_Height;
+		pQuad[3].m_Pos.x = pItem->m_Quad.m_X;
+		pQuad[3].m_Pos.y = pItem->m_Quad.m_Y + pItem->m_Quad.m_Height;
+
+		for(int k = 0; k < 4; k++)
+		{
+			pQuad[k].m_Pos.z = -5.0f;
+			pQuad[k].m_Tex.u = pItem->m_aTexCoords[2*k];
+			pQuad[k].m_Tex.v = pItem->m_aTexCoords[2*k+1];
+			pQuad[k].m_Tex.i = (0.5f + pItem->m_TextureIndex) / 256.0f;
+		}
+	}
+
+	m_aQuadBuffers[Slot].m_pVertices = pVertices;
+	m_aQuadBuffers[Slot].m_NumQuads = Num;
+	m_aQuadBuffers[Slot].m_Dimension = Dimension;
+	return CreateQuadBufferHandle(Slot);
+}
+
+void CGraphics_Threaded::DestroyQuadBuffer(CQuadBufferHandle *pBuffer)
+{
+	if(!pBuffer->IsValid())
+		return;
+
+	// commands that draw the buffer might still be queued, the backend frees it after them
+	FlushBatches();
+	CCommandBuffer::SCommand_Buffer_Destroy Cmd;
+	Cmd.m_pVertices = m_aQuadBuffers[pBuffer->Id()].m_pVertices;
+	if(!m_pCommandBuffer->AddCommand(Cmd))
+	{
+		KickCommandBuffer();
+		m_pCommandBuffer->AddCommand(Cmd);
+	}
+
+	m_aQuadBuffers[pBuffer->Id()].m_pVertices = 0x0;
+	pBuffer->Invalidate();
+}
+
+void CGraphics_Threaded::QuadBufferDraw(CQuadBufferHandle Buffer, const CQuadBufferRange *pRanges, int NumRanges, vec4 Color)
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->QuadBufferDraw within begin");
+	if(!Buffer.IsValid() || NumRanges <= 0)
+		return;
+
+	const CQuadBuffer *pBuffer = &m_aQuadBuffers[Buffer.Id()];
+	FlushBatches();
+	CCommandBuffer::SCommand_RenderBuffer Cmd;
+	Cmd.m_State = m_State;
+	Cmd.m_State.m_Dimension = pBuffer->m_Dimension;
+	Cmd.m_State.m_TextureArrayIndex = 0;
+	Cmd.m_Color.r = Color.r;
+	Cmd.m_Color.g = Color.g;
+	Cmd.m_Color.b = Color.b;
+	Cmd.m_Color.a = Color.a;
+	Cmd.m_pVertices = pBuffer->m_pVertices;
+	Cmd.m_NumRanges = NumRanges;
+
+	Cmd.m_pRanges = (CCommandBuffer::SBufferRange *)m_pCommandBuffer->AllocData(sizeof(CCommandBuffer::SBufferRange)*NumRanges);
+	if(Cmd.m_pRanges == 0x0 || !m_pCommandBuffer->AddCommand(Cmd))
+	{
+		// kick command buffer and try again
+		KickCommandBuffer();
+
+		Cmd.m_pRanges = (CCommandBuffer::SBufferRange *)m_pCommandBuffer->AllocData(sizeof(CCommandBuffer::SBufferRange)*NumRanges);
+		if(Cmd.m_pRanges == 0x0 || !m_pCommandBuffer->AddCommand(Cmd))
+		{
+			dbg_msg("graphics", "failed to allocate memory for buffer render command");
+			return;
+		}
+	}
+
+	for(int i = 0; i < NumRanges; i++)
+	{
+		dbg_assert(pRanges[i].m_First >= 0 && pRanges[i].m_First+pRanges[i].m_Num <= pBuffer->m_NumQuads, "quad buffer range out of bounds");
+		Cmd.m_pRanges[i].m_FirstVertex = pRanges[i].m_First*4;
+		Cmd.m_pRanges[i].m_NumVertices = pRanges[i].m_Num*4;
+	}
+}
+
+void CGraphics_Threaded::GetDrawStats(int *pNumDraws, int *pNumRenderCommands) const
+{
+	*pNumDraws = m_LastFrameDraws;
+	*pNumRenderCommands = m_LastFrameRenderCommands;
+}
+
 int CGraphics_Threaded::IssueInit()
 {
 	int Flags = 0;
@@ -803,14 +1081,18 @@ int CGraphics_Threaded::Init()
 		m_aTextureIndices[i] = i+1;
 	m_aTextureIndices[MAX_TEXTURES-1] = -1;
 
-	m_pBackend = CreateGraphicsBackend();
+	if(!m_pBackend)
+		m_pBackend = CreateGraphicsBackend();
 	if(InitWindow() != 0)
 		return -1;
 
-	// create command buffers
-	for(int i = 0; i < NUM_CMDBUFFERS; i++)
-		m_apCommandBuffers[i] = new CCommandBuffer(128*1024, 2*1024*1024);
+	// create command buffers, the ring grows when it needs more
+	m_NumCommandBuffers = MIN_CMDBUFFERS;
+	for(int i = 0; i < m_NumCommandBuffers; i++)
+		m_apCommandBuffers[i] = new CCommandBuffer(CMDBUFFER_SIZE, CMDBUFFER_DATA_SIZE);
+	m_CurrentCommandBuffer = 0;
 	m_pCommandBuffer = m_apCommandBuffers[0];
+	m_FrameStart = time_get();
 
 	// create null texture, will get id=0
 	unsigned char aNullTextureData[4*32*32];
@@ -862,8 +1144,17 @@ void CGraphics_Threaded::Shutdown()
 	m_pBackend = 0x0;
 
 	// delete the command buffers
-	for(int i = 0; i < NUM_CMDBUFFERS; i++)
+	for(int i = 0; i < m_NumCommandBuffers; i++)
 		delete m_apCommandBuffers[i];
+	m_NumCommandBuffers = 0;
+
+	// the backend is gone, buffers that are left can go right away
+	for(int i = 0; i < MAX_QUADBUFFERS; i++)
+	{
+		if(m_aQuadBuffers[i].m_pVertices)
+			mem_free(m_aQuadBuffers[i].m_pVertices);
+		m_aQuadBuffers[i].m_pVertices = 0x0;
+	}
 }
 
 int CGraphics_Threaded::GetNumScreens() const
@@ -927,6 +1218,7 @@ void CGraphics_Threaded::ReadBackbuffer(unsigned char **ppPixels, int x, int y,
 	CImageInfo Image;
 	mem_zero(&Image, sizeof(Image));
 
+	FlushBatches();
 	CCommandBuffer::SCommand_Screenshot Cmd;
 	Cmd.m_pImage = &Image;
 	Cmd.m_X = x; Cmd.m_Y = y;
@@ -951,6 +1243,12 @@ void CGraphics_Threaded::TakeScreenshot(const char *pFilename)
 
 void CGraphics_Threaded::Swap()
 {
+	FlushBatches();
+	m_LastFrameDraws = m_NumDraws;
+	m_LastFrameRenderCommands = m_NumRenderCommands;
+	m_NumDraws = 0;
+	m_NumRenderCommands = 0;
+
 	// TODO: screenshot support
 	if(m_DoScreenshot)
 	{
@@ -964,14 +1262,24 @@ void CGraphics_Threaded::Swap()
 	Cmd.m_Finish = g_Config.m_GfxFinish;
 	m_pCommandBuffer->AddCommand(Cmd);
 
+	int64 SubmitTime = time_get()-m_FrameStart-m_FrameWaitTime;
+
 	// kick the command buffer
-	KickCommandBuffer();
+	KickCommandBuffer(true);
+
+	m_FrameStats.m_SubmitTime = SubmitTime;
+	m_FrameStats.m_WaitTime = m_FrameWaitTime;
+	m_FrameStats.m_QueueDepth = m_QueueDepth;
+	m_FrameStats.m_NumCommandBuffers = m_NumCommandBuffers;
+	m_FrameStart = time_get();
+	m_FrameWaitTime = 0;
 }
 
 bool CGraphics_Threaded::SetVSync(bool State)
 {
 	// add vsnc command
 	bool RetOk = 0;
+	FlushBatches();
 	CCommandBuffer::SCommand_VSync Cmd;
 	Cmd.m_VSync = State ? 1 : 0;
 	Cmd.m_pRetOk = &RetOk;
@@ -986,6 +1294,7 @@ bool CGraphics_Threaded::SetVSync(bool State)
 // syncronization
 void CGraphics_Threaded::InsertSignal(semaphore *pSemaphore)
 {
+	FlushBatches();
 	CCommandBuffer::SCommand_Signal Cmd;
 	Cmd.m_pSemaphore = pSemaphore;
 	m_pCommandBuffer->AddCommand(Cmd);
@@ -998,7 +1307,9 @@ bool CGraphics_Threaded::IsIdle() const
 
 void CGraphics_Threaded::WaitForIdle()
 {
+	int64 WaitStart = time_get();
 	m_pBackend->WaitForIdle();
+	m_FrameWaitTime += time_get()-WaitStart;
 }
 
 int CGraphics_Threaded::GetVideoModes(CVideoMode *pModes, int MaxModes, int Screen)
@@ -1017,6 +1328,7 @@ int CGraphics_Threaded::GetVideoModes(CVideoMode *pModes, int MaxModes, int Scre
 	mem_zero(&Image, sizeof(Image));
 
 	int NumModes = 0;
+	FlushBatches();
 	CCommandBuffer::SCommand_VideoModes Cmd;
 	Cmd.m_pModes = pModes;
 	Cmd.m_MaxModes = MaxModes;
@@ -1030,4 +1342,5 @@ int CGraphics_Threaded::GetVideoModes(CVideoMode *pModes, int MaxModes, int Scre
 	return NumModes;
 }
 
-extern IEngineGraphics *CreateEngineGraphicsThreaded() { return new CGraphics_Threaded(); }
+extern IEngineGraphics *CreateEngineGraphicsThreaded() { return new CGraphics_Threaded(0x0); }
+extern IEngineGraphics *CreateEngineGraphicsThreaded(IGraphicsBackend *pBackend) { return new CGraphics_Threaded(pBackend); }
@@ -74,9 +74,13 @@ public:
 		CMD_TEXTURE_DESTROY,
 		CMD_TEXTURE_UPDATE,
 
+		// buffer commands
+		CMD_BUFFER_DESTROY,
+
 		// rendering
 		CMD_CLEAR,
 		CMD_RENDER,
+		CMD_RENDER_BUFFER,
 
 		// swap
 		CMD_SWAP,
@@ -129,6 +133,19 @@ public:
 		SColor m_Color;
 	};
 
+	// vertex of a quad buffer, the color is the same for all of a command
+	struct SBufferVertex
+	{
+		SPoint m_Pos;
+		STexCoord m_Tex;
+	};
+
+	struct SBufferRange
+	{
+		unsigned m_FirstVertex;
+		unsigned m_NumVertices;
+	};
+
 	struct SCommand
 	{
 	public:
@@ -154,6 +171,16 @@ public:
 		int m_ClipY;
 		int m_ClipW;
 		int m_ClipH;
+
+		bool Equals(const SState &Other) const
+		{
+			return m_BlendMode == Other.m_BlendMode && m_WrapModeU == Other.m_WrapModeU && m_WrapModeV == Other.m_WrapModeV &&
+				m_Texture == Other.m_Texture && m_TextureArrayIndex == Other.m_TextureArrayIndex && m_Dimension == Other.m_Dimension &&
+				m_ScreenTL.x == Other.m_ScreenTL.x && m_ScreenTL.y == Other.m_ScreenTL.y &&
+				m_ScreenBR.x == Other.m_ScreenBR.x && m_ScreenBR.y == Other.m_ScreenBR.y &&
+				m_ClipEnable == Other.m_ClipEnable && (!m_ClipEnable ||
+					(m_ClipX == Other.m_ClipX && m_ClipY == Other.m_ClipY && m_ClipW == Other.m_ClipW && m_ClipH == Other.m_ClipH));
+		}
 	};
 
 	struct SCommand_Clear : public SCommand
@@ -183,6 +210,22 @@ public:
 		SVertex *m_pVertices; // you should use the command buffer data to allocate vertices for this command
 	};
 
+	struct SCommand_RenderBuffer : public SCommand
+	{
+		SCommand_RenderBuffer() : SCommand(CMD_RENDER_BUFFER) {}
+		SState m_State;
+		SColor m_Color;
+		const SBufferVertex *m_pVertices; // owned by the buffer, stays valid until its destroy command
+		unsigned m_NumRanges;
+		SBufferRange *m_pRanges; // you should use the command buffer data to allocate the ranges for this command
+	};
+
+	struct SCommand_Buffer_Destroy : public SCommand
+	{
+		SCommand_Buffer_Destroy() : SCommand(CMD_BUFFER_DESTROY) {}
+		SBufferVertex *m_pVertices; // will be freed by the command processor
+	};
+
 	struct SCommand_Screenshot : public SCommand
 	{
 		SCommand_Screenshot() : SCommand(CMD_SCREENSHOT) {}
@@ -311,6 +354,8 @@ public:
 		INITFLAG_BORDERLESS = 8,
 		INITFLAG_X11XRANDR = 16,
 		INITFLAG_HIGHDPI = 32,
+
+		MAX_QUEUED = 16,
 	};
 
 	virtual ~IGraphicsBackend() {}
@@ -333,7 +378,11 @@ public:
 	virtual int WindowActive() = 0;
 	virtual int WindowOpen() = 0;
 
+	// queues the buffer, at most MAX_QUEUED wait for the backend at once
 	virtual void RunBuffer(CCommandBuffer *pBuffer) = 0;
+	// buffers that have been queued and are not done yet
+	virtual int NumQueued() const = 0;
+	virtual void WaitForQueue(int MaxQueued) = 0;
 	virtual bool IsIdle() const = 0;
 	virtual void WaitForIdle() = 0;
 };
@@ -342,10 +391,18 @@ class CGraphics_Threaded : public IEngineGraphics
 {
 	enum
 	{
-		NUM_CMDBUFFERS = 2,
+		MIN_CMDBUFFERS = 2,
+		MAX_CMDBUFFERS = 8,
+		CMDBUFFER_SIZE = 128*1024,
+		CMDBUFFER_DATA_SIZE = 2*1024*1024,
 
 		MAX_VERTICES = 32*1024,
 		MAX_TEXTURES = 1024*4,
+		MAX_QUADBUFFERS = 512,
+
+		MAX_BATCHES = 256,
+		MAX_BATCH_DRAWS = 4096,
+		MAX_BATCH_SEARCH = 16,
 
 		DRAWING_QUADS=1,
 		DRAWING_LINES=2
@@ -354,9 +411,18 @@ class CGraphics_Threaded : public IEngineGraphics
 	CCommandBuffer::SState m_State;
 	IGraphicsBackend *m_pBackend;
 
-	CCommandBuffer *m_apCommandBuffers[NUM_CMDBUFFERS];
+	// ring of command buffers, the backend works through them in order.
+	// grows when the backend lags behind, up to gfx_cmd_buffers per frame
+	CCommandBuffer *m_apCommandBuffers[MAX_CMDBUFFERS];
 	CCommandBuffer *m_pCommandBuffer;
-	unsigned m_CurrentCommandBuffer;
+	int m_NumCommandBuffers;
+	int m_CurrentCommandBuffer;
+
+	// frame pacing
+	int64 m_FrameStart;
+	int64 m_FrameWaitTime;
+	int m_QueueDepth;
+	CFrameStats m_FrameStats;
 
 	//
 	class IStorage *m_pStorage;
@@ -382,16 +448,60 @@ class CGraphics_Threaded : public IEngineGraphics
 	int m_FirstFreeTexture;
 	int m_TextureMemoryUsage;
 
+	struct CQuadBuffer
+	{
+		CCommandBuffer::SBufferVertex *m_pVertices; // 0 for free slots
+		int m_NumQuads;
+		int m_Dimension;
+	};
+	CQuadBuffer m_aQuadBuffers[MAX_QUADBUFFERS];
+
+	// draws that wait to be merged with others of the same state, see gfx_batch_draws.
+	// a batch takes the draws of one render command, they are linked in the order they came in
+	struct CBatch
+	{
+		CCommandBuffer::SState m_State;
+		unsigned m_PrimType;
+		int m_NumVertices;
+		int m_FirstDraw;
+		int m_LastDraw;
+		float m_aBounds[4]; // of all its draws, relative to the screen they are mapped to
+	};
+
+	struct CBatchDraw
+	{
+		int m_FirstVertex;
+		int m_NumVertices;
+		int m_Next;
+	};
+
+	CBatch m_aBatches[MAX_BATCHES];
+	int m_NumBatches;
+	CBatchDraw m_aBatchDraws[MAX_BATCH_DRAWS];
+	int m_NumBatchDraws;
+	CCommandBuffer::SVertex m_aBatchVertices[MAX_VERTICES];
+	int m_NumBatchVertices;
+
+	// draws and the render commands they ended up in, for the current and the last frame
+	int m_NumDraws;
+	int m_NumRenderCommands;
+	int m_LastFrameDraws;
+	int m_LastFrameRenderCommands;
+
+	CCommandBuffer::SVertex *AddRenderCommand(const CCommandBuffer::SState &State, unsigned PrimType, int NumVertices);
+	void BatchVertices(unsigned PrimType, int NumVertices);
+	void FlushBatches();
 	void FlushVertices();
 	void AddVertices(int Count);
 	void Rotate4(const CCommandBuffer::SPoint &rCenter, CCommandBuffer::SVertex *pPoints);
 
-	void KickCommandBuffer();
+	void KickCommandBuffer(bool EndOfFrame = false);
 
 	int IssueInit();
 	int InitWindow();
 public:
-	CGraphics_Threaded();
+	// takes over the backend, 0 for the one of the platform
+	CGraphics_Threaded(IGraphicsBackend *pBackend);
 
 	virtual void ClipEnable(int x, int y, int w, int h);
 	virtual void ClipDisable();
@@ -446,6 +556,13 @@ public:
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num);
 	virtual void QuadsText(float x, float y, float Size, const char *pText);
 
+	virtual CQuadBufferHandle CreateQuadBuffer(const CQuadBufferItem *pItems, int Num);
+	virtual void DestroyQuadBuffer(CQuadBufferHandle *pBuffer);
+	virtual void QuadBufferDraw(CQuadBufferHandle Buffer, const CQuadBufferRange *pRanges, int NumRanges, vec4 Color);
+
+	virtual void GetDrawStats(int *pNumDraws, int *pNumRenderCommands) const;
+	virtual void GetFrameStats(CFrameStats *pStats) const { *pStats = m_FrameStats; }
+
 	virtual int GetNumScreens() const;
 	virtual void Minimize();
 	virtual void Maximize();
@@ -474,3 +591,4 @@ public:
 };
 
 extern IGraphicsBackend *CreateGraphicsBackend();
+extern IEngineGraphics *CreateEngineGraphicsThreaded(IGraphicsBackend *pBackend);
@@ -0,0 +1,164 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+#include <engine/client.h>
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/editor.h>
+#include <engine/engine.h>
+#include <engine/input.h>
+#include <engine/map.h>
+#include <engine/masterserver.h>
+#include <engine/serverbrowser.h>
+#include <engine/sound.h>
+#include <engine/storage.h>
+#include <engine/textrender.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/mapchecker.h>
+#include <engine/shared/network.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+
+#include <game/version.h>
+
+#include "contacts.h"
+#include "serverbrowser.h"
+#include "client.h"
+
+#if defined(CONF_FAMILY_WINDOWS)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#include "SDL.h"
+#ifdef main
+#undef main
+#endif
+
+#if defined(CONF_PLATFORM_MACOSX)
+extern "C" int SDL_main(int argc, char **argv_) // ignore_convention
+{
+	const char **argv = const_cast<const char **>(argv_);
+#else
+int main(int argc, const char **argv) // ignore_convention
+{
+#endif
+#if defined(CONF_FAMILY_WINDOWS)
+	bool QuickEditMode = false;
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp("--quickeditmode", argv[i]) == 0) // ignore_convention
+		{
+			QuickEditMode = true;
+		}
+	}
+#endif
+
+	bool UseDefaultConfig = false;
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp("-d", argv[i]) == 0 || str_comp("--default", argv[i]) == 0) // ignore_convention
+		{
+			UseDefaultConfig = true;
+			break;
+		}
+	}
+
+	if(secure_random_init() != 0)
+	{
+		dbg_msg("secure", "could not initialize secure RNG");
+		return -1;
+	}
+
+	CClient *pClient = CreateClient();
+	IKernel *pKernel = IKernel::Create();
+	if(!pClient->CreateInterfaces(pKernel, argc, argv, true)) // ignore_convention
+		return -1;
+
+	int FlagMask = CFGFLAG_CLIENT;
+	IEngine *pEngine = pKernel->RequestInterface<IEngine>();
+	IConsole *pConsole = pKernel->RequestInterface<IConsole>();
+	IConfig *pConfig = pKernel->RequestInterface<IConfig>();
+	IEngineMasterServer *pEngineMasterServer = pKernel->RequestInterface<IEngineMasterServer>();
+
+	pEngine->Init();
+	pConfig->Init(FlagMask);
+	pEngineMasterServer->Init();
+	pEngineMasterServer->Load();
+
+	// register all console commands
+	pClient->RegisterCommands();
+
+	// init client's interfaces
+	pClient->InitInterfaces();
+
+	pKernel->RequestInterface<IGameClient>()->OnConsoleInit();
+
+	if(!UseDefaultConfig)
+	{
+		// execute config file
+		if(!pConsole->ExecuteFile(SETTINGS_FILENAME ".cfg"))
+			pConsole->ExecuteFile("settings.cfg"); // fallback to legacy naming scheme
+
+		// execute autoexec file
+		pConsole->ExecuteFile("autoexec.cfg");
+
+		// parse the command line arguments
+		if(argc > 1) // ignore_convention
+		{
+			const char *pAddress = 0;
+			if(argc == 2)
+			{
+				pAddress = str_startswith(argv[1], "teeworlds:");
+			}
+			if(pAddress)
+			{
+				pClient->ConnectOnStart(pAddress);
+			}
+			else
+			{
+				pConsole->ParseArguments(argc - 1, &argv[1]);
+			}
+		}
+	}
+#if defined(CONF_FAMILY_WINDOWS)
+	bool HideConsole = false;
+	#ifdef CONF_RELEASE
+	if(!(g_Config.m_ShowConsoleWindow&2))
+	#else
+	if(!(g_Config.m_ShowConsoleWindow&1))
+	#endif
+	{
+		HideConsole = true;
+		FreeConsole();
+	}
+	else if(!QuickEditMode)
+		dbg_console_init();
+#endif
+
+	pClient->DoVersionSpecificActions();
+
+	// restore empty config strings to their defaults
+	pConfig->RestoreStrings();
+
+	pClient->Engine()->InitLogfile();
+
+	// run the client
+	dbg_msg("client", "starting...");
+	pClient->Run();
+
+	// write down the config and quit
+	pConfig->Save();
+
+#if defined(CONF_FAMILY_WINDOWS)
+	if(!HideConsole && !QuickEditMode)
+		dbg_console_cleanup();
+#endif
+	// free components
+	pClient->DestroyInterfaces();
+	mem_free(pClient);
+	delete pKernel;
+
+	return 0;
+}
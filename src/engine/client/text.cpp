@@ -17,6 +17,7 @@
 enum
 {
 	MAX_CHARACTERS = 64,
+	CHAR_HASH_SIZE = 1024, // power of two
 };
 
 
@@ -37,6 +38,10 @@ struct CFontChar
 
 	float m_aUvs[4];
 	int64 m_TouchTime;
+
+	int m_HashNext; // next slot in the same hash bucket
+	int m_LruPrev; // slots by last use, most recent first
+	int m_LruNext;
 };
 
 struct CFontSizeData
@@ -48,6 +53,11 @@ struct CFontSizeData
 	int m_TextureWidth;
 	int m_TextureHeight;
 
+	// copies of the textures, the glyphs go in here and the rows that changed get uploaded at once
+	unsigned char *m_apTextureData[2];
+	int m_DirtyTop;
+	int m_DirtyBottom;
+
 	int m_NumXChars;
 	int m_NumYChars;
 
@@ -55,6 +65,9 @@ struct CFontSizeData
 	int m_CharMaxHeight;
 
 	CFontChar m_aCharacters[MAX_CHARACTERS*MAX_CHARACTERS];
+	int m_aCharHash[CHAR_HASH_SIZE];
+	int m_LruFirst;
+	int m_LruLast;
 
 	int m_CurrentCharacter;
 };
@@ -64,6 +77,7 @@ class CFont
 public:
 	char m_aFilename[512];
 	FT_Face m_FtFace;
+	int m_PixelSize; // the face is set to
 	CFontSizeData m_aSizes[NUM_FONT_SIZES];
 };
 
@@ -108,6 +122,9 @@ class CTextRender : public IEngineTextRender
 
 	FT_Library m_FTLibrary;
 
+	// time of the current text call, for the touch times of the characters
+	int64 m_Now;
+
 	int GetFontSizeIndex(int Pixelsize)
 	{
 		for(unsigned i = 0; i < NUM_FONT_SIZES; i++)
@@ -150,8 +167,6 @@ class CTextRender : public IEngineTextRender
 		static int FontMemoryUsage = 0;
 		int Width = CharWidth*Xchars;
 		int Height = CharHeight*Ychars;
-		void *pMem = mem_alloc(Width*Height, 1);
-		mem_zero(pMem, Width*Height);
 
 		for(int i = 0; i < 2; i++)
 		{
@@ -160,8 +175,12 @@ class CTextRender : public IEngineTextRender
 				Graphics()->UnloadTexture(&(pSizeData->m_aTextures[i]));
 				FontMemoryUsage -= pSizeData->m_TextureWidth*pSizeData->m_TextureHeight;
 			}
+			if(pSizeData->m_apTextureData[i])
+				mem_free(pSizeData->m_apTextureData[i]);
 
-			pSizeData->m_aTextures[i] = Graphics()->LoadTextureRaw(Width, Height, CImageInfo::FORMAT_ALPHA, pMem, CImageInfo::FORMAT_ALPHA, IGraphics::TEXLOAD_NOMIPMAPS);
+			pSizeData->m_apTextureData[i] = (unsigned char *)mem_alloc(Width*Height, 1);
+			mem_zero(pSizeData->m_apTextureData[i], Width*Height);
+			pSizeData->m_aTextures[i] = Graphics()->LoadTextureRaw(Width, Height, CImageInfo::FORMAT_ALPHA, pSizeData->m_apTextureData[i], CImageInfo::FORMAT_ALPHA, IGraphics::TEXLOAD_NOMIPMAPS);
 			FontMemoryUsage += Width*Height;
 		}
 
@@ -169,11 +188,17 @@ class CTextRender : public IEngineTextRender
 		pSizeData->m_NumYChars = Ychars;
 		pSizeData->m_TextureWidth = Width;
 		pSizeData->m_TextureHeight = Height;
+		pSizeData->m_DirtyTop = Height;
+		pSizeData->m_DirtyBottom = 0;
+
+		// all characters are gone with the old textures
 		pSizeData->m_CurrentCharacter = 0;
+		for(int i = 0; i < CHAR_HASH_SIZE; i++)
+			pSizeData->m_aCharHash[i] = -1;
+		pSizeData->m_LruFirst = -1;
+		pSizeData->m_LruLast = -1;
 
 		dbg_msg("", "pFont memory usage: %d", FontMemoryUsage);
-
-		mem_free(pMem);
 	}
 
 	int AdjustOutlineThicknessToFontSize(int OutlineThickness, int FontSize)
@@ -201,7 +226,7 @@ class CTextRender : public IEngineTextRender
 		CFontSizeData *pSizeData = &pFont->m_aSizes[Index];
 
 		pSizeData->m_FontSize = aFontSizes[Index];
-		FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, pSizeData->m_FontSize);
+		RenderSetup(pFont, pSizeData->m_FontSize);
 
 		int OutlineThickness = AdjustOutlineThicknessToFontSize(1, pSizeData->m_FontSize);
 
@@ -242,21 +267,72 @@ class CTextRender : public IEngineTextRender
 	}
 
 
-	void UploadGlyph(CFontSizeData *pSizeData, int Texnum, int SlotID, int Chr, const void *pData)
+	void UploadGlyph(CFontSizeData *pSizeData, int Texnum, int SlotID, int Chr, const unsigned char *pData)
+	{
+		int SlotW = pSizeData->m_TextureWidth/pSizeData->m_NumXChars;
+		int SlotH = pSizeData->m_TextureHeight/pSizeData->m_NumYChars;
+		int x = (SlotID%pSizeData->m_NumXChars) * SlotW;
+		int y = (SlotID/pSizeData->m_NumXChars) * SlotH;
+
+		// the texture gets it with the next FlushGlyphs
+		for(int Row = 0; Row < SlotH; Row++)
+			mem_copy(&pSizeData->m_apTextureData[Texnum][(y+Row)*pSizeData->m_TextureWidth+x], &pData[Row*SlotW], SlotW);
+		pSizeData->m_DirtyTop = min(pSizeData->m_DirtyTop, y);
+		pSizeData->m_DirtyBottom = max(pSizeData->m_DirtyBottom, y+SlotH);
+	}
+
+	// uploads the rows with new glyphs, has to happen before quads with them get drawn
+	void FlushGlyphs(CFontSizeData *pSizeData)
+	{
+		if(pSizeData->m_DirtyTop >= pSizeData->m_DirtyBottom)
+			return;
+
+		int Offset = pSizeData->m_DirtyTop*pSizeData->m_TextureWidth;
+		for(int i = 0; i < 2; i++)
+			Graphics()->LoadTextureRawSub(pSizeData->m_aTextures[i], 0, pSizeData->m_DirtyTop, pSizeData->m_TextureWidth,
+				pSizeData->m_DirtyBottom-pSizeData->m_DirtyTop, CImageInfo::FORMAT_ALPHA, pSizeData->m_apTextureData[i]+Offset);
+		pSizeData->m_DirtyTop = pSizeData->m_TextureHeight;
+		pSizeData->m_DirtyBottom = 0;
+	}
+
+	void LruUnlink(CFontSizeData *pSizeData, int SlotID)
+	{
+		CFontChar *pChr = &pSizeData->m_aCharacters[SlotID];
+		if(pChr->m_LruPrev != -1)
+			pSizeData->m_aCharacters[pChr->m_LruPrev].m_LruNext = pChr->m_LruNext;
+		else
+			pSizeData->m_LruFirst = pChr->m_LruNext;
+		if(pChr->m_LruNext != -1)
+			pSizeData->m_aCharacters[pChr->m_LruNext].m_LruPrev = pChr->m_LruPrev;
+		else
+			pSizeData->m_LruLast = pChr->m_LruPrev;
+	}
+
+	void LruPushFront(CFontSizeData *pSizeData, int SlotID)
+	{
+		CFontChar *pChr = &pSizeData->m_aCharacters[SlotID];
+		pChr->m_LruPrev = -1;
+		pChr->m_LruNext = pSizeData->m_LruFirst;
+		if(pSizeData->m_LruFirst != -1)
+			pSizeData->m_aCharacters[pSizeData->m_LruFirst].m_LruPrev = SlotID;
+		else
+			pSizeData->m_LruLast = SlotID;
+		pSizeData->m_LruFirst = SlotID;
+	}
+
+	void HashInsert(CFontSizeData *pSizeData, int SlotID)
 	{
-		int x = (SlotID%pSizeData->m_NumXChars) * (pSizeData->m_TextureWidth/pSizeData->m_NumXChars);
-		int y = (SlotID/pSizeData->m_NumXChars) * (pSizeData->m_TextureHeight/pSizeData->m_NumYChars);
+		int *pBucket = &pSizeData->m_aCharHash[pSizeData->m_aCharacters[SlotID].m_ID&(CHAR_HASH_SIZE-1)];
+		pSizeData->m_aCharacters[SlotID].m_HashNext = *pBucket;
+		*pBucket = SlotID;
+	}
 
-		Graphics()->LoadTextureRawSub(pSizeData->m_aTextures[Texnum], x, y,
-			pSizeData->m_TextureWidth/pSizeData->m_NumXChars,
-			pSizeData->m_TextureHeight/pSizeData->m_NumYChars,
-			CImageInfo::FORMAT_ALPHA, pData);
-		/*
-		glBindTexture(GL_TEXTURE_2D, pSizeData->m_aTextures[Texnum]);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y,
-			pSizeData->m_TextureWidth/pSizeData->m_NumXChars,
-			pSizeData->m_TextureHeight/pSizeData->m_NumYChars,
-			m_FontTextureFormat, GL_UNSIGNED_BYTE, pData);*/
+	void HashRemove(CFontSizeData *pSizeData, int SlotID)
+	{
+		int *pLink = &pSizeData->m_aCharHash[pSizeData->m_aCharacters[SlotID].m_ID&(CHAR_HASH_SIZE-1)];
+		while(*pLink != SlotID)
+			pLink = &pSizeData->m_aCharacters[*pLink].m_HashNext;
+		*pLink = pSizeData->m_aCharacters[SlotID].m_HashNext;
 	}
 
 	// 32k of data used for rendering glyphs
@@ -273,23 +349,18 @@ class CTextRender : public IEngineTextRender
 			return i;
 		}
 
-		// kick out the oldest
-		// TODO: remove this linear search
+		// kick out the oldest, the texture grows instead if it got used within the last second
 		{
-			int Oldest = 0;
-			for(int i = 1; i < CharCount; i++)
-			{
-				if(pSizeData->m_aCharacters[i].m_TouchTime < pSizeData->m_aCharacters[Oldest].m_TouchTime)
-					Oldest = i;
-			}
-
-			if(time_get()-pSizeData->m_aCharacters[Oldest].m_TouchTime < time_freq() &&
+			int Oldest = pSizeData->m_LruLast;
+			if(m_Now-pSizeData->m_aCharacters[Oldest].m_TouchTime < time_freq() &&
 				(pSizeData->m_NumXChars < MAX_CHARACTERS || pSizeData->m_NumYChars < MAX_CHARACTERS))
 			{
 				IncreaseTextureSize(pSizeData);
 				return GetSlot(pSizeData);
 			}
 
+			LruUnlink(pSizeData, Oldest);
+			HashRemove(pSizeData, Oldest);
 			return Oldest;
 		}
 	}
@@ -305,7 +376,7 @@ class CTextRender : public IEngineTextRender
 		int y = 1;
 		unsigned int px, py;
 
-		FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, pSizeData->m_FontSize);
+		RenderSetup(pFont, pSizeData->m_FontSize);
 
 		if(FT_Load_Char(pFont->m_FtFace, Chr, FT_LOAD_RENDER|FT_LOAD_NO_BITMAP))
 		{
@@ -388,45 +459,46 @@ class CTextRender : public IEngineTextRender
 			pFontchr->m_aUvs[3] = pFontchr->m_aUvs[1] + Height*Vscale;
 		}
 
+		HashInsert(pSizeData, SlotID);
+		LruPushFront(pSizeData, SlotID);
 		return SlotID;
 	}
 
 	CFontChar *GetChar(CFont *pFont, CFontSizeData *pSizeData, int Chr)
 	{
-		CFontChar *pFontchr = NULL;
-
 		// search for the character
-		// TODO: remove this linear search
-		int i;
-		for(i = 0; i < pSizeData->m_CurrentCharacter; i++)
-		{
-			if(pSizeData->m_aCharacters[i].m_ID == Chr)
-			{
-				pFontchr = &pSizeData->m_aCharacters[i];
-				break;
-			}
-		}
+		int Index = pSizeData->m_aCharHash[Chr&(CHAR_HASH_SIZE-1)];
+		while(Index != -1 && pSizeData->m_aCharacters[Index].m_ID != Chr)
+			Index = pSizeData->m_aCharacters[Index].m_HashNext;
 
 		// check if we need to render the character
-		if(!pFontchr)
+		if(Index == -1)
 		{
-			int Index = RenderGlyph(pFont, pSizeData, Chr);
-			if(Index >= 0)
-				pFontchr = &pSizeData->m_aCharacters[Index];
+			Index = RenderGlyph(pFont, pSizeData, Chr);
+			if(Index < 0)
+				return 0;
+		}
+		else if(pSizeData->m_LruFirst != Index)
+		{
+			LruUnlink(pSizeData, Index);
+			LruPushFront(pSizeData, Index);
 		}
 
 		// touch the character
-		// TODO: don't call time_get here
-		if(pFontchr)
-			pFontchr->m_TouchTime = time_get();
-
+		CFontChar *pFontchr = &pSizeData->m_aCharacters[Index];
+		pFontchr->m_TouchTime = m_Now;
 		return pFontchr;
 	}
 
 	// must only be called from the rendering function as the pFont must be set to the correct size
 	void RenderSetup(CFont *pFont, int size)
 	{
-		FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, size);
+		// the face keeps its size, glyphs of the same size in a row don't have to set it again
+		if(pFont->m_PixelSize != size)
+		{
+			FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, size);
+			pFont->m_PixelSize = size;
+		}
 	}
 
 	float Kerning(CFont *pFont, int Left, int Right)
@@ -452,6 +524,7 @@ public:
 		m_TextOutlineA = 0.3f;
 
 		m_pDefaultFont = 0;
+		m_Now = 0;
 
 		// GL_LUMINANCE can be good for debugging
 		//m_FontTextureFormat = GL_ALPHA;
@@ -640,6 +713,7 @@ public:
 		if(!pFont)
 			return;
 
+		m_Now = time_get();
 		pSizeData = GetSize(pFont, ActualSize);
 		RenderSetup(pFont, ActualSize);
 		*pFontTexture = pSizeData->m_aTextures[0];
@@ -762,6 +836,9 @@ public:
 			}
 		}
 
+		// the quads get drawn by the caller
+		FlushGlyphs(pSizeData);
+
 		pCursor->m_X = DrawX;
 		pCursor->m_LineCount = LineCount;
 
@@ -811,6 +888,7 @@ public:
 		if(!pFont)
 			return;
 
+		m_Now = time_get();
 		pSizeData = GetSize(pFont, ActualSize);
 		RenderSetup(pFont, ActualSize);
 
@@ -945,7 +1023,10 @@ public:
 			}
 
 			if(pCursor->m_Flags&TEXTFLAG_RENDER)
+			{
+				FlushGlyphs(pSizeData);
 				Graphics()->QuadsEnd();
+			}
 		}
 
 		pCursor->m_X = DrawX;
@@ -981,6 +1062,7 @@ public:
 		if(!pFont)
 			return 0;
 
+		m_Now = time_get();
 		pSizeData = GetSize(pFont, ActualSize);
 		RenderSetup(pFont, ActualSize);
 		CFontChar *pChr = GetChar(pFont, pSizeData, ' ');
@@ -174,6 +174,56 @@ public:
 	virtual void SetColor(float r, float g, float b, float a) = 0;
 	virtual void SetColor4(vec4 TopLeft, vec4 TopRight, vec4 BottomLeft, vec4 BottomRight) = 0;
 
+	/* Quad buffers
+		Quads that stay the same for a long time, like the tiles of a map layer. They are
+		stored once and drawn in ranges with the current texture, blending, clipping and
+		screen, without being copied into the command buffer every frame. */
+	class CQuadBufferHandle
+	{
+		friend class IGraphics;
+		int m_Id;
+	public:
+		CQuadBufferHandle()
+		: m_Id(-1)
+		{}
+
+		bool IsValid() const { return Id() >= 0; }
+		int Id() const { return m_Id; }
+		void Invalidate() { m_Id = -1; }
+	};
+
+	struct CQuadBufferItem
+	{
+		CQuadItem m_Quad; // top left corner and size
+		float m_aTexCoords[8]; // u and v of the corners, in the order of QuadsSetSubsetFree
+		int m_TextureIndex;
+	};
+
+	struct CQuadBufferRange
+	{
+		int m_First;
+		int m_Num;
+	};
+
+	// returns an invalid handle if the quads can't be buffered, they have to be drawn the usual way then
+	virtual CQuadBufferHandle CreateQuadBuffer(const CQuadBufferItem *pItems, int Num) = 0;
+	virtual void DestroyQuadBuffer(CQuadBufferHandle *pBuffer) = 0;
+	virtual void QuadBufferDraw(CQuadBufferHandle Buffer, const CQuadBufferRange *pRanges, int NumRanges, vec4 Color) = 0;
+
+	// draws of the last frame and the render commands they took, fewer with gfx_batch_draws
+	virtual void GetDrawStats(int *pNumDraws, int *pNumRenderCommands) const = 0;
+
+	struct CFrameStats
+	{
+		int64 m_SubmitTime; // main thread time of the frame, without the waits for the backend
+		int64 m_WaitTime;
+		int m_QueueDepth; // command buffers the backend had to get through when the frame was done
+		int m_NumCommandBuffers;
+	};
+
+	// of the last frame, times in time_get() units
+	virtual void GetFrameStats(CFrameStats *pStats) const = 0;
+
 	virtual void ReadBackbuffer(unsigned char **ppPixels, int x, int y, int w, int h) = 0;
 	virtual void TakeScreenshot(const char *pFilename) = 0;
 	virtual int GetVideoModes(CVideoMode *pModes, int MaxModes, int Screen) = 0;
@@ -194,6 +244,13 @@ protected:
 		Tex.m_Id = Index;
 		return Tex;
 	}
+
+	inline CQuadBufferHandle CreateQuadBufferHandle(int Index)
+	{
+		CQuadBufferHandle Buffer;
+		Buffer.m_Id = Index;
+		return Buffer;
+	}
 };
 
 class IEngineGraphics : public IGraphics
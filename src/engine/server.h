@@ -4,6 +4,9 @@
 #define ENGINE_SERVER_H
 #include "kernel.h"
 #include "message.h"
+#include "shared/protocol.h"
+
+class CProfiler;
 
 class IServer : public IInterface
 {
@@ -53,6 +56,7 @@ public:
 	virtual int SnapNewID() = 0;
 	virtual void SnapFreeID(int ID) = 0;
 	virtual void *SnapNewItem(int Type, int ID, int Size) = 0;
+	virtual void *SnapNewSharedItem(int Type, int ID, int Size, const CClientMask &ClientMask) = 0;
 
 	virtual void SnapSetStaticsize(int ItemType, int Size) = 0;
 
@@ -68,6 +72,9 @@ public:
 
 	virtual void DemoRecorder_HandleAutoStart() = 0;
 	virtual bool DemoRecorder_IsRecording() = 0;
+
+	// times the parts of a tick, see engine/shared/profiler.h
+	virtual CProfiler *Profiler() = 0;
 };
 
 class IGameServer : public IInterface
@@ -81,9 +88,14 @@ public:
 
 	virtual void OnTick() = 0;
 	virtual void OnPreSnap() = 0;
+	virtual void OnSnapShared() = 0;
 	virtual void OnSnap(int ClientID) = 0;
 	virtual void OnPostSnap() = 0;
 
+	// how much a client needs to get the changes of a snapshot item when it can't get all
+	// of them. higher goes first, -1 for items that always have to be sent
+	virtual int SnapItemPriority(int ClientID, int Type, int ID, const void *pData, int Size) = 0;
+
 	virtual void OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID) = 0;
 
 	virtual void OnClientConnected(int ClientID, bool AsSpec) = 0;
@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <algorithm>
 
 #include <base/math.h>
 #include <base/system.h>
@@ -18,10 +19,12 @@
 #include <engine/shared/demo.h>
 #include <engine/shared/econ.h>
 #include <engine/shared/filecollection.h>
+#include <engine/shared/jobs.h>
 #include <engine/shared/mapchecker.h>
 #include <engine/shared/netban.h>
 #include <engine/shared/network.h>
 #include <engine/shared/packer.h>
+#include <engine/shared/profiler.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/snapshot.h>
 
@@ -30,11 +33,6 @@
 #include "register.h"
 #include "server.h"
 
-#if defined(CONF_FAMILY_WINDOWS)
-	#define WIN32_LEAN_AND_MEAN
-	#include <windows.h>
-#endif
-
 /*static const char *StrLtrim(const char *pStr)
 {
 	while(*pStr && *pStr >= 0 && *pStr <= 32)
@@ -144,6 +142,46 @@ void CSnapIDPool::FreeID(int ID)
 }
 
 
+void CSnapSharedItems::Clear()
+{
+	m_DataSize = 0;
+	m_NumItems = 0;
+}
+
+void *CSnapSharedItems::NewItem(int Type, int ID, int Size, const CClientMask &ClientMask)
+{
+	if(m_NumItems == MAX_ITEMS || m_DataSize+Size > MAX_DATASIZE)
+	{
+		dbg_msg("server", "shared snapshot items overflow");
+		return 0;
+	}
+
+	int *pData = &m_aData[m_DataSize/sizeof(int)];
+	mem_zero(pData, Size);
+	m_aKeys[m_NumItems] = (Type<<16)|(ID&0xffff);
+	m_aOffsets[m_NumItems] = m_DataSize;
+	m_aSizes[m_NumItems] = Size;
+	m_aClientMasks[m_NumItems] = ClientMask;
+	m_DataSize += Size;
+	m_NumItems++;
+	return pData;
+}
+
+void CSnapSharedItems::Filter(CSnapshotBuilder *pBuilder, int ClientID) const
+{
+	for(int i = 0; i < m_NumItems; i++)
+	{
+		if(!m_aClientMasks[i].IsSet(ClientID))
+			continue;
+
+		void *pData = pBuilder->NewItem(m_aKeys[i]>>16, m_aKeys[i]&0xffff, m_aSizes[i]);
+		if(!pData)
+			return;
+		mem_copy(pData, &m_aData[m_aOffsets[i]/sizeof(int)], m_aSizes[i]);
+	}
+}
+
+
 void CServerBan::InitServerBan(IConsole *pConsole, IStorage *pStorage, CServer* pServer)
 {
 	CNetBan::Init(pConsole, pStorage);
@@ -255,19 +293,97 @@ void CServerBan::ConBanExt(IConsole::IResult *pResult, void *pUser)
 void CServer::CClient::Reset()
 {
 	// reset input
-	for(int i = 0; i < 200; i++)
+	for(int i = 0; i < INPUT_RING_SIZE; i++)
 		m_aInputs[i].m_GameTick = -1;
-	m_CurrentInput = 0;
 	mem_zero(&m_LatestInput, sizeof(m_LatestInput));
+	m_NumLateInputs = 0;
+	m_NumEarlyInputs = 0;
+	m_NumDuplicateInputs = 0;
 
 	m_Snapshots.PurgeAll();
 	m_LastAckedSnapshot = -1;
+	m_LastSnapshot = -1;
 	m_LastInputTick = -1;
 	m_SnapRate = CClient::SNAPRATE_INIT;
+	m_SnapBudget = 0;
+	m_SnapBudgetTick = -1;
+	m_SnapCompression = 0.5f;
+	m_SnapRtt = -1;
+	m_aSnapMinRtt[0] = -1;
+	m_aSnapMinRtt[1] = -1;
+	m_SnapMinRttStart = -1;
+	m_SnapLoss = 0.0f;
+	m_NumDeferredItems = 0;
 	m_Score = 0;
 	m_MapChunk = 0;
 }
 
+void CServer::CClient::AddInput(int IntendedTick, int CurrentTick, int Size)
+{
+	// inputs that missed their tick get applied on the next one
+	bool Late = IntendedTick <= CurrentTick;
+	if(Late)
+	{
+		IntendedTick = CurrentTick+1;
+		m_NumLateInputs++;
+	}
+	else if(IntendedTick-CurrentTick >= INPUT_RING_SIZE)
+	{
+		m_NumEarlyInputs++;
+		return;
+	}
+
+	CInput *pInput = &m_aInputs[IntendedTick&(INPUT_RING_SIZE-1)];
+	if(pInput->m_GameTick == IntendedTick && !pInput->m_Late)
+	{
+		// the first input that arrived in time for a tick wins
+		if(!Late)
+			m_NumDuplicateInputs++;
+		return;
+	}
+
+	// a fresher input replaces a late one that got moved to this tick
+	pInput->m_GameTick = IntendedTick;
+	pInput->m_Late = Late;
+	mem_copy(pInput->m_aData, m_LatestInput.m_aData, Size*sizeof(int));
+}
+
+CServer::CClient::CInput *CServer::CClient::GetInput(int Tick)
+{
+	CInput *pInput = &m_aInputs[Tick&(INPUT_RING_SIZE-1)];
+	return pInput->m_GameTick == Tick ? pInput : 0;
+}
+
+int64 CServer::CClient::SnapMinRtt() const
+{
+	return m_aSnapMinRtt[1] < 0 ? m_aSnapMinRtt[0] : min(m_aSnapMinRtt[0], m_aSnapMinRtt[1]);
+}
+
+void CServer::CClient::AckSnapshot(int PrevAckedSnapshot, int64 Rtt, int64 Now)
+{
+	// the minimum starts over every window, so after a route change the
+	// longer way stops looking like queueing after two windows at most
+	m_SnapRtt = m_SnapRtt < 0 ? Rtt : m_SnapRtt+(Rtt-m_SnapRtt)/8;
+	if(m_SnapMinRttStart < 0 || Now-m_SnapMinRttStart >= SNAP_RTT_WINDOW*time_freq())
+	{
+		m_aSnapMinRtt[1] = m_aSnapMinRtt[0];
+		m_aSnapMinRtt[0] = Rtt;
+		m_SnapMinRttStart = Now;
+	}
+	else
+		m_aSnapMinRtt[0] = min(m_aSnapMinRtt[0], Rtt);
+
+	// the client acks the newest snapshot it has, the ones that were sent
+	// since the last ack and got skipped count as lost
+	if(PrevAckedSnapshot < 0)
+		return;
+	for(int Tick = max(PrevAckedSnapshot+1, m_LastAckedSnapshot-(int)CSnapshotRing::MAX_TICKS); Tick <= m_LastAckedSnapshot; Tick++)
+	{
+		if(m_Snapshots.Get(Tick, 0, 0) >= 0)
+			m_SnapLoss += ((Tick == m_LastAckedSnapshot ? 0.0f : 1.0f)-m_SnapLoss)/16.0f;
+	}
+}
+
 CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 {
 	m_TickSpeed = SERVER_TICK_SPEED;
@@ -276,10 +392,15 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 
 	m_CurrentGameTick = 0;
 	m_RunServer = 1;
+	m_BenchmarkClients = 0;
 
 	m_pCurrentMapData = 0;
 	m_CurrentMapSize = 0;
 
+	m_pSnapClients = 0;
+	m_NumBudgetedSnapshots = 0;
+	m_NumDeferredItems = 0;
+
 	m_NumMapEntries = 0;
 	m_pFirstMapEntry = 0;
 	m_pLastMapEntry = 0;
@@ -373,7 +494,7 @@ int CServer::Init()
 		m_aClients[i].m_aName[0] = 0;
 		m_aClients[i].m_aClan[0] = 0;
 		m_aClients[i].m_Country = -1;
-		m_aClients[i].m_Snapshots.Init();
+		m_aClients[i].m_Snapshots.Init(&m_SnapshotPool);
 	}
 
 	m_CurrentGameTick = 0;
@@ -461,7 +582,7 @@ bool CServer::ClientIngame(int ClientID) const
 
 int CServer::MaxClients() const
 {
-	return m_NetServer.MaxClients();
+	return m_BenchmarkClients ? m_BenchmarkClients : m_NetServer.MaxClients();
 }
 
 void CServer::InitRconPasswordIfUnset()
@@ -514,7 +635,7 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 	if(!(Flags&MSGFLAG_NORECORD))
 		m_DemoRecorder.RecordMessage(pMsg->Data(), pMsg->Size());
 
-	if(!(Flags&MSGFLAG_NOSEND))
+	if(!(Flags&MSGFLAG_NOSEND) && !m_BenchmarkClients)
 	{
 		if(ClientID == -1)
 		{
@@ -533,8 +654,250 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 	return 0;
 }
 
+int CServer::SnapDeltaJob(void *pUser)
+{
+	CSnapJob *pJob = (CSnapJob *)pUser;
+	pJob->m_pServer->CreateSnapDeltas(pJob);
+	return 0;
+}
+
+void CServer::CreateSnapDeltas(CSnapJob *pJob)
+{
+	for(int i = pJob->m_First; i < m_NumSnapClients; i += pJob->m_Step)
+	{
+		CSnapClient *pSnapClient = &m_pSnapClients[i];
+		pSnapClient->m_Crc = pSnapClient->m_pSnapshot->Crc();
+
+		// create delta
+		int DeltaSize = m_SnapshotDelta.CreateDelta(pSnapClient->m_pDeltashot, pSnapClient->m_pSnapshot, pJob->m_aDeltaData);
+		pSnapClient->m_DeltaSize = DeltaSize;
+
+		// compress it
+		if(DeltaSize)
+			pSnapClient->m_CompSize = CVariableInt::Compress(pJob->m_aDeltaData, DeltaSize, pSnapClient->m_aCompData, sizeof(pSnapClient->m_aCompData));
+		else
+			pSnapClient->m_CompSize = 0;
+	}
+}
+
+void CServer::SendSnapshot(const CSnapClient *pSnapClient)
+{
+	int ClientID = pSnapClient->m_ClientID;
+	int DeltaTick = pSnapClient->m_DeltaTick;
+
+	if(pSnapClient->m_CompSize)
+	{
+		const int SnapshotSize = pSnapClient->m_CompSize;
+		const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
+		const int NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
+
+		for(int n = 0, Left = SnapshotSize; Left > 0; n++)
+		{
+			int Chunk = Left < MaxSize ? Left : MaxSize;
+			Left -= Chunk;
+
+			if(NumPackets == 1)
+			{
+				CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
+				Msg.AddInt(m_CurrentGameTick);
+				Msg.AddInt(m_CurrentGameTick-DeltaTick);
+				Msg.AddInt(pSnapClient->m_Crc);
+				Msg.AddInt(Chunk);
+				Msg.AddRaw(&pSnapClient->m_aCompData[n*MaxSize], Chunk);
+				SendMsg(&Msg, MSGFLAG_FLUSH, ClientID);
+			}
+			else
+			{
+				CMsgPacker Msg(NETMSG_SNAP, true);
+				Msg.AddInt(m_CurrentGameTick);
+				Msg.AddInt(m_CurrentGameTick-DeltaTick);
+				Msg.AddInt(NumPackets);
+				Msg.AddInt(n);
+				Msg.AddInt(pSnapClient->m_Crc);
+				Msg.AddInt(Chunk);
+				Msg.AddRaw(&pSnapClient->m_aCompData[n*MaxSize], Chunk);
+				SendMsg(&Msg, MSGFLAG_FLUSH, ClientID);
+			}
+		}
+	}
+	else
+	{
+		CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
+		Msg.AddInt(m_CurrentGameTick);
+		Msg.AddInt(m_CurrentGameTick-DeltaTick);
+		SendMsg(&Msg, MSGFLAG_FLUSH, ClientID);
+	}
+}
+
+int CServer::SnapBudget(int ClientID) const
+{
+	// back off when snapshots get lost or the round trip grows over the shortest recent one
+	const CClient *pClient = &m_aClients[ClientID];
+	float BytesPerSecond = g_Config.m_SvSnapBudget;
+	BytesPerSecond *= 1.0f-min(pClient->m_SnapLoss*4.0f, 0.75f);
+	if(pClient->m_SnapRtt >= 0)
+	{
+		int64 Queued = pClient->m_SnapRtt-pClient->SnapMinRtt();
+		int64 MaxQueued = time_freq()/10;
+		if(Queued > MaxQueued)
+			BytesPerSecond *= max(MaxQueued/(float)Queued, 0.25f);
+	}
+	return (int)BytesPerSecond;
+}
+
+bool CServer::CompareBudgetItems(const CBudgetItem *pA, const CBudgetItem *pB)
+{
+	return pA->m_Score > pB->m_Score;
+}
+
+int CServer::BudgetSnapshot(int ClientID, CSnapshot *pSnap, int SnapSize)
+{
+	CClient *pClient = &m_aClients[ClientID];
+
+	// refill, a client that got nothing for a while can't save up more than a fifth of a second
+	int BytesPerSecond = SnapBudget(ClientID);
+	if(pClient->m_SnapBudgetTick == -1)
+		pClient->m_SnapBudget = BytesPerSecond/5;
+	else
+	{
+		int Ticks = min(Tick()-pClient->m_SnapBudgetTick, (int)SERVER_TICK_SPEED);
+		pClient->m_SnapBudget = min(pClient->m_SnapBudget+BytesPerSecond*Ticks/SERVER_TICK_SPEED, BytesPerSecond/5);
+	}
+	pClient->m_SnapBudgetTick = Tick();
+
+	// without a snapshot the client has there is nothing to hold back. the delta goes against
+	// the acked snapshot, but the client may have got newer ones since and must not go back
+	// to an older version of an item, only items that look the same in both can wait
+	CSnapshot *pBase;
+	CSnapshot *pLast;
+	if(pClient->m_Snapshots.Get(pClient->m_LastAckedSnapshot, 0, &pBase) < 0 ||
+		pClient->m_Snapshots.Get(pClient->m_LastSnapshot, 0, &pLast) < 0)
+	{
+		pClient->m_NumDeferredItems = 0;
+		return SnapSize;
+	}
+
+	// what the delta against the acked snapshot costs, the same way CSnapshotDelta writes it
+	int NumChanged = 0;
+	int Cost = 3*sizeof(int);
+	for(int i = 0, b = 0; i < pSnap->NumItems() || b < pBase->NumItems(); )
+	{
+		int Key = i < pSnap->NumItems() ? pSnap->GetItem(i)->Key() : -1;
+		int BaseKey = b < pBase->NumItems() ? pBase->GetItem(b)->Key() : -1;
+		if(Key == -1 || (BaseKey != -1 && BaseKey < Key))
+		{
+			// deleted
+			Cost += sizeof(int);
+			b++;
+			continue;
+		}
+
+		int Size = pSnap->GetItemSize(i);
+		int BaseIndex = -1;
+		if(Key == BaseKey)
+		{
+			BaseIndex = b++;
+			if(pBase->GetItemSize(BaseIndex) == Size && mem_comp(pSnap->GetItem(i)->Data(), pBase->GetItem(BaseIndex)->Data(), Size) == 0)
+			{
+				i++;
+				continue;
+			}
+		}
+
+		CBudgetItem *pItem = &m_aBudgetItems[NumChanged++];
+		pItem->m_Index = i++;
+		pItem->m_BaseIndex = BaseIndex;
+		pItem->m_Cost = 3*sizeof(int)+Size;
+		pItem->m_Deferrable = true;
+		pItem->m_Deferred = false;
+		Cost += pItem->m_Cost;
+
+		if(pLast != pBase)
+		{
+			int LastIndex = pLast->GetItemIndex(Key);
+			if(BaseIndex == -1)
+				pItem->m_Deferrable = LastIndex == -1;
+			else
+				pItem->m_Deferrable = LastIndex != -1 && pLast->GetItemSize(LastIndex) == pBase->GetItemSize(BaseIndex) &&
+					mem_comp(pLast->GetItem(LastIndex)->Data(), pBase->GetItem(BaseIndex)->Data(), pBase->GetItemSize(BaseIndex)) == 0;
+		}
+	}
+
+	int Budget = pClient->m_SnapBudget;
+	if(Cost*pClient->m_SnapCompression <= Budget)
+	{
+		pClient->m_NumDeferredItems = 0;
+		return SnapSize;
+	}
+
+	// over the budget, rank the changes by what the game makes of them and how long they waited
+	for(int c = 0, d = 0; c < NumChanged; c++)
+	{
+		CBudgetItem *pItem = &m_aBudgetItems[c];
+		const CSnapshotItem *pSnapItem = pSnap->GetItem(pItem->m_Index);
+		while(d < pClient->m_NumDeferredItems && pClient->m_aDeferredKeys[d] < pSnapItem->Key())
+			d++;
+		pItem->m_DeferTick = d < pClient->m_NumDeferredItems && pClient->m_aDeferredKeys[d] == pSnapItem->Key() ? pClient->m_aDeferredTicks[d] : -1;
+
+		int Priority = GameServer()->SnapItemPriority(ClientID, pSnapItem->Type(), pSnapItem->ID(), pSnapItem->Data(), pSnap->GetItemSize(pItem->m_Index));
+		int Age = pItem->m_DeferTick == -1 ? 0 : Tick()-pItem->m_DeferTick;
+		if(!pItem->m_Deferrable || Priority == -1 || Age >= MAX_SNAP_DEFER_TICKS)
+			pItem->m_Score = 0x7fffffff;
+		else
+			pItem->m_Score = Priority+Age*SNAP_DEFER_AGE_WEIGHT;
+		m_apBudgetOrder[c] = pItem;
+	}
+	std::stable_sort(m_apBudgetOrder, m_apBudgetOrder+NumChanged, CompareBudgetItems);
+
+	// take what fits, the rest keeps the version the client has
+	float Spent = 0.0f;
+	for(int c = 0; c < NumChanged; c++)
+	{
+		CBudgetItem *pItem = m_apBudgetOrder[c];
+		float ItemCost = pItem->m_Cost*pClient->m_SnapCompression;
+		if(pItem->m_Score == 0x7fffffff || Spent+ItemCost <= Budget)
+			Spent += ItemCost;
+		else
+			pItem->m_Deferred = true;
+	}
+
+	m_BudgetBuilder.Init();
+	int NumDeferred = 0;
+	for(int i = 0, c = 0; i < pSnap->NumItems(); i++)
+	{
+		const CSnapshotItem *pItem = pSnap->GetItem(i);
+		int Size = pSnap->GetItemSize(i);
+		if(c < NumChanged && m_aBudgetItems[c].m_Index == i)
+		{
+			CBudgetItem *pChanged = &m_aBudgetItems[c++];
+			if(pChanged->m_Deferred && NumDeferred < CClient::MAX_DEFERRED_ITEMS)
+			{
+				pClient->m_aDeferredKeys[NumDeferred] = pItem->Key();
+				pClient->m_aDeferredTicks[NumDeferred] = pChanged->m_DeferTick == -1 ? Tick() : pChanged->m_DeferTick;
+				NumDeferred++;
+
+				if(pChanged->m_BaseIndex == -1)
+					continue;
+				pItem = pBase->GetItem(pChanged->m_BaseIndex);
+				Size = pBase->GetItemSize(pChanged->m_BaseIndex);
+			}
+		}
+
+		void *pData = m_BudgetBuilder.NewItem(pItem->Type(), pItem->ID(), Size);
+		if(pData)
+			mem_copy(pData, pItem->Data(), Size);
+	}
+	pClient->m_NumDeferredItems = NumDeferred;
+
+	m_NumBudgetedSnapshots++;
+	m_NumDeferredItems += NumDeferred;
+	return m_BudgetBuilder.Finish(pSnap);
+}
+
 void CServer::DoSnapshot()
 {
+	CProfileScope PhaseScope(&m_Profiler, PROFILE_SNAP_BUILD);
+
 	GameServer()->OnPreSnap();
 
 	// create snapshot for demo recording
@@ -552,8 +915,16 @@ void CServer::DoSnapshot()
 		m_DemoRecorder.RecordSnapshot(Tick(), aData, SnapshotSize);
 	}
 
+	// items that look the same for every client are only snapped once
+	bool SnapShared = g_Config.m_SvSnapShared != 0;
+	bool SharedItemsBuilt = false;
+
+	static CSnapshot EmptySnap;
+	EmptySnap.Clear();
+	m_NumSnapClients = 0;
+
 	// create snapshots for all clients
-	for(int i = 0; i < MAX_CLIENTS; i++)
+	for(int i = 0; i < MaxClients(); i++)
 	{
 		// client must be ingame to recive snapshots
 		if(m_aClients[i].m_State != CClient::STATE_INGAME)
@@ -570,98 +941,108 @@ void CServer::DoSnapshot()
 		{
 			char aData[CSnapshot::MAX_SIZE];
 			CSnapshot *pData = (CSnapshot*)aData;	// Fix compiler warning for strict-aliasing
-			char aDeltaData[CSnapshot::MAX_SIZE];
-			char aCompData[CSnapshot::MAX_SIZE];
+			CSnapClient *pSnapClient = &m_pSnapClients[m_NumSnapClients++];
 			int SnapshotSize;
-			int Crc;
-			static CSnapshot EmptySnap;
-			CSnapshot *pDeltashot = &EmptySnap;
-			int DeltashotSize;
-			int DeltaTick = -1;
-			int DeltaSize;
 
 			m_SnapshotBuilder.Init();
 
+			if(SnapShared)
+			{
+				if(!SharedItemsBuilt)
+				{
+					m_SnapSharedItems.Clear();
+					GameServer()->OnSnapShared();
+					SharedItemsBuilt = true;
+				}
+				m_SnapSharedItems.Filter(&m_SnapshotBuilder, i);
+			}
+
 			GameServer()->OnSnap(i);
 
 			// finish snapshot
 			SnapshotSize = m_SnapshotBuilder.Finish(pData);
-			Crc = pData->Crc();
+
+			// hold back changes the client has no bandwidth for
+			if(g_Config.m_SvSnapBudget && m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
+				SnapshotSize = BudgetSnapshot(i, pData, SnapshotSize);
 
 			// remove old snapshos
 			// keep 3 seconds worth of snapshots
 			m_aClients[i].m_Snapshots.PurgeUntil(m_CurrentGameTick-SERVER_TICK_SPEED*3);
 
 			// save it the snapshot
-			m_aClients[i].m_Snapshots.Add(m_CurrentGameTick, time_get(), SnapshotSize, pData, 0);
+			pSnapClient->m_ClientID = i;
+			pSnapClient->m_pSnapshot = m_aClients[i].m_Snapshots.Add(m_CurrentGameTick, time_get(), SnapshotSize, pData);
+			m_aClients[i].m_LastSnapshot = m_CurrentGameTick;
+		}
+	}
 
-			// find snapshot that we can preform delta against
-			EmptySnap.Clear();
+	// find snapshots that we can preform delta against. this is done after all
+	// snapshots of this tick got stored as storing one can drop old ones
+	for(int s = 0; s < m_NumSnapClients; s++)
+	{
+		CSnapClient *pSnapClient = &m_pSnapClients[s];
+		CClient *pClient = &m_aClients[pSnapClient->m_ClientID];
 
-			{
-				DeltashotSize = m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, 0, &pDeltashot, 0);
-				if(DeltashotSize >= 0)
-					DeltaTick = m_aClients[i].m_LastAckedSnapshot;
-				else
-				{
-					// no acked package found, force client to recover rate
-					if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
-						m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
-				}
-			}
+		pSnapClient->m_pDeltashot = &EmptySnap;
+		pSnapClient->m_DeltaTick = -1;
+		if(pClient->m_Snapshots.Get(pClient->m_LastAckedSnapshot, 0, &pSnapClient->m_pDeltashot) >= 0)
+			pSnapClient->m_DeltaTick = pClient->m_LastAckedSnapshot;
+		else
+		{
+			// no acked package found, force client to recover rate
+			pSnapClient->m_pDeltashot = &EmptySnap;
+			if(pClient->m_SnapRate == CClient::SNAPRATE_FULL)
+				pClient->m_SnapRate = CClient::SNAPRATE_RECOVER;
+		}
+	}
 
-			// create delta
-			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+	// create the deltas, spread over the worker threads
+	PhaseScope.Switch(PROFILE_SNAP_DELTA);
+	if(m_NumSnapClients)
+	{
+		int NumJobs = min(m_SnapJobPool.NumThreads()+1, m_NumSnapClients);
+		for(int j = 0; j < NumJobs; j++)
+		{
+			m_aSnapJobs[j].m_pServer = this;
+			m_aSnapJobs[j].m_First = j;
+			m_aSnapJobs[j].m_Step = NumJobs;
+		}
 
-			if(DeltaSize)
-			{
-				// compress it
-				int SnapshotSize;
-				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
-				int NumPackets;
+		for(int j = 1; j < NumJobs; j++)
+			m_SnapJobPool.Add(&m_aSnapJobs[j].m_Job, SnapDeltaJob, &m_aSnapJobs[j]);
 
-				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
-				NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
+		// the main thread takes the first share
+		CreateSnapDeltas(&m_aSnapJobs[0]);
 
-				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
-				{
-					int Chunk = Left < MaxSize ? Left : MaxSize;
-					Left -= Chunk;
+		for(int j = 1; j < NumJobs; j++)
+		{
+			while(m_aSnapJobs[j].m_Job.Status() != CJob::STATE_DONE)
+				thread_yield();
+		}
 
-					if(NumPackets == 1)
-					{
-						CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick-DeltaTick);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n*MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-					else
-					{
-						CMsgPacker Msg(NETMSG_SNAP, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick-DeltaTick);
-						Msg.AddInt(NumPackets);
-						Msg.AddInt(n);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n*MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-				}
-			}
-			else
-			{
-				CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
-				Msg.AddInt(m_CurrentGameTick);
-				Msg.AddInt(m_CurrentGameTick-DeltaTick);
-				SendMsg(&Msg, MSGFLAG_FLUSH, i);
-			}
+		// pay for what got sent and learn how well the deltas compress
+		for(int s = 0; s < m_NumSnapClients; s++)
+		{
+			CSnapClient *pSnapClient = &m_pSnapClients[s];
+			CClient *pClient = &m_aClients[pSnapClient->m_ClientID];
+			if(pSnapClient->m_DeltaSize > 0)
+				pClient->m_SnapCompression += (pSnapClient->m_CompSize/(float)pSnapClient->m_DeltaSize-pClient->m_SnapCompression)/4.0f;
+			if(g_Config.m_SvSnapBudget)
+				pClient->m_SnapBudget -= pSnapClient->m_CompSize;
 		}
 	}
 
+	// send them in client order, all in one go
+	PhaseScope.Switch(PROFILE_SNAP_SEND);
+	if(!m_BenchmarkClients)
+	{
+		m_NetServer.BeginSendBatch();
+		for(int i = 0; i < m_NumSnapClients; i++)
+			SendSnapshot(&m_pSnapClients[i]);
+		m_NetServer.FlushSendBatch();
+	}
+
 	GameServer()->OnPostSnap();
 }
 
@@ -932,24 +1313,25 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 		}
 		else if(Msg == NETMSG_INPUT)
 		{
-			CClient::CInput *pInput;
+			CClient *pClient = &m_aClients[ClientID];
 			int64 TagTime;
 			int64 Now = time_get();
 
-			m_aClients[ClientID].m_LastAckedSnapshot = Unpacker.GetInt();
+			int PrevAckedSnapshot = pClient->m_LastAckedSnapshot;
+			pClient->m_LastAckedSnapshot = Unpacker.GetInt();
 			int IntendedTick = Unpacker.GetInt();
 			int Size = Unpacker.GetInt();
 
 			// check for errors
-			if(Unpacker.Error() || Size/4 > MAX_INPUT_SIZE)
+			if(Unpacker.Error() || Size < 0 || Size/4 > MAX_INPUT_SIZE)
 				return;
 
-			if(m_aClients[ClientID].m_LastAckedSnapshot > 0)
-				m_aClients[ClientID].m_SnapRate = CClient::SNAPRATE_FULL;
+			if(pClient->m_LastAckedSnapshot > 0)
+				pClient->m_SnapRate = CClient::SNAPRATE_FULL;
 
 			// add message to report the input timing
 			// skip packets that are old
-			if(IntendedTick > m_aClients[ClientID].m_LastInputTick)
+			if(IntendedTick > pClient->m_LastInputTick)
 			{
 				int TimeLeft = ((TickStartTime(IntendedTick)-Now)*1000) / time_freq();
 
@@ -959,33 +1341,27 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				SendMsg(&Msg, 0, ClientID);
 			}
 
-			m_aClients[ClientID].m_LastInputTick = IntendedTick;
-
-			pInput = &m_aClients[ClientID].m_aInputs[m_aClients[ClientID].m_CurrentInput];
-
-			if(IntendedTick <= Tick())
-				IntendedTick = Tick()+1;
-
-			pInput->m_GameTick = IntendedTick;
+			pClient->m_LastInputTick = IntendedTick;
 
 			for(int i = 0; i < Size/4; i++)
-				pInput->m_aData[i] = Unpacker.GetInt();
+				pClient->m_LatestInput.m_aData[i] = Unpacker.GetInt();
+
+			pClient->AddInput(IntendedTick, Tick(), Size/4);
 
 			int PingCorrection = clamp(Unpacker.GetInt(), 0, 50);
-			if(m_aClients[ClientID].m_Snapshots.Get(m_aClients[ClientID].m_LastAckedSnapshot, &TagTime, 0, 0) >= 0)
+			if(pClient->m_Snapshots.Get(pClient->m_LastAckedSnapshot, &TagTime, 0) >= 0)
 			{
-				m_aClients[ClientID].m_Latency = (int)(((Now-TagTime)*1000)/time_freq());
-				m_aClients[ClientID].m_Latency = max(0, m_aClients[ClientID].m_Latency - PingCorrection);
-			}
-
-			mem_copy(m_aClients[ClientID].m_LatestInput.m_aData, pInput->m_aData, MAX_INPUT_SIZE*sizeof(int));
+				pClient->m_Latency = (int)(((Now-TagTime)*1000)/time_freq());
+				pClient->m_Latency = max(0, pClient->m_Latency - PingCorrection);
 
-			m_aClients[ClientID].m_CurrentInput++;
-			m_aClients[ClientID].m_CurrentInput %= 200;
+				// every input acks a snapshot, a new ack is a fresh sample of the way
+				if(pClient->m_LastAckedSnapshot > PrevAckedSnapshot)
+					pClient->AckSnapshot(PrevAckedSnapshot, max(Now-TagTime-PingCorrection*time_freq()/1000, (int64)0), Now);
+			}
 
 			// call the mod with the fresh input data
-			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
-				GameServer()->OnClientDirectInput(ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
+			if(pClient->m_State == CClient::STATE_INGAME)
+				GameServer()->OnClientDirectInput(ClientID, pClient->m_LatestInput.m_aData);
 		}
 		else if(Msg == NETMSG_RCON_CMD)
 		{
@@ -1185,6 +1561,8 @@ void CServer::PumpNetwork()
 	CNetChunk Packet;
 	TOKEN ResponseToken;
 
+	m_NetServer.SetBatching(g_Config.m_SvNetBatch != 0);
+	m_NetServer.BeginSendBatch();
 	m_NetServer.Update();
 
 	// process packets
@@ -1219,6 +1597,7 @@ void CServer::PumpNetwork()
 		else
 			ProcessClientPacket(&Packet);
 	}
+	m_NetServer.FlushSendBatch();
 
 	m_ServerBan.Update();
 	m_Econ.Update();
@@ -1288,6 +1667,49 @@ void CServer::InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterS
 	m_Register.Init(pNetServer, pMasterServer, pConsole);
 }
 
+void CServer::InitSnapshots(int MaxClients)
+{
+	// size the snapshot buffers for the slots that can actually be used,
+	// with room for a few seconds of distinct snapshots for every client
+	int PoolEntries = 1;
+	while(PoolEntries < MaxClients*CSnapshotRing::MAX_TICKS)
+		PoolEntries <<= 1;
+	m_SnapshotPool.Init(MaxClients*CSnapshot::MAX_SIZE*4, PoolEntries);
+	m_pSnapClients = new CSnapClient[MaxClients];
+
+	m_SnapJobPool.Init(g_Config.m_SvSnapThreads);
+}
+
+void CServer::DoTick()
+{
+	CProfileScope TickScope(&m_Profiler, PROFILE_TICK);
+	m_CurrentGameTick++;
+
+	// apply new input
+	CProfileScope PhaseScope(&m_Profiler, PROFILE_INPUT);
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		if(m_aClients[c].m_State != CClient::STATE_INGAME)
+			continue;
+		CClient::CInput *pInput = m_aClients[c].GetInput(Tick());
+		if(pInput)
+			GameServer()->OnClientPredictedInput(c, pInput->m_aData);
+	}
+
+	PhaseScope.Switch(PROFILE_GAME_TICK);
+	GameServer()->OnTick();
+}
+
+bool CServer::SnapTick()
+{
+	if(!g_Config.m_SvHighBandwidth && (m_CurrentGameTick%2) != 0)
+		return false;
+
+	CProfileScope SnapScope(&m_Profiler, PROFILE_SNAP);
+	DoSnapshot();
+	return true;
+}
+
 int CServer::Run()
 {
 	//
@@ -1331,6 +1753,8 @@ int CServer::Run()
 
 	m_NetServer.SetCallbacks(NewClientCallback, DelClientCallback, this);
 
+	InitSnapshots(m_NetServer.MaxClients());
+
 	m_Econ.Init(Console(), &m_ServerBan);
 
 	char aBuf[256];
@@ -1359,6 +1783,7 @@ int CServer::Run()
 	{
 		int64 ReportTime = time_get();
 		int ReportInterval = 3;
+		int64 ProfileReportTime = time_get();
 
 		m_Lastheartbeat = 0;
 		m_GameStartTime = time_get();
@@ -1368,6 +1793,9 @@ int CServer::Run()
 			int64 t = time_get();
 			int NewTicks = 0;
 
+			m_Profiler.SetEnabled(g_Config.m_SvProfile);
+			m_Profiler.Update(t);
+
 			// load new map TODO: don't poll this
 			if(str_comp(g_Config.m_SvMap, m_aCurrentMap) != 0 || m_MapReload || m_CurrentGameTick >= 0x6FFFFFFF) //	force reload to make sure the ticks stay within a valid range
 			{
@@ -1408,68 +1836,43 @@ int CServer::Run()
 
 			while(t > TickStartTime(m_CurrentGameTick+1))
 			{
-				m_CurrentGameTick++;
+				DoTick();
 				NewTicks++;
-
-				// apply new input
-				for(int c = 0; c < MAX_CLIENTS; c++)
-				{
-					if(m_aClients[c].m_State == CClient::STATE_EMPTY)
-						continue;
-					for(int i = 0; i < 200; i++)
-					{
-						if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
-						{
-							if(m_aClients[c].m_State == CClient::STATE_INGAME)
-								GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
-							break;
-						}
-					}
-				}
-
-				GameServer()->OnTick();
 			}
 
 			// snap game
 			if(NewTicks)
 			{
-				if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
-					DoSnapshot();
+				SnapTick();
 
 				UpdateClientRconCommands();
 				UpdateClientMapListEntries();
 			}
 
 			// master server stuff
-			m_Register.RegisterUpdate(m_NetServer.NetType());
+			{
+				CProfileScope PhaseScope(&m_Profiler, PROFILE_REGISTER);
+				m_Register.RegisterUpdate(m_NetServer.NetType());
 
-			PumpNetwork();
+				PhaseScope.Switch(PROFILE_NETWORK);
+				PumpNetwork();
+			}
 
 			if(ReportTime < time_get())
 			{
-				if(g_Config.m_Debug)
-				{
-					/*
-					static NETSTATS prev_stats;
-					NETSTATS stats;
-					netserver_stats(net, &stats);
-
-					perf_next();
-
-					if(config.dbg_pref)
-						perf_dump(&rootscope);
-
-					dbg_msg("server", "send=%8d recv=%8d",
-						(stats.send_bytes - prev_stats.send_bytes)/reportinterval,
-						(stats.recv_bytes - prev_stats.recv_bytes)/reportinterval);
-
-					prev_stats = stats;
-					*/
-				}
+				if(g_Config.m_Debug && g_Config.m_DbgPref)
+					m_Profiler.Report(ProfileConsoleLineCB, this);
 
 				ReportTime += time_freq()*ReportInterval;
 			}
 
+			// stream the profile to the external console
+			if(g_Config.m_EcProfileInterval && m_Profiler.Enabled() && ProfileReportTime < time_get())
+			{
+				m_Profiler.Report(ProfileEconLineCB, this);
+				ProfileReportTime = time_get()+time_freq()*g_Config.m_EcProfileInterval;
+			}
+
 			// wait for incomming data
 			net_socket_read_wait(m_NetServer.Socket(), 5);
 		}
@@ -1488,6 +1891,98 @@ int CServer::Run()
 
 	if(m_pCurrentMapData)
 		mem_free(m_pCurrentMapData);
+	delete[] m_pSnapClients;
+	m_pSnapClients = 0;
+	return 0;
+}
+
+int CServer::RunBenchmark(int NumBots, int NumTicks, FBenchmarkInput pfnInput, void *pUser)
+{
+	if(!LoadMap(g_Config.m_SvMap))
+	{
+		dbg_msg("bench", "failed to load map. mapname='%s'", g_Config.m_SvMap);
+		return -1;
+	}
+
+	// the bots take the slots, everything that would be sent to them gets dropped
+	m_BenchmarkClients = clamp(NumBots, 1, (int)MAX_CLIENTS);
+	InitSnapshots(m_BenchmarkClients);
+	GameServer()->OnInit();
+
+	for(int i = 0; i < m_BenchmarkClients; i++)
+	{
+		NewClientCallback(i, this);
+		str_format(m_aClients[i].m_aName, sizeof(m_aClients[i].m_aName), "bot%d", i);
+		m_aClients[i].m_State = CClient::STATE_READY;
+		GameServer()->OnClientConnected(i, false);
+		m_aClients[i].m_State = CClient::STATE_INGAME;
+		GameServer()->OnClientEnter(i);
+	}
+
+	// the profiler is never updated, so its first window holds the whole run
+	m_Profiler.SetEnabled(true);
+	int64 SnapshotBytes = 0;
+	int NumSnapshots = 0;
+	int64 StartTime = time_get();
+
+	for(int t = 0; t < NumTicks; t++)
+	{
+		// the bots send their input for the next tick just before it starts, it takes the same
+		// way through the input ring as the one of a client. like the packets of a client it
+		// arrives outside of the tick, so the profile of the tick doesn't include making it
+		for(int c = 0; c < m_BenchmarkClients; c++)
+		{
+			CClient *pClient = &m_aClients[c];
+			mem_zero(pClient->m_LatestInput.m_aData, sizeof(pClient->m_LatestInput.m_aData));
+			pfnInput(c, Tick()+1, pClient->m_LatestInput.m_aData, pUser);
+			pClient->AddInput(Tick()+1, Tick(), MAX_INPUT_SIZE);
+			GameServer()->OnClientDirectInput(c, pClient->m_LatestInput.m_aData);
+		}
+
+		DoTick();
+
+		if(SnapTick())
+		{
+			// the bots ack every snapshot as soon as it is made
+			for(int s = 0; s < m_NumSnapClients; s++)
+			{
+				CClient *pClient = &m_aClients[m_pSnapClients[s].m_ClientID];
+				pClient->m_LastAckedSnapshot = Tick();
+				pClient->m_SnapRate = CClient::SNAPRATE_FULL;
+				SnapshotBytes += m_pSnapClients[s].m_CompSize;
+			}
+			NumSnapshots += m_NumSnapClients;
+		}
+	}
+
+	double Seconds = (time_get()-StartTime)/(double)time_freq();
+	dbg_msg("bench", "map '%s', %d bots, %d ticks in %.3fs, %.0f ticks/s (%.1fx real time)",
+		m_aCurrentMap, m_BenchmarkClients, NumTicks, Seconds, NumTicks/Seconds, NumTicks/Seconds/SERVER_TICK_SPEED);
+	m_Profiler.Report(ProfileConsoleLineCB, this);
+	if(NumSnapshots)
+	{
+		dbg_msg("bench", "%d snapshots, %.1f bytes per snapshot, %.0f bytes/s per client",
+			NumSnapshots, SnapshotBytes/(double)NumSnapshots, SnapshotBytes*(double)SERVER_TICK_SPEED/NumTicks/m_BenchmarkClients);
+		if(m_NumBudgetedSnapshots)
+			dbg_msg("bench", "%lld snapshots over the budget, %.1f items held back in them",
+				m_NumBudgetedSnapshots, m_NumDeferredItems/(double)m_NumBudgetedSnapshots);
+	}
+
+	for(int i = 0; i < m_BenchmarkClients; i++)
+	{
+		GameServer()->OnClientDrop(i, "benchmark done");
+		m_aClients[i].m_State = CClient::STATE_EMPTY;
+		m_aClients[i].m_Snapshots.PurgeAll();
+	}
+
+	GameServer()->OnShutdown();
+	m_pMap->Unload();
+
+	if(m_pCurrentMapData)
+		mem_free(m_pCurrentMapData);
+	delete[] m_pSnapClients;
+	m_pSnapClients = 0;
+	m_BenchmarkClients = 0;
 	return 0;
 }
 
@@ -1564,8 +2059,9 @@ void CServer::ConStatus(IConsole::IResult *pResult, void *pUser)
 			{
 				const char *pAuthStr = pThis->m_aClients[i].m_Authed == CServer::AUTHED_ADMIN ? "(Admin)" :
 										pThis->m_aClients[i].m_Authed == CServer::AUTHED_MOD ? "(Mod)" : "";
-				str_format(aBuf, sizeof(aBuf), "id=%d addr=%s client=%x name='%s' score=%d %s", i, aAddrStr,
-					pThis->m_aClients[i].m_Version, pThis->m_aClients[i].m_aName, pThis->m_aClients[i].m_Score, pAuthStr);
+				str_format(aBuf, sizeof(aBuf), "id=%d addr=%s client=%x name='%s' score=%d ping=%d inputs(late=%d early=%d dup=%d) %s", i, aAddrStr,
+					pThis->m_aClients[i].m_Version, pThis->m_aClients[i].m_aName, pThis->m_aClients[i].m_Score, pThis->m_aClients[i].m_Latency,
+					pThis->m_aClients[i].m_NumLateInputs, pThis->m_aClients[i].m_NumEarlyInputs, pThis->m_aClients[i].m_NumDuplicateInputs, pAuthStr);
 			}
 			else
 				str_format(aBuf, sizeof(aBuf), "id=%d addr=%s connecting", i, aAddrStr);
@@ -1649,6 +2145,32 @@ void CServer::ConLogout(IConsole::IResult *pResult, void *pUser)
 	}
 }
 
+void CServer::ProfileConsoleLineCB(const char *pLine, void *pUser)
+{
+	static_cast<CServer *>(pUser)->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", pLine);
+}
+
+void CServer::ProfileEconLineCB(const char *pLine, void *pUser)
+{
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "[profile]: %s", pLine);
+	static_cast<CServer *>(pUser)->m_Econ.Send(-1, aBuf);
+}
+
+void CServer::ConProfile(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	if(!pThis->m_Profiler.Enabled())
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", "profiler is off, enable it with sv_profile 1");
+	else if(!pThis->m_Profiler.Report(ProfileConsoleLineCB, pThis))
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profile", "no samples yet");
+}
+
+void CServer::ConProfileReset(IConsole::IResult *pResult, void *pUser)
+{
+	static_cast<CServer *>(pUser)->m_Profiler.Reset();
+}
+
 void CServer::ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
 {
 	pfnCallback(pResult, pCallbackUserData);
@@ -1732,6 +2254,9 @@ void CServer::RegisterCommands()
 
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
 
+	Console()->Register("profile", "", CFGFLAG_SERVER, ConProfile, this, "Show the timings of the server tick");
+	Console()->Register("profile_reset", "", CFGFLAG_SERVER, ConProfileReset, this, "Clear the timings of the server tick");
+
 	Console()->Chain("sv_name", ConchainSpecialInfoupdate, this);
 	Console()->Chain("password", ConchainSpecialInfoupdate, this);
 
@@ -1764,115 +2289,14 @@ void *CServer::SnapNewItem(int Type, int ID, int Size)
 	return ID < 0 ? 0 : m_SnapshotBuilder.NewItem(Type, ID, Size);
 }
 
-void CServer::SnapSetStaticsize(int ItemType, int Size)
+void *CServer::SnapNewSharedItem(int Type, int ID, int Size, const CClientMask &ClientMask)
 {
-	m_SnapshotDelta.SetStaticsize(ItemType, Size);
+	dbg_assert(Type >= 0 && Type <=0xffff, "incorrect type");
+	dbg_assert(ID >= 0 && ID <=0xffff, "incorrect id");
+	return ID < 0 ? 0 : m_SnapSharedItems.NewItem(Type, ID, Size, ClientMask);
 }
 
-static CServer *CreateServer() { return new CServer(); }
-
-int main(int argc, const char **argv) // ignore_convention
+void CServer::SnapSetStaticsize(int ItemType, int Size)
 {
-#if defined(CONF_FAMILY_WINDOWS)
-	for(int i = 1; i < argc; i++) // ignore_convention
-	{
-		if(str_comp("-s", argv[i]) == 0 || str_comp("--silent", argv[i]) == 0) // ignore_convention
-		{
-			ShowWindow(GetConsoleWindow(), SW_HIDE);
-			break;
-		}
-	}
-#endif
-
-	bool UseDefaultConfig = false;
-	for(int i = 1; i < argc; i++) // ignore_convention
-	{
-		if(str_comp("-d", argv[i]) == 0 || str_comp("--default", argv[i]) == 0) // ignore_convention
-		{
-			UseDefaultConfig = true;
-			break;
-		}
-	}
-
-	if(secure_random_init() != 0)
-	{
-		dbg_msg("secure", "could not initialize secure RNG");
-		return -1;
-	}
-
-	CServer *pServer = CreateServer();
-	IKernel *pKernel = IKernel::Create();
-
-	// create the components
-	int FlagMask = CFGFLAG_SERVER|CFGFLAG_ECON;
-	IEngine *pEngine = CreateEngine("Teeworlds");
-	IEngineMap *pEngineMap = CreateEngineMap();
-	IGameServer *pGameServer = CreateGameServer();
-	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER|CFGFLAG_ECON);
-	IEngineMasterServer *pEngineMasterServer = CreateEngineMasterServer();
-	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_SERVER, argc, argv); // ignore_convention
-	IConfig *pConfig = CreateConfig();
-
-	pServer->InitRegister(&pServer->m_NetServer, pEngineMasterServer, pConsole);
-
-	{
-		bool RegisterFail = false;
-
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pServer); // register as both
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pEngine);
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMap*>(pEngineMap)); // register as both
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMap*>(pEngineMap));
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pGameServer);
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConsole);
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConfig);
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMasterServer*>(pEngineMasterServer)); // register as both
-		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMasterServer*>(pEngineMasterServer));
-
-		if(RegisterFail)
-			return -1;
-	}
-
-	pEngine->Init();
-	pConfig->Init(FlagMask);
-	pEngineMasterServer->Init();
-	pEngineMasterServer->Load();
-
-	if(!UseDefaultConfig)
-	{
-		// register all console commands
-		pServer->RegisterCommands();
-
-		// execute autoexec file
-		pConsole->ExecuteFile("autoexec.cfg");
-
-		// parse the command line arguments
-		if(argc > 1) // ignore_convention
-			pConsole->ParseArguments(argc-1, &argv[1]); // ignore_convention
-	}
-
-	// restore empty config strings to their defaults
-	pConfig->RestoreStrings();
-
-	pEngine->InitLogfile();
-
-	pServer->InitRconPasswordIfUnset();
-
-	// run the server
-	dbg_msg("server", "starting...");
-	int Ret = pServer->Run();
-
-	// free
-	delete pServer;
-	delete pKernel;
-	delete pEngine;
-	delete pEngineMap;
-	delete pGameServer;
-	delete pConsole;
-	delete pEngineMasterServer;
-	delete pStorage;
-	delete pConfig;
-
-	return Ret;
+	m_SnapshotDelta.SetStaticsize(ItemType, Size);
 }
-
@@ -4,7 +4,10 @@
 #define ENGINE_SERVER_SERVER_H
 
 #include <engine/server.h>
+#include <engine/shared/jobs.h>
 #include <engine/shared/memheap.h>
+#include <engine/shared/profiler.h>
+#include <engine/shared/snapshot.h>
 
 class CSnapIDPool
 {
@@ -41,6 +44,34 @@ public:
 };
 
 
+class CSnapSharedItems
+{
+	enum
+	{
+		MAX_ITEMS = 4*1024,
+		MAX_DATASIZE = 4*CSnapshot::MAX_SIZE,
+	};
+
+	int m_aData[MAX_DATASIZE/sizeof(int)];
+	int m_aKeys[MAX_ITEMS];
+	int m_aOffsets[MAX_ITEMS];
+	int m_aSizes[MAX_ITEMS];
+	CClientMask m_aClientMasks[MAX_ITEMS];
+
+	int m_DataSize;
+	int m_NumItems;
+
+public:
+	CSnapSharedItems() { Clear(); }
+
+	void Clear();
+	void *NewItem(int Type, int ID, int Size, const CClientMask &ClientMask);
+
+	// adds all items the client can see to the builder
+	void Filter(CSnapshotBuilder *pBuilder, int ClientID) const;
+};
+
+
 class CServerBan : public CNetBan
 {
 	class CServer *m_pServer;
@@ -61,6 +92,8 @@ public:
 
 class CServer : public IServer
 {
+	friend class SnapshotBudget; // the tests budget snapshots without a network
+
 	class IGameServer *m_pGameServer;
 	class IConsole *m_pConsole;
 	class IStorage *m_pStorage;
@@ -98,7 +131,13 @@ public:
 
 			SNAPRATE_INIT=0,
 			SNAPRATE_FULL,
-			SNAPRATE_RECOVER
+			SNAPRATE_RECOVER,
+
+			// how far ahead of the server a client may send its input, has to be a power of two
+			INPUT_RING_SIZE=128,
+
+			MAX_DEFERRED_ITEMS=256,
+			SNAP_RTT_WINDOW=10, // seconds a minimum round trip counts for, twice at most
 		};
 
 		class CInput
@@ -106,6 +145,7 @@ public:
 		public:
 			int m_aData[MAX_INPUT_SIZE];
 			int m_GameTick; // the tick that was chosen for the input
+			bool m_Late; // arrived after its intended tick and got moved to the next one
 		};
 
 		// connection state info
@@ -114,12 +154,34 @@ public:
 		int m_SnapRate;
 
 		int m_LastAckedSnapshot;
+		int m_LastSnapshot; // the tick of the newest snapshot the client got, acked or not
 		int m_LastInputTick;
-		CSnapshotStorage m_Snapshots;
+		CSnapshotRing m_Snapshots;
+
+		// snapshot bytes the client may still get, refilled every tick, and how well its deltas compress
+		int m_SnapBudget;
+		int m_SnapBudgetTick;
+		float m_SnapCompression;
+
+		// what the snapshot acks tell about the way to the client: the smoothed round trip, -1
+		// until the first ack, the shortest one of the current and the last window, and the
+		// share of snapshots that never got acked
+		int64 m_SnapRtt;
+		int64 m_aSnapMinRtt[2];
+		int64 m_SnapMinRttStart;
+		float m_SnapLoss;
+
+		// items whose changes the client didn't get because of the budget, sorted by key,
+		// with the tick they got held back first
+		int m_NumDeferredItems;
+		int m_aDeferredKeys[MAX_DEFERRED_ITEMS];
+		int m_aDeferredTicks[MAX_DEFERRED_ITEMS];
 
 		CInput m_LatestInput;
-		CInput m_aInputs[200]; // TODO: handle input better
-		int m_CurrentInput;
+		CInput m_aInputs[INPUT_RING_SIZE]; // indexed by game tick
+		int m_NumLateInputs;
+		int m_NumEarlyInputs;
+		int m_NumDuplicateInputs;
 
 		char m_aName[MAX_NAME_LENGTH];
 		char m_aClan[MAX_CLAN_LENGTH];
@@ -136,21 +198,85 @@ public:
 		const CMapListEntry *m_pMapListEntryToSend;
 
 		void Reset();
+		void AddInput(int IntendedTick, int CurrentTick, int Size);
+		CInput *GetInput(int Tick);
+		void AckSnapshot(int PrevAckedSnapshot, int64 Rtt, int64 Now);
+		int64 SnapMinRtt() const;
 	};
 
 	CClient m_aClients[MAX_CLIENTS];
 
+	enum
+	{
+		MAX_SNAP_THREADS=16,
+
+		SNAP_DEFER_AGE_WEIGHT=200, // priority an item gains per tick it waits
+		MAX_SNAP_DEFER_TICKS=25, // items that waited that long get sent regardless of the budget
+	};
+
+	// a client's snapshot on its way through the delta/compress stage
+	class CSnapClient
+	{
+	public:
+		int m_ClientID;
+		int m_DeltaTick;
+		CSnapshot *m_pSnapshot;
+		CSnapshot *m_pDeltashot;
+		int m_Crc;
+		int m_DeltaSize;
+		int m_CompSize;
+		char m_aCompData[CSnapshot::MAX_SIZE];
+	};
+
+	// handles every m_Step'th client starting at m_First, with its own scratch buffer
+	class CSnapJob
+	{
+	public:
+		CJob m_Job;
+		CServer *m_pServer;
+		int m_First;
+		int m_Step;
+		char m_aDeltaData[CSnapshot::MAX_SIZE];
+	};
+
+	CSnapClient *m_pSnapClients; // one per client slot, allocated on run
+	int m_NumSnapClients;
+	CSnapJob m_aSnapJobs[MAX_SNAP_THREADS+1];
+	CJobPool m_SnapJobPool;
+
 	CSnapshotDelta m_SnapshotDelta;
 	CSnapshotBuilder m_SnapshotBuilder;
+
+	// a changed item of a snapshot that is over the budget
+	struct CBudgetItem
+	{
+		int m_Index;
+		int m_BaseIndex; // -1 for items the client doesn't have
+		int m_Cost;
+		int m_Score;
+		int m_DeferTick;
+		bool m_Deferrable; // the client has the same version in the acked and in the newest snapshot
+		bool m_Deferred;
+	};
+	CSnapshotBuilder m_BudgetBuilder;
+	CBudgetItem m_aBudgetItems[CSnapshotBuilder::MAX_ITEMS];
+	CBudgetItem *m_apBudgetOrder[CSnapshotBuilder::MAX_ITEMS];
+	int64 m_NumBudgetedSnapshots;
+	int64 m_NumDeferredItems;
+	static bool CompareBudgetItems(const CBudgetItem *pA, const CBudgetItem *pB);
+	CSnapshotPool m_SnapshotPool;
+	CSnapSharedItems m_SnapSharedItems;
 	CSnapIDPool m_IDPool;
 	CNetServer m_NetServer;
 	CEcon m_Econ;
 	CServerBan m_ServerBan;
+	CProfiler m_Profiler;
 
 	IEngineMap *m_pMap;
 
 	int64 m_GameStartTime;
 	int m_RunServer;
+	int m_BenchmarkClients; // the bots of RunBenchmark, 0 when the server runs on the network
 	int m_MapReload;
 	int m_RconClientID;
 	int m_RconAuthLevel;
@@ -208,6 +334,8 @@ public:
 	void DemoRecorder_HandleAutoStart();
 	bool DemoRecorder_IsRecording();
 
+	CProfiler *Profiler() { return &m_Profiler; }
+
 	int64 TickStartTime(int Tick);
 
 	int Init();
@@ -228,6 +356,11 @@ public:
 
 	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID);
 
+	static int SnapDeltaJob(void *pUser);
+	void CreateSnapDeltas(CSnapJob *pJob);
+	void SendSnapshot(const CSnapClient *pSnapClient);
+	int SnapBudget(int ClientID) const;
+	int BudgetSnapshot(int ClientID, CSnapshot *pSnap, int SnapSize);
 	void DoSnapshot();
 
 	static int NewClientCallback(int ClientID, void *pUser);
@@ -256,8 +389,22 @@ public:
 	int LoadMap(const char *pMapName);
 
 	void InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole);
+	void InitSnapshots(int MaxClients);
+
+	// advances the game by one tick with the input the clients sent for it
+	void DoTick();
+	// snapshots the game if the current tick gets one, returns whether it did
+	bool SnapTick();
 	int Run();
 
+	// fills the input of a bot for the given tick
+	typedef void (*FBenchmarkInput)(int ClientID, int Tick, int *pInput, void *pUser);
+
+	// runs the game on the current map without network and without waiting for
+	// the next tick, with bots in the first slots that play by the given input.
+	// reports the tick rate, the time of the tick phases and the snapshot sizes
+	int RunBenchmark(int NumBots, int NumTicks, FBenchmarkInput pfnInput, void *pUser);
+
 	static int MapListEntryCallback(const char *pFilename, int IsDir, int DirType, void *pUser);
 
 	static void ConKick(IConsole::IResult *pResult, void *pUser);
@@ -268,6 +415,10 @@ public:
 	static void ConMapReload(IConsole::IResult *pResult, void *pUser);
 	static void ConSaveConfig(IConsole::IResult *pResult, void *pUser);
 	static void ConLogout(IConsole::IResult *pResult, void *pUser);
+	static void ConProfile(IConsole::IResult *pResult, void *pUser);
+	static void ConProfileReset(IConsole::IResult *pResult, void *pUser);
+	static void ProfileConsoleLineCB(const char *pLine, void *pUser);
+	static void ProfileEconLineCB(const char *pLine, void *pUser);
 	static void ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainMaxclientsperipUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainModCommandUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
@@ -280,6 +431,7 @@ public:
 	virtual int SnapNewID();
 	virtual void SnapFreeID(int ID);
 	virtual void *SnapNewItem(int Type, int ID, int Size);
+	virtual void *SnapNewSharedItem(int Type, int ID, int Size, const CClientMask &ClientMask);
 	void SnapSetStaticsize(int ItemType, int Size);
 };
 
@@ -57,6 +57,9 @@ MACRO_CONFIG_INT(GfxDisplayAllModes, gfx_display_all_modes, 0, 0, 0, CFGFLAG_SAV
 MACRO_CONFIG_INT(GfxHighdpi, gfx_highdpi, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Use high dpi mode if available")
 MACRO_CONFIG_INT(GfxTextureCompression, gfx_texture_compression, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Use texture compression")
 MACRO_CONFIG_INT(GfxHighDetail, gfx_high_detail, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "High detail")
+MACRO_CONFIG_INT(GfxTileBuffers, gfx_tile_buffers, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Keep the tiles of the map in buffers instead of building them every frame")
+MACRO_CONFIG_INT(GfxBatchDraws, gfx_batch_draws, 0, 0, 2, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Merge draws with the same state, 2 also moves draws ahead where that doesn't change the picture")
+MACRO_CONFIG_INT(GfxCmdBuffers, gfx_cmd_buffers, 3, 2, 8, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Number of command buffers the rendering of a frame may be queued in, more lets the main thread run further ahead")
 MACRO_CONFIG_INT(GfxTextureQuality, gfx_texture_quality, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Don't scale textures down")
 MACRO_CONFIG_INT(GfxFsaaSamples, gfx_fsaa_samples, 0, 0, 16, CFGFLAG_SAVE|CFGFLAG_CLIENT, "FSAA Samples")
 MACRO_CONFIG_INT(GfxFinish, gfx_finish, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Wait till the gpu finished the current frame before starting the new one")
@@ -84,6 +87,11 @@ MACRO_CONFIG_INT(SvMaxClients, sv_max_clients, 8, 1, MAX_CLIENTS, CFGFLAG_SAVE|C
 MACRO_CONFIG_INT(SvMaxClientsPerIP, sv_max_clients_per_ip, 4, 1, MAX_CLIENTS, CFGFLAG_SAVE|CFGFLAG_SERVER, "Maximum number of clients with the same IP that can connect to the server")
 MACRO_CONFIG_INT(SvMapDownloadSpeed, sv_map_download_speed, 2, 1, 16, CFGFLAG_SAVE|CFGFLAG_SERVER, "Number of map data packages a client gets on each request")
 MACRO_CONFIG_INT(SvHighBandwidth, sv_high_bandwidth, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Use high bandwidth mode. Doubles the bandwidth required for the server. LAN use only")
+MACRO_CONFIG_INT(SvSnapBudget, sv_snap_budget, 0, 0, 1000000, CFGFLAG_SAVE|CFGFLAG_SERVER, "Snapshot bytes per second a client gets at most, less on a congested connection (0 for no limit)")
+MACRO_CONFIG_INT(SvSnapShared, sv_snap_shared, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Snap the world once per tick and filter the items for each client instead of snapping it for every client")
+MACRO_CONFIG_INT(SvSnapThreads, sv_snap_threads, 0, 0, 16, CFGFLAG_SAVE|CFGFLAG_SERVER, "Number of worker threads that create the snapshot deltas besides the main thread (takes effect on server start)")
+MACRO_CONFIG_INT(SvNetBatch, sv_net_batch, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Receive and send network packets in batches")
+MACRO_CONFIG_INT(SvProfile, sv_profile, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Time the parts of each server tick, see the profile command")
 MACRO_CONFIG_INT(SvRegister, sv_register, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Register server with master server for public listing")
 MACRO_CONFIG_STR(SvRconPassword, sv_rcon_password, 32, "", CFGFLAG_SAVE|CFGFLAG_SERVER, "Remote console password (full access)")
 MACRO_CONFIG_STR(SvRconModPassword, sv_rcon_mod_password, 32, "", CFGFLAG_SAVE|CFGFLAG_SERVER, "Remote console password for moderators (limited access)")
@@ -98,6 +106,7 @@ MACRO_CONFIG_STR(EcPassword, ec_password, 32, "", CFGFLAG_SAVE|CFGFLAG_ECON, "Ex
 MACRO_CONFIG_INT(EcBantime, ec_bantime, 0, 0, 1440, CFGFLAG_SAVE|CFGFLAG_ECON, "The time a client gets banned if econ authentication fails. 0 just closes the connection")
 MACRO_CONFIG_INT(EcAuthTimeout, ec_auth_timeout, 30, 1, 120, CFGFLAG_SAVE|CFGFLAG_ECON, "Time in seconds before the the econ authentification times out")
 MACRO_CONFIG_INT(EcOutputLevel, ec_output_level, 1, 0, 2, CFGFLAG_SAVE|CFGFLAG_ECON, "Adjusts the amount of information in the external console")
+MACRO_CONFIG_INT(EcProfileInterval, ec_profile_interval, 0, 0, 3600, CFGFLAG_SAVE|CFGFLAG_ECON, "Interval in seconds to send the server tick profile to the external console (0 = off, needs sv_profile)")
 
 MACRO_CONFIG_INT(Debug, debug, 0, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SERVER, "Debug mode")
 MACRO_CONFIG_INT(DbgStress, dbg_stress, 0, 0, 0, CFGFLAG_CLIENT|CFGFLAG_SERVER, "Stress systems")
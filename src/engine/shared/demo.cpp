@@ -796,7 +796,11 @@ int CDemoPlayer::Update()
 	int64 Now = time_get();
 	int64 Deltatime = Now-m_Info.m_LastUpdate;
 	m_Info.m_LastUpdate = Now;
+	return Advance(Deltatime);
+}
 
+int CDemoPlayer::Advance(int64 Deltatime)
+{
 	if(!IsPlaying())
 		return 0;
 
@@ -98,7 +98,6 @@ private:
 	int ReadChunkHeader(int *pType, int *pSize, int *pTick);
 	void DoTick();
 	void ScanFile();
-	int NextFrame();
 
 public:
 
@@ -119,6 +118,8 @@ public:
 	int GetDemoType() const;
 
 	int Update();
+	int Advance(int64 Deltatime); // plays on by the given time, regardless of the time that passed
+	int NextFrame(); // plays the next tick right away
 
 	const CPlaybackInfo *Info() const { return &m_Info; }
 	int IsPlaying() const { return m_File != 0; }
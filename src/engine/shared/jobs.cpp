@@ -9,6 +9,9 @@ CJobPool::CJobPool()
 	m_NumThreads = 0;
 	m_Shutdown = false;
 	m_Lock = lock_create();
+#if !defined(CONF_PLATFORM_MACOSX)
+	semaphore_init(&m_Semaphore);
+#endif
 	m_pFirstJob = 0;
 	m_pLastJob = 0;
 }
@@ -16,12 +19,20 @@ CJobPool::CJobPool()
 CJobPool::~CJobPool()
 {
 	m_Shutdown = true;
+#if !defined(CONF_PLATFORM_MACOSX)
+	// wake up all idle workers
+	for(int i = 0; i < m_NumThreads; i++)
+		semaphore_signal(&m_Semaphore);
+#endif
 	for(int i = 0; i < m_NumThreads; i++)
 	{
 		thread_wait(m_apThreads[i]);
 		thread_destroy(m_apThreads[i]);
 	}
 	lock_destroy(m_Lock);
+#if !defined(CONF_PLATFORM_MACOSX)
+	semaphore_destroy(&m_Semaphore);
+#endif
 }
 
 void CJobPool::WorkerThread(void *pUser)
@@ -32,6 +43,11 @@ void CJobPool::WorkerThread(void *pUser)
 	{
 		CJob *pJob = 0;
 
+#if !defined(CONF_PLATFORM_MACOSX)
+		// sleep until a job is added
+		semaphore_wait(&pPool->m_Semaphore);
+#endif
+
 		// fetch job from queue
 		lock_wait(pPool->m_Lock);
 		if(pPool->m_pFirstJob)
@@ -52,8 +68,10 @@ void CJobPool::WorkerThread(void *pUser)
 			pJob->m_Result = pJob->m_pfnFunc(pJob->m_pFuncData);
 			pJob->m_Status = CJob::STATE_DONE;
 		}
+#if defined(CONF_PLATFORM_MACOSX)
 		else
 			thread_sleep(10);
+#endif
 	}
 
 }
@@ -84,6 +102,9 @@ int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData)
 		m_pFirstJob = pJob;
 
 	lock_unlock(m_Lock);
+#if !defined(CONF_PLATFORM_MACOSX)
+	semaphore_signal(&m_Semaphore);
+#endif
 	return 0;
 }
 
@@ -2,6 +2,9 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef ENGINE_SHARED_JOBS_H
 #define ENGINE_SHARED_JOBS_H
+
+#include <base/system.h>
+
 typedef int (*JOBFUNC)(void *pData);
 
 class CJobPool;
@@ -47,6 +50,9 @@ class CJobPool
 	volatile bool m_Shutdown;
 
 	LOCK m_Lock;
+#if !defined(CONF_PLATFORM_MACOSX)
+	SEMAPHORE m_Semaphore;
+#endif
 	CJob *m_pFirstJob;
 	CJob *m_pLastJob;
 
@@ -57,6 +63,7 @@ public:
 	~CJobPool();
 
 	int Init(int NumThreads);
+	int NumThreads() const { return m_NumThreads; }
 	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData);
 };
 #endif
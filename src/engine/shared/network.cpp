@@ -87,6 +87,14 @@ int CNetRecvUnpacker::FetchChunk(CNetChunk *pChunk)
 	}
 }
 
+void CNetBase::SendDatagram(NETSOCKET Socket, const NETADDR *pAddr, const void *pData, int DataSize)
+{
+	if(ms_pSendBatch && ms_pSendBatch->UsesSocket(Socket))
+		ms_pSendBatch->Add(pAddr, pData, DataSize);
+	else
+		net_udp_send(Socket, pAddr, pData, DataSize);
+}
+
 // packs the data tight and sends it
 void CNetBase::SendPacketConnless(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, TOKEN ResponseToken, const void *pData, int DataSize)
 {
@@ -110,7 +118,7 @@ void CNetBase::SendPacketConnless(NETSOCKET Socket, const NETADDR *pAddr, TOKEN
 	dbg_assert(i == NET_PACKETHEADERSIZE_CONNLESS, "inconsistency");
 
 	mem_copy(&aBuffer[i], pData, DataSize);
-	net_udp_send(Socket, pAddr, aBuffer, i+DataSize);
+	SendDatagram(Socket, pAddr, aBuffer, i+DataSize);
 }
 
 void CNetBase::SendPacket(NETSOCKET Socket, const NETADDR *pAddr, CNetPacketConstruct *pPacket)
@@ -165,7 +173,7 @@ void CNetBase::SendPacket(NETSOCKET Socket, const NETADDR *pAddr, CNetPacketCons
 
 		dbg_assert(i == NET_PACKETHEADERSIZE, "inconsistency");
 
-		net_udp_send(Socket, pAddr, aBuffer, FinalSize);
+		SendDatagram(Socket, pAddr, aBuffer, FinalSize);
 
 		// log raw socket data
 		if(ms_DataLogSent)
@@ -369,6 +377,7 @@ int CNetBase::IsSeqInBackroom(int Seq, int Ack)
 IOHANDLE CNetBase::ms_DataLogSent = 0;
 IOHANDLE CNetBase::ms_DataLogRecv = 0;
 CHuffman CNetBase::ms_Huffman;
+CNetSendBatch *CNetBase::ms_pSendBatch = 0;
 
 
 void CNetBase::OpenLog(IOHANDLE DataLogSent, IOHANDLE DataLogRecv)
@@ -437,3 +446,30 @@ void CNetBase::Init()
 {
 	ms_Huffman.Init(gs_aFreqTable);
 }
+
+
+void CNetSendBatch::Init(NETSOCKET Socket)
+{
+	m_Socket = Socket;
+	m_NumDatagrams = 0;
+	for(int i = 0; i < NET_BATCH_SIZE; i++)
+		m_aDatagrams[i].data = m_aaData[i];
+}
+
+void CNetSendBatch::Add(const NETADDR *pAddr, const void *pData, int DataSize)
+{
+	if(m_NumDatagrams == NET_BATCH_SIZE)
+		Flush();
+
+	NETDATAGRAM *pDatagram = &m_aDatagrams[m_NumDatagrams++];
+	pDatagram->addr = *pAddr;
+	pDatagram->size = DataSize;
+	mem_copy(pDatagram->data, pData, DataSize);
+}
+
+void CNetSendBatch::Flush()
+{
+	if(m_NumDatagrams)
+		net_udp_send_batch(m_Socket, m_aDatagrams, m_NumDatagrams);
+	m_NumDatagrams = 0;
+}
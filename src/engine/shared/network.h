@@ -5,6 +5,7 @@
 
 #include "ringbuffer.h"
 #include "huffman.h"
+#include "protocol.h"
 
 /*
 
@@ -85,6 +86,9 @@ enum
 
 	NET_MAX_PACKET_CHUNKS=256,
 
+	// packets per batched socket call
+	NET_BATCH_SIZE=64,
+
 	// token
 	NET_SEEDTIME = 16,
 
@@ -106,7 +110,7 @@ enum
 	NET_TOKENREQUEST_DATASIZE = 512,
 
 	//
-	NET_MAX_CLIENTS = 64,
+	NET_MAX_CLIENTS = MAX_CLIENTS,
 	NET_MAX_CONSOLE_CLIENTS = 4,
 	
 	NET_MAX_SEQUENCE = 1<<10,
@@ -129,7 +133,8 @@ enum
 	NET_CTRLMSG_CLOSE=4,
 	NET_CTRLMSG_TOKEN=5,
 
-	NET_CONN_BUFFERSIZE=1024*32,
+	// a joining client gets the infos of all other clients at once, grow with the slots
+	NET_CONN_BUFFERSIZE=1024*32*((NET_MAX_CLIENTS+63)/64),
 
 	NET_ENUM_TERMINATOR
 };
@@ -401,6 +406,58 @@ public:
 };
 
 // server side
+// maps peer addresses to server slots and counts the slots per ip
+class CNetAddrMap
+{
+	enum
+	{
+		TABLE_SIZE=NET_MAX_CLIENTS*2,
+	};
+
+	// one entry per ip, the slots of that ip are chained
+	struct CEntry
+	{
+		NETADDR m_Addr;
+		int m_NumSlots;
+		int m_FirstSlot;
+	};
+
+	CEntry m_aEntries[TABLE_SIZE];
+	NETADDR m_aSlotAddr[NET_MAX_CLIENTS];
+	int m_aNextSlot[NET_MAX_CLIENTS];
+	bool m_aSlotUsed[NET_MAX_CLIENTS];
+	unsigned m_Seed;
+
+	static bool SameIP(const NETADDR *pA, const NETADDR *pB);
+	int Hash(const NETADDR *pAddr) const;
+	int FindEntry(const NETADDR *pAddr) const;
+	void RemoveEntry(int Index);
+
+public:
+	void Init();
+	void Add(int Slot, const NETADDR *pAddr);
+	void Remove(int Slot);
+
+	int Find(const NETADDR *pAddr) const;
+	int NumSlots(const NETADDR *pAddr) const;
+	int FirstFreeSlot(int MaxSlots) const;
+};
+
+// collects outgoing packets of one socket and sends them with a single call
+class CNetSendBatch
+{
+	NETSOCKET m_Socket;
+	int m_NumDatagrams;
+	NETDATAGRAM m_aDatagrams[NET_BATCH_SIZE];
+	unsigned char m_aaData[NET_BATCH_SIZE][NET_MAX_PACKETSIZE];
+
+public:
+	void Init(NETSOCKET Socket);
+	bool UsesSocket(NETSOCKET Socket) const { return m_Socket.ipv4sock == Socket.ipv4sock && m_Socket.ipv6sock == Socket.ipv6sock; }
+	void Add(const NETADDR *pAddr, const void *pData, int DataSize);
+	void Flush();
+};
+
 class CNetServer
 {
 	struct CSlot
@@ -411,7 +468,7 @@ class CNetServer
 
 	NETSOCKET m_Socket;
 	class CNetBan *m_pNetBan;
-	CSlot m_aSlots[NET_MAX_CLIENTS];
+	CSlot *m_pSlots; // one per client slot, allocated on open
 	int m_MaxClients;
 	int m_MaxClientsPerIP;
 
@@ -423,9 +480,20 @@ class CNetServer
 
 	CNetTokenManager m_TokenManager;
 	CNetTokenCache m_TokenCache;
+	CNetAddrMap m_AddrMap;
+
+	bool m_Batching;
+	int m_RecvBatchNum;
+	int m_RecvBatchPos;
+	NETDATAGRAM m_aRecvBatch[NET_BATCH_SIZE];
+	unsigned char m_aaRecvBatchData[NET_BATCH_SIZE][NET_MAX_PACKETSIZE];
+	CNetSendBatch m_SendBatch;
 
 	int m_Flags;
 public:
+	CNetServer() : m_pSlots(0) {}
+	~CNetServer() { delete[] m_pSlots; }
+
 	int SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_DELCLIENT pfnDelClient, void *pUser);
 
 	//
@@ -442,7 +510,7 @@ public:
 	int Drop(int ClientID, const char *pReason);
 
 	// status requests
-	const NETADDR *ClientAddr(int ClientID) const { return m_aSlots[ClientID].m_Connection.PeerAddress(); }
+	const NETADDR *ClientAddr(int ClientID) const { return m_pSlots[ClientID].m_Connection.PeerAddress(); }
 	NETSOCKET Socket() const { return m_Socket; }
 	class CNetBan *NetBan() const { return m_pNetBan; }
 	int NetType() const { return m_Socket.type; }
@@ -450,6 +518,11 @@ public:
 
 	//
 	void SetMaxClientsPerIP(int Max);
+
+	// packets sent between these two go out in batches
+	void SetBatching(bool Batching) { m_Batching = Batching; }
+	void BeginSendBatch();
+	void FlushSendBatch();
 };
 
 class CNetConsole
@@ -538,6 +611,9 @@ class CNetBase
 	static IOHANDLE ms_DataLogSent;
 	static IOHANDLE ms_DataLogRecv;
 	static CHuffman ms_Huffman;
+	static CNetSendBatch *ms_pSendBatch;
+
+	static void SendDatagram(NETSOCKET Socket, const NETADDR *pAddr, const void *pData, int DataSize);
 public:
 	static void OpenLog(IOHANDLE DataLogSent, IOHANDLE DataLogRecv);
 	static void CloseLog();
@@ -550,6 +626,7 @@ public:
 	static void SendPacketConnless(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, TOKEN ResponseToken, const void *pData, int DataSize);
 	static void SendPacket(NETSOCKET Socket, const NETADDR *pAddr, CNetPacketConstruct *pPacket);
 	static int UnpackPacket(unsigned char *pBuffer, int Size, CNetPacketConstruct *pPacket);
+	static void SetSendBatch(CNetSendBatch *pSendBatch) { ms_pSendBatch = pSendBatch; }
 
 	// The backroom is ack-NET_MAX_SEQUENCE/2. Used for knowing if we acked a packet or not
 	static int IsSeqInBackroom(int Seq, int Ack);
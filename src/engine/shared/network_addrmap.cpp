@@ -0,0 +1,129 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include "network.h"
+
+void CNetAddrMap::Init()
+{
+	mem_zero(m_aEntries, sizeof(m_aEntries));
+	mem_zero(m_aSlotUsed, sizeof(m_aSlotUsed));
+	// keep the table layout unpredictable
+	secure_random_fill(&m_Seed, sizeof(m_Seed));
+}
+
+bool CNetAddrMap::SameIP(const NETADDR *pA, const NETADDR *pB)
+{
+	return pA->type == pB->type && mem_comp(pA->ip, pB->ip, sizeof(pA->ip)) == 0;
+}
+
+int CNetAddrMap::Hash(const NETADDR *pAddr) const
+{
+	// fnv-1a
+	unsigned Hash = 2166136261u^m_Seed;
+	Hash = (Hash^pAddr->type)*16777619u;
+	for(unsigned i = 0; i < sizeof(pAddr->ip); i++)
+		Hash = (Hash^pAddr->ip[i])*16777619u;
+	return (int)(Hash%TABLE_SIZE);
+}
+
+int CNetAddrMap::FindEntry(const NETADDR *pAddr) const
+{
+	for(int i = Hash(pAddr), n = 0; n < TABLE_SIZE; i = (i+1)%TABLE_SIZE, n++)
+	{
+		if(!m_aEntries[i].m_NumSlots)
+			return -1;
+		if(SameIP(&m_aEntries[i].m_Addr, pAddr))
+			return i;
+	}
+	return -1;
+}
+
+void CNetAddrMap::RemoveEntry(int Index)
+{
+	// shift the following entries back so that no probe chain breaks
+	m_aEntries[Index].m_NumSlots = 0;
+	for(int i = (Index+1)%TABLE_SIZE; m_aEntries[i].m_NumSlots; i = (i+1)%TABLE_SIZE)
+	{
+		int Home = Hash(&m_aEntries[i].m_Addr);
+		// move the entry if its home is not between the hole and its position
+		bool Move = Index <= i ? (Home <= Index || Home > i) : (Home <= Index && Home > i);
+		if(Move)
+		{
+			m_aEntries[Index] = m_aEntries[i];
+			m_aEntries[i].m_NumSlots = 0;
+			Index = i;
+		}
+	}
+}
+
+void CNetAddrMap::Add(int Slot, const NETADDR *pAddr)
+{
+	dbg_assert(Slot >= 0 && Slot < NET_MAX_CLIENTS, "slot out of range");
+	if(m_aSlotUsed[Slot])
+		Remove(Slot);
+
+	int Index = FindEntry(pAddr);
+	if(Index == -1)
+	{
+		for(Index = Hash(pAddr); m_aEntries[Index].m_NumSlots; Index = (Index+1)%TABLE_SIZE);
+		m_aEntries[Index].m_Addr = *pAddr;
+		m_aEntries[Index].m_Addr.port = 0;
+		m_aEntries[Index].m_FirstSlot = -1;
+	}
+
+	m_aSlotAddr[Slot] = *pAddr;
+	m_aSlotUsed[Slot] = true;
+	m_aNextSlot[Slot] = m_aEntries[Index].m_FirstSlot;
+	m_aEntries[Index].m_FirstSlot = Slot;
+	m_aEntries[Index].m_NumSlots++;
+}
+
+void CNetAddrMap::Remove(int Slot)
+{
+	if(!m_aSlotUsed[Slot])
+		return;
+	m_aSlotUsed[Slot] = false;
+
+	int Index = FindEntry(&m_aSlotAddr[Slot]);
+	dbg_assert(Index != -1, "slot missing in address map");
+
+	// unlink the slot
+	int *pLink = &m_aEntries[Index].m_FirstSlot;
+	while(*pLink != Slot)
+		pLink = &m_aNextSlot[*pLink];
+	*pLink = m_aNextSlot[Slot];
+
+	if(--m_aEntries[Index].m_NumSlots == 0)
+		RemoveEntry(Index);
+}
+
+int CNetAddrMap::Find(const NETADDR *pAddr) const
+{
+	int Index = FindEntry(pAddr);
+	if(Index == -1)
+		return -1;
+
+	for(int Slot = m_aEntries[Index].m_FirstSlot; Slot != -1; Slot = m_aNextSlot[Slot])
+	{
+		if(m_aSlotAddr[Slot].port == pAddr->port)
+			return Slot;
+	}
+	return -1;
+}
+
+int CNetAddrMap::NumSlots(const NETADDR *pAddr) const
+{
+	int Index = FindEntry(pAddr);
+	return Index == -1 ? 0 : m_aEntries[Index].m_NumSlots;
+}
+
+int CNetAddrMap::FirstFreeSlot(int MaxSlots) const
+{
+	for(int i = 0; i < MaxSlots; i++)
+	{
+		if(!m_aSlotUsed[i])
+			return i;
+	}
+	return -1;
+}
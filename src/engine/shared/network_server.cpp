@@ -11,6 +11,7 @@
 bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int MaxClientsPerIP, int Flags)
 {
 	// zero out the whole structure
+	delete[] m_pSlots;
 	mem_zero(this, sizeof(*this));
 
 	// open socket
@@ -20,6 +21,7 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 
 	m_TokenManager.Init(m_Socket);
 	m_TokenCache.Init(m_Socket, &m_TokenManager);
+	m_AddrMap.Init();
 
 	m_pNetBan = pNetBan;
 
@@ -32,8 +34,14 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 
 	m_MaxClientsPerIP = MaxClientsPerIP;
 
-	for(int i = 0; i < NET_MAX_CLIENTS; i++)
-		m_aSlots[i].m_Connection.Init(m_Socket, true);
+	m_pSlots = new CSlot[m_MaxClients];
+	mem_zero(m_pSlots, sizeof(CSlot)*m_MaxClients);
+	for(int i = 0; i < m_MaxClients; i++)
+		m_pSlots[i].m_Connection.Init(m_Socket, true);
+
+	for(int i = 0; i < NET_BATCH_SIZE; i++)
+		m_aRecvBatch[i].data = m_aaRecvBatchData[i];
+	m_SendBatch.Init(m_Socket);
 
 	m_Flags = Flags;
 
@@ -67,7 +75,8 @@ int CNetServer::Drop(int ClientID, const char *pReason)
 	if(m_pfnDelClient)
 		m_pfnDelClient(ClientID, pReason, m_UserPtr);
 
-	m_aSlots[ClientID].m_Connection.Disconnect(pReason);
+	m_AddrMap.Remove(ClientID);
+	m_pSlots[ClientID].m_Connection.Disconnect(pReason);
 
 	return 0;
 }
@@ -77,16 +86,16 @@ int CNetServer::Update()
 	int64 Now = time_get();
 	for(int i = 0; i < MaxClients(); i++)
 	{
-		m_aSlots[i].m_Connection.Update();
-		if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_ERROR)
+		m_pSlots[i].m_Connection.Update();
+		if(m_pSlots[i].m_Connection.State() == NET_CONNSTATE_ERROR)
 		{
-			if(Now - m_aSlots[i].m_Connection.ConnectTime() < time_freq() && NetBan())
+			if(Now - m_pSlots[i].m_Connection.ConnectTime() < time_freq() && NetBan())
 			{
 				if(NetBan()->BanAddr(ClientAddr(i), 60, "Stressing network") == -1)
-					Drop(i, m_aSlots[i].m_Connection.ErrorString());
+					Drop(i, m_pSlots[i].m_Connection.ErrorString());
 			}
 			else
-				Drop(i, m_aSlots[i].m_Connection.ErrorString());
+				Drop(i, m_pSlots[i].m_Connection.ErrorString());
 		}
 	}
 
@@ -109,14 +118,32 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 		if(m_RecvUnpacker.FetchChunk(pChunk))
 			return 1;
 
-		// TODO: empty the recvinfo
-		int Bytes = net_udp_recv(m_Socket, &Addr, m_RecvUnpacker.m_aBuffer, NET_MAX_PACKETSIZE);
+		// drain the socket a batch at a time
+		if(m_RecvBatchPos == m_RecvBatchNum)
+		{
+			m_RecvBatchPos = 0;
+			if(m_Batching)
+				m_RecvBatchNum = net_udp_recv_batch(m_Socket, m_aRecvBatch, NET_BATCH_SIZE, NET_MAX_PACKETSIZE);
+			else
+			{
+				m_aRecvBatch[0].size = net_udp_recv(m_Socket, &m_aRecvBatch[0].addr, m_aRecvBatch[0].data, NET_MAX_PACKETSIZE);
+				m_RecvBatchNum = m_aRecvBatch[0].size > 0 ? 1 : 0;
+			}
+
+			// no more packets for now
+			if(m_RecvBatchNum <= 0)
+			{
+				m_RecvBatchNum = 0;
+				break;
+			}
+		}
 
-		// no more packets for now
-		if(Bytes <= 0)
-			break;
+		const NETDATAGRAM *pDatagram = &m_aRecvBatch[m_RecvBatchPos++];
+		Addr = pDatagram->addr;
+		if(pDatagram->size <= 0)
+			continue;
 
-		if(CNetBase::UnpackPacket(m_RecvUnpacker.m_aBuffer, Bytes, &m_RecvUnpacker.m_Data) == 0)
+		if(CNetBase::UnpackPacket((unsigned char *)pDatagram->data, pDatagram->size, &m_RecvUnpacker.m_Data) == 0)
 		{
 			// check for bans
 			char aBuf[128];
@@ -132,37 +159,31 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 				continue;
 			}
 
-			bool Found = false;
 			// try to find matching slot
-			for(int i = 0; i < MaxClients(); i++)
+			int Slot = m_AddrMap.Find(&Addr);
+			if(Slot != -1)
 			{
-				if(net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), &Addr) == 0)
+				if(m_pSlots[Slot].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
 				{
-					if(m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
+					if(m_RecvUnpacker.m_Data.m_DataSize)
 					{
-						if(m_RecvUnpacker.m_Data.m_DataSize)
+						if(!(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS))
+							m_RecvUnpacker.Start(&Addr, &m_pSlots[Slot].m_Connection, Slot);
+						else
 						{
-							if(!(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS))
-								m_RecvUnpacker.Start(&Addr, &m_aSlots[i].m_Connection, i);
-							else
-							{
-								pChunk->m_Flags = NETSENDFLAG_CONNLESS;
-								pChunk->m_Address = *m_aSlots[i].m_Connection.PeerAddress();
-								pChunk->m_ClientID = i;
-								pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
-								pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
-								if(pResponseToken)
-									*pResponseToken = NET_TOKEN_NONE;
-								return 1;
-							}
+							pChunk->m_Flags = NETSENDFLAG_CONNLESS;
+							pChunk->m_Address = *m_pSlots[Slot].m_Connection.PeerAddress();
+							pChunk->m_ClientID = Slot;
+							pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
+							pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
+							if(pResponseToken)
+								*pResponseToken = NET_TOKEN_NONE;
+							return 1;
 						}
 					}
-					Found = true;
 				}
-			}
-
-			if(Found)
 				continue;
+			}
 
 			int Accept = m_TokenManager.ProcessMessage(&Addr, &m_RecvUnpacker.m_Data);
 			if(Accept <= 0)
@@ -172,45 +193,26 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 			{
 				if(m_RecvUnpacker.m_Data.m_aChunkData[0] == NET_CTRLMSG_CONNECT)
 				{
-					bool Found = false;
-
 					// only allow a specific number of players with the same ip
-					NETADDR ThisAddr = Addr, OtherAddr;
-					int FoundAddr = 1;
-					ThisAddr.port = 0;
-					for(int i = 0; i < MaxClients(); i++)
+					if(m_AddrMap.NumSlots(&Addr) >= m_MaxClientsPerIP)
 					{
-						if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
-							continue;
-
-						OtherAddr = *m_aSlots[i].m_Connection.PeerAddress();
-						OtherAddr.port = 0;
-						if(!net_addr_comp(&ThisAddr, &OtherAddr))
-						{
-							if(FoundAddr++ >= m_MaxClientsPerIP)
-							{
-								char aBuf[128];
-								str_format(aBuf, sizeof(aBuf), "Only %d players with the same IP are allowed", m_MaxClientsPerIP);
-								CNetBase::SendControlMsg(m_Socket, &Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf) + 1);
-								return 0;
-							}
-						}
+						char aBuf[128];
+						str_format(aBuf, sizeof(aBuf), "Only %d players with the same IP are allowed", m_MaxClientsPerIP);
+						CNetBase::SendControlMsg(m_Socket, &Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf) + 1);
+						return 0;
 					}
 
-					for(int i = 0; i < MaxClients(); i++)
+					int Slot = m_AddrMap.FirstFreeSlot(MaxClients());
+					if(Slot != -1)
 					{
-						if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
-						{
-							Found = true;
-							m_aSlots[i].m_Connection.SetToken(m_RecvUnpacker.m_Data.m_Token);
-							m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr);
-							if(m_pfnNewClient)
-								m_pfnNewClient(i, m_UserPtr);
-							break;
-						}
+						m_pSlots[Slot].m_Connection.SetToken(m_RecvUnpacker.m_Data.m_Token);
+						m_pSlots[Slot].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr);
+						if(m_pSlots[Slot].m_Connection.State() != NET_CONNSTATE_OFFLINE)
+							m_AddrMap.Add(Slot, m_pSlots[Slot].m_Connection.PeerAddress());
+						if(m_pfnNewClient)
+							m_pfnNewClient(Slot, m_UserPtr);
 					}
-
-					if(!Found)
+					else
 					{
 						const char FullMsg[] = "This server is full";
 						CNetBase::SendControlMsg(m_Socket, &Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, FullMsg, sizeof(FullMsg));
@@ -245,14 +247,9 @@ int CNetServer::Send(CNetChunk *pChunk, TOKEN Token)
 			return -1;
 		}
 
+		// upgrade the packet, now that we know its recipent
 		if(pChunk->m_ClientID == -1)
-			for(int i = 0; i < MaxClients(); i++)
-				if(net_addr_comp(&pChunk->m_Address, m_aSlots[i].m_Connection.PeerAddress()) == 0)
-				{
-					// upgrade the packet, now that we know its recipent
-					pChunk->m_ClientID = i;
-					break;
-				}
+			pChunk->m_ClientID = m_AddrMap.Find(&pChunk->m_Address);
 
 		if(Token != NET_TOKEN_NONE)
 		{
@@ -269,7 +266,7 @@ int CNetServer::Send(CNetChunk *pChunk, TOKEN Token)
 				dbg_assert(pChunk->m_ClientID >= 0, "errornous client id");
 				dbg_assert(pChunk->m_ClientID < MaxClients(), "errornous client id");
 
-				m_aSlots[pChunk->m_ClientID].m_Connection.SendPacketConnless((const char *)pChunk->m_pData, pChunk->m_DataSize);
+				m_pSlots[pChunk->m_ClientID].m_Connection.SendPacketConnless((const char *)pChunk->m_pData, pChunk->m_DataSize);
 			}
 		}
 	}
@@ -288,10 +285,10 @@ int CNetServer::Send(CNetChunk *pChunk, TOKEN Token)
 		if(pChunk->m_Flags&NETSENDFLAG_VITAL)
 			Flags = NET_CHUNKFLAG_VITAL;
 
-		if(m_aSlots[pChunk->m_ClientID].m_Connection.QueueChunk(Flags, pChunk->m_DataSize, pChunk->m_pData) == 0)
+		if(m_pSlots[pChunk->m_ClientID].m_Connection.QueueChunk(Flags, pChunk->m_DataSize, pChunk->m_pData) == 0)
 		{
 			if(pChunk->m_Flags&NETSENDFLAG_FLUSH)
-				m_aSlots[pChunk->m_ClientID].m_Connection.Flush();
+				m_pSlots[pChunk->m_ClientID].m_Connection.Flush();
 		}
 		else
 		{
@@ -311,3 +308,15 @@ void CNetServer::SetMaxClientsPerIP(int Max)
 
 	m_MaxClientsPerIP = Max;
 }
+
+void CNetServer::BeginSendBatch()
+{
+	if(m_Batching)
+		CNetBase::SetSendBatch(&m_SendBatch);
+}
+
+void CNetServer::FlushSendBatch()
+{
+	CNetBase::SetSendBatch(0);
+	m_SendBatch.Flush();
+}
@@ -0,0 +1,156 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include "profiler.h"
+
+
+int CProfileHistogram::Bucket(int64 Value)
+{
+	if(Value < LINEAR_BUCKETS)
+		return max((int)Value, 0);
+
+	int Exponent = 4;
+	while(Exponent < MAX_EXPONENT && (Value>>(Exponent+1)))
+		Exponent++;
+	if(Value>>(Exponent+1))
+		return NUM_BUCKETS-1;
+
+	// the three bits below the leading one pick the sub bucket
+	int Sub = (int)(Value>>(Exponent-3))&(SUB_BUCKETS-1);
+	return LINEAR_BUCKETS+(Exponent-4)*SUB_BUCKETS+Sub;
+}
+
+int64 CProfileHistogram::BucketMax(int Bucket)
+{
+	if(Bucket < LINEAR_BUCKETS)
+		return Bucket;
+
+	int Exponent = 4+(Bucket-LINEAR_BUCKETS)/SUB_BUCKETS;
+	int Sub = (Bucket-LINEAR_BUCKETS)%SUB_BUCKETS;
+	return ((int64)(SUB_BUCKETS+Sub+1)<<(Exponent-3))-1;
+}
+
+void CProfileHistogram::Add(int64 Value)
+{
+	m_aBuckets[Bucket(Value)]++;
+	m_Count++;
+	m_Sum += Value;
+	if(Value > m_Max)
+		m_Max = Value;
+}
+
+void CProfileHistogram::Merge(const CProfileHistogram *pOther)
+{
+	for(int i = 0; i < NUM_BUCKETS; i++)
+		m_aBuckets[i] += pOther->m_aBuckets[i];
+	m_Count += pOther->m_Count;
+	m_Sum += pOther->m_Sum;
+	m_Max = max(m_Max, pOther->m_Max);
+}
+
+int64 CProfileHistogram::Percentile(int Percent) const
+{
+	if(m_Count == 0)
+		return 0;
+
+	// rank of the sample, rounded up
+	int64 Rank = max(((int64)m_Count*Percent+99)/100, (int64)1);
+	int64 Seen = 0;
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		Seen += m_aBuckets[i];
+		if(Seen >= Rank)
+			return min(BucketMax(i), m_Max);
+	}
+	return m_Max;
+}
+
+
+CProfiler::CProfiler()
+{
+	m_Enabled = false;
+	Reset();
+}
+
+const char *CProfiler::ScopeName(int Scope)
+{
+	static const char *s_apNames[NUM_PROFILE_SCOPES] = {
+		"tick",
+		"input",
+		"game_tick",
+		"world_tick",
+		"world_tick_defered",
+		"snap",
+		"snap_build",
+		"snap_delta",
+		"snap_send",
+		"network",
+		"register",
+	};
+	return Scope >= 0 && Scope < NUM_PROFILE_SCOPES ? s_apNames[Scope] : "unknown";
+}
+
+void CProfiler::SetEnabled(bool Enabled)
+{
+	if(Enabled && !m_Enabled)
+		Reset();
+	m_Enabled = Enabled;
+}
+
+void CProfiler::Reset()
+{
+	for(int w = 0; w < 2; w++)
+		for(int i = 0; i < NUM_PROFILE_SCOPES; i++)
+			m_aaWindows[w][i].Clear();
+	m_CurrentWindow = 0;
+	m_WindowEnd = 0;
+}
+
+void CProfiler::Update(int64 Now)
+{
+	if(!m_Enabled || Now < m_WindowEnd)
+		return;
+
+	// the oldest window gets dropped, unless the profiler sat idle for a whole window
+	m_CurrentWindow ^= 1;
+	for(int i = 0; i < NUM_PROFILE_SCOPES; i++)
+		m_aaWindows[m_CurrentWindow][i].Clear();
+	if(m_WindowEnd && Now >= m_WindowEnd+time_freq()*WINDOW_SECONDS)
+	{
+		for(int i = 0; i < NUM_PROFILE_SCOPES; i++)
+			m_aaWindows[m_CurrentWindow^1][i].Clear();
+	}
+	m_WindowEnd = Now+time_freq()*WINDOW_SECONDS;
+}
+
+void CProfiler::Add(int Scope, int64 Duration)
+{
+	m_aaWindows[m_CurrentWindow][Scope].Add(Duration*1000000/time_freq());
+}
+
+void CProfiler::GetStats(int Scope, CProfileHistogram *pStats) const
+{
+	*pStats = m_aaWindows[0][Scope];
+	pStats->Merge(&m_aaWindows[1][Scope]);
+}
+
+int CProfiler::Report(void (*pfnLine)(const char *pLine, void *pUser), void *pUser) const
+{
+	int NumLines = 0;
+	for(int i = 0; i < NUM_PROFILE_SCOPES; i++)
+	{
+		CProfileHistogram Stats;
+		GetStats(i, &Stats);
+		if(!Stats.Count())
+			continue;
+
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%-18s n=%-6d avg=%6dus p50=%6dus p99=%6dus max=%6dus",
+			ScopeName(i), Stats.Count(), (int)(Stats.Sum()/Stats.Count()),
+			(int)Stats.Percentile(50), (int)Stats.Percentile(99), (int)Stats.Max());
+		pfnLine(aBuf, pUser);
+		NumLines++;
+	}
+	return NumLines;
+}
@@ -0,0 +1,138 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_PROFILER_H
+#define ENGINE_SHARED_PROFILER_H
+
+#include <base/system.h>
+
+// the parts of a server tick that get timed
+enum
+{
+	PROFILE_TICK=0,
+	PROFILE_INPUT,
+	PROFILE_GAME_TICK,
+	PROFILE_WORLD_TICK,
+	PROFILE_WORLD_TICK_DEFERED,
+	PROFILE_SNAP,
+	PROFILE_SNAP_BUILD,
+	PROFILE_SNAP_DELTA,
+	PROFILE_SNAP_SEND,
+	PROFILE_NETWORK,
+	PROFILE_REGISTER,
+	NUM_PROFILE_SCOPES
+};
+
+/*
+	Class: CProfileHistogram
+		Log-linear histogram of durations in microseconds. Values below 16
+		get a bucket each, above that every power of two is split into 8
+		buckets, so the reported percentiles are off by 12.5% at most.
+*/
+class CProfileHistogram
+{
+public:
+	enum
+	{
+		LINEAR_BUCKETS=16,
+		SUB_BUCKETS=8,
+		MAX_EXPONENT=24, // about 16 seconds
+		NUM_BUCKETS=LINEAR_BUCKETS+(MAX_EXPONENT-4+1)*SUB_BUCKETS,
+	};
+
+	static int Bucket(int64 Value);
+	static int64 BucketMax(int Bucket);
+
+	void Clear() { mem_zero(this, sizeof(*this)); }
+	void Add(int64 Value);
+	void Merge(const CProfileHistogram *pOther);
+
+	int Count() const { return m_Count; }
+	int64 Max() const { return m_Max; }
+	int64 Sum() const { return m_Sum; }
+
+	// upper bound of the bucket that holds the given percentile
+	int64 Percentile(int Percent) const;
+
+private:
+	int m_aBuckets[NUM_BUCKETS];
+	int m_Count;
+	int64 m_Max;
+	int64 m_Sum;
+};
+
+/*
+	Class: CProfiler
+		Rolling histograms for the scopes of a server tick. Samples go into
+		the current window, the reports cover the current and the previous
+		one. All scopes are recorded and read from the server thread, so the
+		histograms go without any locking.
+*/
+class CProfiler
+{
+	CProfileHistogram m_aaWindows[2][NUM_PROFILE_SCOPES];
+	int m_CurrentWindow;
+	int64 m_WindowEnd;
+	bool m_Enabled;
+
+public:
+	enum
+	{
+		WINDOW_SECONDS=5,
+	};
+
+	CProfiler();
+
+	static const char *ScopeName(int Scope);
+
+	bool Enabled() const { return m_Enabled; }
+	void SetEnabled(bool Enabled);
+
+	void Reset();
+	void Update(int64 Now);
+	void Add(int Scope, int64 Duration);
+
+	void GetStats(int Scope, CProfileHistogram *pStats) const;
+
+	// writes one line per scope that got samples, returns the number of lines
+	int Report(void (*pfnLine)(const char *pLine, void *pUser), void *pUser) const;
+};
+
+/*
+	Class: CProfileScope
+		Times its own lifetime into a profiler scope. Costs a single branch
+		when the profiler is turned off.
+*/
+class CProfileScope
+{
+	CProfiler *m_pProfiler;
+	int m_Scope;
+	int64 m_Start;
+
+public:
+	CProfileScope(CProfiler *pProfiler, int Scope)
+	{
+		m_pProfiler = pProfiler && pProfiler->Enabled() ? pProfiler : 0;
+		m_Scope = Scope;
+		m_Start = m_pProfiler ? time_get() : 0;
+	}
+
+	~CProfileScope()
+	{
+		if(m_pProfiler)
+			m_pProfiler->Add(m_Scope, time_get()-m_Start);
+	}
+
+	// ends the current scope and starts timing the next one
+	void Switch(int Scope)
+	{
+		if(m_pProfiler)
+		{
+			int64 Now = time_get();
+			m_pProfiler->Add(m_Scope, Now-m_Start);
+			m_Start = Now;
+		}
+		m_Scope = Scope;
+	}
+};
+
+#endif
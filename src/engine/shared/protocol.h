@@ -5,6 +5,15 @@
 
 #include <base/system.h>
 
+// the client slot ceiling can be raised at build time, see MAX_CLIENTS in CMakeLists.txt.
+// client ids double as snapshot item ids which only have 16 bits
+#if !defined(CONF_MAX_CLIENTS)
+#define CONF_MAX_CLIENTS 64
+#endif
+#if CONF_MAX_CLIENTS < 1 || CONF_MAX_CLIENTS > 0x10000
+#error CONF_MAX_CLIENTS has to be in the range of 1 to 65536
+#endif
+
 /*
 	Connection diagram - How the initilization works.
 
@@ -84,7 +93,7 @@ enum
 	SERVERINFO_LEVEL_MIN=0,
 	SERVERINFO_LEVEL_MAX=2,
 
-	MAX_CLIENTS=64,
+	MAX_CLIENTS=CONF_MAX_CLIENTS,
 	MAX_PLAYERS=16,
 
 	MAX_INPUT_SIZE=128,
@@ -101,4 +110,63 @@ enum
 	MSGFLAG_NOSEND=16
 };
 
+// set of client ids, one bit per client slot
+class CClientMask
+{
+	enum
+	{
+		NUM_WORDS=(MAX_CLIENTS+31)/32,
+	};
+
+	unsigned m_aWords[NUM_WORDS];
+
+public:
+	CClientMask() { Clear(); }
+
+	static CClientMask All() { CClientMask Mask; Mask.SetAll(); return Mask; }
+	static CClientMask One(int ClientID) { CClientMask Mask; Mask.Set(ClientID); return Mask; }
+
+	void Clear() { mem_zero(m_aWords, sizeof(m_aWords)); }
+	void SetAll()
+	{
+		for(int i = 0; i < NUM_WORDS; i++)
+			m_aWords[i] = ~0u;
+	}
+	void Set(int ClientID) { m_aWords[ClientID>>5] |= 1u<<(ClientID&31); }
+	void Unset(int ClientID) { m_aWords[ClientID>>5] &= ~(1u<<(ClientID&31)); }
+	bool IsSet(int ClientID) const { return (m_aWords[ClientID>>5]&(1u<<(ClientID&31))) != 0; }
+
+	bool IsEmpty() const
+	{
+		for(int i = 0; i < NUM_WORDS; i++)
+			if(m_aWords[i])
+				return false;
+		return true;
+	}
+
+	CClientMask &operator|=(const CClientMask &Other)
+	{
+		for(int i = 0; i < NUM_WORDS; i++)
+			m_aWords[i] |= Other.m_aWords[i];
+		return *this;
+	}
+
+	CClientMask &operator&=(const CClientMask &Other)
+	{
+		for(int i = 0; i < NUM_WORDS; i++)
+			m_aWords[i] &= Other.m_aWords[i];
+		return *this;
+	}
+
+	CClientMask operator|(const CClientMask &Other) const { CClientMask Mask = *this; Mask |= Other; return Mask; }
+	CClientMask operator&(const CClientMask &Other) const { CClientMask Mask = *this; Mask &= Other; return Mask; }
+	CClientMask operator~() const
+	{
+		CClientMask Mask;
+		for(int i = 0; i < NUM_WORDS; i++)
+			Mask.m_aWords[i] = ~m_aWords[i];
+		return Mask;
+	}
+};
+
 #endif
@@ -81,62 +81,16 @@ void CSnapshot::DebugDump() const
 
 // CSnapshotDelta
 
-struct CItemList
-{
-	int m_Num;
-	int m_aKeys[64];
-	int m_aIndex[64];
-};
-
-enum
-{
-	HASHLIST_SIZE = 256,
-};
-
-static void GenerateHash(CItemList *pHashlist, const CSnapshot *pSnapshot)
-{
-	for(int i = 0; i < HASHLIST_SIZE; i++)
-		pHashlist[i].m_Num = 0;
-
-	for(int i = 0; i < pSnapshot->NumItems(); i++)
-	{
-		int Key = pSnapshot->GetItem(i)->Key();
-		int HashID = ((Key>>12)&0xf0) | (Key&0xf);
-		if(pHashlist[HashID].m_Num != 64)
-		{
-			pHashlist[HashID].m_aIndex[pHashlist[HashID].m_Num] = i;
-			pHashlist[HashID].m_aKeys[pHashlist[HashID].m_Num] = Key;
-			pHashlist[HashID].m_Num++;
-		}
-	}
-}
-
-static int GetItemIndexHashed(int Key, const CItemList *pHashlist)
-{
-		int HashID = ((Key>>12)&0xf0) | (Key&0xf);
-		for(int i = 0; i < pHashlist[HashID].m_Num; i++)
-		{
-			if(pHashlist[HashID].m_aKeys[i] == Key)
-				return pHashlist[HashID].m_aIndex[i];
-	}
-
-	return -1;
-}
-
 static int DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
 {
-	int Needed = 0;
-	while(Size)
-	{
-		*pOut = *pCurrent-*pPast;
-		Needed |= *pOut;
-		pOut++;
-		pPast++;
-		pCurrent++;
-		Size--;
-	}
+	// most items don't change from one snapshot to the next
+	if(mem_comp(pPast, pCurrent, Size*sizeof(int)) == 0)
+		return 0;
 
-	return Needed;
+	for(int i = 0; i < Size; i++)
+		pOut[i] = pCurrent[i]-pPast[i];
+
+	return 1;
 }
 
 void CSnapshotDelta::UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size)
@@ -180,13 +134,11 @@ CSnapshotDelta::CData *CSnapshotDelta::EmptyDelta()
 	return &m_Empty;
 }
 
-// TODO: OPT: this should be made much faster
 int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pDstData)
 {
 	CData *pDelta = (CData *)pDstData;
 	int *pData = (int *)pDelta->m_pData;
 	int i, ItemSize, PastIndex;
-	const CSnapshotItem *pFromItem;
 	const CSnapshotItem *pCurItem;
 	const CSnapshotItem *pPastItem;
 	int SizeCount = 0;
@@ -195,32 +147,34 @@ int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pD
 	pDelta->m_NumUpdateItems = 0;
 	pDelta->m_NumTempItems = 0;
 
-	CItemList Hashlist[HASHLIST_SIZE];
-	GenerateHash(Hashlist, pTo);
+	// both key lists are sorted, so walk them side by side
+	const int *pFromKeys = pFrom->SortedKeys();
+	const int *pToKeys = pTo->SortedKeys();
+	const int NumFromItems = pFrom->NumItems();
+	const int NumItems = pTo->NumItems();
 
 	// pack deleted stuff
-	for(i = 0; i < pFrom->NumItems(); i++)
+	for(int f = 0, t = 0; f < NumFromItems; f++)
 	{
-		pFromItem = pFrom->GetItem(i);
-		if(GetItemIndexHashed(pFromItem->Key(), Hashlist) == -1)
+		while(t < NumItems && pToKeys[t] < pFromKeys[f])
+			t++;
+		if(t == NumItems || pToKeys[t] != pFromKeys[f])
 		{
 			// deleted
 			pDelta->m_NumDeletedItems++;
-			*pData = pFromItem->Key();
+			*pData = pFromKeys[f];
 			pData++;
 		}
 	}
 
-	GenerateHash(Hashlist, pFrom);
-	int aPastIndecies[1024];
-
 	// fetch previous indices
 	// we do this as a separate pass because it helps the cache
-	const int NumItems = pTo->NumItems();
-	for(i = 0; i < NumItems; i++)
+	int aPastIndecies[CSnapshotBuilder::MAX_ITEMS];
+	for(int t = 0, f = 0; t < NumItems; t++)
 	{
-		pCurItem = pTo->GetItem(i); // O(1) .. O(n)
-		aPastIndecies[i] = GetItemIndexHashed(pCurItem->Key(), Hashlist); // O(n) .. O(n^n)
+		while(f < NumFromItems && pFromKeys[f] < pToKeys[t])
+			f++;
+		aPastIndecies[t] = (f < NumFromItems && pFromKeys[f] == pToKeys[t]) ? f : -1;
 	}
 
 	for(i = 0; i < NumItems; i++)
@@ -318,31 +272,42 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 	if(pData > pEnd)
 		return -1;
 
+	// deltas created by CreateDelta list the deleted keys in order
+	bool DeletedSorted = true;
+	for(int d = 1; d < pDelta->m_NumDeletedItems && DeletedSorted; d++)
+		DeletedSorted = pDeleted[d-1] < pDeleted[d];
+	plain_range_sorted<const int> DeletedKeys(pDeleted, pDeleted + (pDelta->m_NumDeletedItems > 0 ? pDelta->m_NumDeletedItems : 0));
+
+	// remember where the kept items ended up
+	int *apKeptData[CSnapshotBuilder::MAX_ITEMS];
+	if(pFrom->NumItems() > CSnapshotBuilder::MAX_ITEMS)
+		return -1;
+
 	// copy all non deleted stuff
 	for(int i = 0; i < pFrom->NumItems(); i++)
 	{
-		// dbg_assert(0, "fail!");
 		pFromItem = pFrom->GetItem(i);
 		ItemSize = pFrom->GetItemSize(i);
-		Keep = 1;
-		for(int d = 0; d < pDelta->m_NumDeletedItems; d++)
-		{
-			if(pDeleted[d] == pFromItem->Key())
-			{
-				Keep = 0;
-				break;
-			}
-		}
+		if(DeletedSorted)
+			Keep = ::find_binary(DeletedKeys, pFromItem->Key()).empty();
+		else
+			Keep = ::find_linear(DeletedKeys, pFromItem->Key()).empty();
 
+		apKeptData[i] = 0;
 		if(Keep)
 		{
 			// keep it
-			mem_copy(
-				Builder.NewItem(pFromItem->Type(), pFromItem->ID(), ItemSize),
-				pFromItem->Data(), ItemSize);
+			apKeptData[i] = (int *)Builder.NewItem(pFromItem->Type(), pFromItem->ID(), ItemSize);
+			if(apKeptData[i])
+				mem_copy(apKeptData[i], pFromItem->Data(), ItemSize);
 		}
 	}
 
+	// updates created by CreateDelta come in key order without duplicates,
+	// so an item can only exist in the builder if it was kept from the old snapshot
+	int LastKey = 0;
+	bool UpdatesSorted = true;
+
 	// unpack updated stuff
 	for(int i = 0; i < pDelta->m_NumUpdateItems; i++)
 	{
@@ -366,15 +331,22 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 		if(RangeCheck(pEnd, pData, ItemSize) || ItemSize < 0) return -3;
 
 		Key = (Type<<16)|(ID&0xffff);
+		if(i > 0 && Key <= LastKey)
+			UpdatesSorted = false;
+		LastKey = Key;
+
+		FromIndex = pFrom->GetItemIndex(Key);
 
 		// create the item if needed
-		pNewData = Builder.GetItemData(Key);
+		if(UpdatesSorted)
+			pNewData = FromIndex != -1 ? apKeptData[FromIndex] : 0;
+		else
+			pNewData = Builder.GetItemData(Key);
 		if(!pNewData)
 			pNewData = (int *)Builder.NewItem(Key>>16, Key&0xffff, ItemSize);
 
 		//if(range_check(pEnd, pNewData, ItemSize)) return -4;
 
-		FromIndex = pFrom->GetItemIndex(Key);
 		if(FromIndex != -1)
 		{
 			// we got an update so we need to apply the diff
@@ -507,6 +479,211 @@ int CSnapshotStorage::Get(int Tick, int64 *pTagtime, CSnapshot **ppData, CSnapsh
 	return -1;
 }
 
+// CSnapshotPool
+
+CSnapshotPool::CSnapshotPool()
+{
+	m_pData = 0;
+	m_DataSize = 0;
+	m_pEntries = 0;
+	m_MaxEntries = 0;
+	m_FirstSeq = 0;
+	m_NextSeq = 0;
+	m_NextOffset = 0;
+}
+
+CSnapshotPool::~CSnapshotPool()
+{
+	mem_free(m_pData);
+	mem_free(m_pEntries);
+}
+
+void CSnapshotPool::Init(int DataSize, int MaxEntries)
+{
+	dbg_assert(DataSize >= CSnapshot::MAX_SIZE, "snapshot pool too small");
+	dbg_assert(MaxEntries > 0 && (MaxEntries&(MaxEntries-1)) == 0, "snapshot pool entries must be a power of two");
+
+	mem_free(m_pData);
+	mem_free(m_pEntries);
+	m_pData = (char *)mem_alloc(DataSize, 1);
+	m_DataSize = DataSize;
+	m_pEntries = (CEntry *)mem_alloc(sizeof(CEntry)*MaxEntries, 1);
+	m_MaxEntries = MaxEntries;
+	m_FirstSeq = 0;
+	m_NextSeq = 0;
+	m_NextOffset = 0;
+}
+
+CSnapshotPool::CEntry *CSnapshotPool::GetEntry(unsigned Handle) const
+{
+	// handles of entries that got removed are older than the first one
+	if(Handle-m_FirstSeq >= m_NextSeq-m_FirstSeq)
+		return 0;
+	return &m_pEntries[Handle&(m_MaxEntries-1)];
+}
+
+int CSnapshotPool::FindSpace(int Size) const
+{
+	if(!NumEntries())
+		return Size <= m_DataSize ? 0 : -1;
+
+	int FirstOffset = m_pEntries[m_FirstSeq&(m_MaxEntries-1)].m_Offset;
+	if(m_NextOffset > FirstOffset)
+	{
+		// free space at the end and in front of the first entry
+		if(m_NextOffset+Size <= m_DataSize)
+			return m_NextOffset;
+		return Size <= FirstOffset ? 0 : -1;
+	}
+
+	// wrapped around, the free space is in front of the first entry
+	return m_NextOffset+Size <= FirstOffset ? m_NextOffset : -1;
+}
+
+void CSnapshotPool::PopFirst()
+{
+	m_FirstSeq++;
+	if(!NumEntries())
+		m_NextOffset = 0;
+}
+
+unsigned CSnapshotPool::Add(int Tick, const CSnapshot *pSnap, int DataSize)
+{
+	int Crc = pSnap->Crc();
+
+	// snapshots of the same tick are added next to each other
+	for(unsigned Seq = m_NextSeq; Seq != m_FirstSeq; Seq--)
+	{
+		CEntry *pEntry = &m_pEntries[(Seq-1)&(m_MaxEntries-1)];
+		if(pEntry->m_Tick != Tick)
+			break;
+		if(pEntry->m_Crc == Crc && pEntry->m_Size == DataSize && mem_comp(m_pData+pEntry->m_Offset, pSnap, DataSize) == 0)
+		{
+			pEntry->m_Refs++;
+			return Seq-1;
+		}
+	}
+
+	// drop the oldest snapshots if we run out of space
+	int Size = (DataSize+3)&~3;
+	int Offset = -1;
+	while(1)
+	{
+		if(NumEntries() < m_MaxEntries)
+		{
+			Offset = FindSpace(Size);
+			if(Offset >= 0)
+				break;
+		}
+		dbg_assert(m_pEntries[m_FirstSeq&(m_MaxEntries-1)].m_Tick != Tick, "snapshot pool too small");
+		PopFirst();
+	}
+
+	CEntry *pEntry = &m_pEntries[m_NextSeq&(m_MaxEntries-1)];
+	pEntry->m_Tick = Tick;
+	pEntry->m_Refs = 1;
+	pEntry->m_Crc = Crc;
+	pEntry->m_Offset = Offset;
+	pEntry->m_Size = DataSize;
+	mem_copy(m_pData+Offset, pSnap, DataSize);
+	m_NextOffset = Offset+Size;
+	return m_NextSeq++;
+}
+
+void CSnapshotPool::Release(unsigned Handle)
+{
+	CEntry *pEntry = GetEntry(Handle);
+	if(!pEntry)
+		return;
+
+	pEntry->m_Refs--;
+	while(NumEntries() && m_pEntries[m_FirstSeq&(m_MaxEntries-1)].m_Refs == 0)
+		PopFirst();
+}
+
+int CSnapshotPool::Get(unsigned Handle, CSnapshot **ppData) const
+{
+	const CEntry *pEntry = GetEntry(Handle);
+	if(!pEntry)
+		return -1;
+
+	if(ppData)
+		*ppData = (CSnapshot *)(m_pData+pEntry->m_Offset);
+	return pEntry->m_Size;
+}
+
+// CSnapshotRing
+
+void CSnapshotRing::Init(CSnapshotPool *pPool)
+{
+	m_pPool = pPool;
+	for(int i = 0; i < MAX_TICKS; i++)
+		m_aSlots[i].m_Tick = -1;
+	m_FirstTick = 0;
+	m_LastTick = -1;
+}
+
+void CSnapshotRing::Clear(int Tick)
+{
+	CSlot *pSlot = &m_aSlots[Tick&(MAX_TICKS-1)];
+	if(pSlot->m_Tick != Tick)
+		return;
+	m_pPool->Release(pSlot->m_Handle);
+	pSlot->m_Tick = -1;
+}
+
+void CSnapshotRing::PurgeAll()
+{
+	for(int Tick = m_FirstTick; Tick <= m_LastTick; Tick++)
+		Clear(Tick);
+	m_FirstTick = 0;
+	m_LastTick = -1;
+}
+
+void CSnapshotRing::PurgeUntil(int Tick)
+{
+	for(; m_FirstTick <= m_LastTick && m_FirstTick < Tick; m_FirstTick++)
+		Clear(m_FirstTick);
+}
+
+CSnapshot *CSnapshotRing::Add(int Tick, int64 Tagtime, int DataSize, const void *pData)
+{
+	if(Tick < 0)
+		return 0;
+
+	if(Tick <= m_LastTick)
+		PurgeAll(); // the tick got reset
+	else
+		PurgeUntil(Tick-MAX_TICKS+1);
+	if(m_FirstTick > m_LastTick)
+		m_FirstTick = Tick;
+	m_LastTick = Tick;
+
+	CSlot *pSlot = &m_aSlots[Tick&(MAX_TICKS-1)];
+	pSlot->m_Tick = Tick;
+	pSlot->m_Tagtime = Tagtime;
+	pSlot->m_Handle = m_pPool->Add(Tick, (const CSnapshot *)pData, DataSize);
+
+	CSnapshot *pSnap = 0;
+	m_pPool->Get(pSlot->m_Handle, &pSnap);
+	return pSnap;
+}
+
+int CSnapshotRing::Get(int Tick, int64 *pTagtime, CSnapshot **ppData) const
+{
+	if(Tick < m_FirstTick || Tick > m_LastTick)
+		return -1;
+
+	const CSlot *pSlot = &m_aSlots[Tick&(MAX_TICKS-1)];
+	if(pSlot->m_Tick != Tick)
+		return -1;
+
+	int Size = m_pPool->Get(pSlot->m_Handle, ppData);
+	if(Size >= 0 && pTagtime)
+		*pTagtime = pSlot->m_Tagtime;
+	return Size;
+}
+
 // CSnapshotBuilder
 
 void CSnapshotBuilder::Init()
@@ -27,6 +27,7 @@ public:
 class CSnapshot
 {
 	friend class CSnapshotBuilder;
+	friend class CSnapshotDelta;
 	int m_DataSize;
 	int m_NumItems;
 
@@ -120,13 +121,91 @@ public:
 	int Get(int Tick, int64 *pTagtime, CSnapshot **ppData, CSnapshot **ppAltData);
 };
 
+// CSnapshotPool
+
+// snapshot data shared between several CSnapshotRing. the snapshots are kept in
+// one preallocated buffer in the order they were added and identical snapshots
+// of the same tick are only stored once.
+class CSnapshotPool
+{
+	struct CEntry
+	{
+		int m_Tick;
+		int m_Refs;
+		int m_Crc;
+		int m_Offset;
+		int m_Size;
+	};
+
+	char *m_pData;
+	int m_DataSize;
+	CEntry *m_pEntries;
+	int m_MaxEntries;
+
+	unsigned m_FirstSeq;
+	unsigned m_NextSeq;
+	int m_NextOffset;
+
+	CEntry *GetEntry(unsigned Handle) const;
+	int FindSpace(int Size) const;
+	void PopFirst();
+
+public:
+	CSnapshotPool();
+	~CSnapshotPool();
+
+	void Init(int DataSize, int MaxEntries);
+	int NumEntries() const { return (int)(m_NextSeq-m_FirstSeq); }
+
+	// returns a handle that holds one reference
+	unsigned Add(int Tick, const CSnapshot *pSnap, int DataSize);
+	void Release(unsigned Handle);
+	int Get(unsigned Handle, CSnapshot **ppData) const;
+};
+
+// CSnapshotRing
+
+// tick indexed snapshot history that keeps its data in a CSnapshotPool
+class CSnapshotRing
+{
+public:
+	enum
+	{
+		MAX_TICKS=256,
+	};
+
+private:
+	struct CSlot
+	{
+		int m_Tick;
+		int64 m_Tagtime;
+		unsigned m_Handle;
+	};
+
+	CSnapshotPool *m_pPool;
+	CSlot m_aSlots[MAX_TICKS];
+	int m_FirstTick;
+	int m_LastTick;
+
+	void Clear(int Tick);
+
+public:
+	void Init(CSnapshotPool *pPool);
+	void PurgeAll();
+	void PurgeUntil(int Tick);
+	CSnapshot *Add(int Tick, int64 Tagtime, int DataSize, const void *pData);
+	int Get(int Tick, int64 *pTagtime, CSnapshot **ppData) const;
+};
+
 class CSnapshotBuilder
 {
+public:
 	enum
 	{
 		MAX_ITEMS = 1024
 	};
 
+private:
 	char m_aData[CSnapshot::MAX_SIZE];
 	int m_DataSize;
 
@@ -17,6 +17,12 @@
 //#include "camera.h"
 #include "debughud.h"
 
+CDebugHud::CDebugHud()
+{
+	mem_zero(m_aFrameStats, sizeof(m_aFrameStats));
+	m_CurFrameStats = 0;
+}
+
 void CDebugHud::RenderNetCorrections()
 {
 	if(!g_Config.m_Debug || g_Config.m_DbgGraphs || !m_pClient->m_Snap.m_pLocalCharacter || !m_pClient->m_Snap.m_pLocalPrevCharacter)
@@ -138,8 +144,68 @@ void CDebugHud::RenderTuning()
 	TextRender()->TextColor(1,1,1,1);
 }
 
+void CDebugHud::RenderFramePacing()
+{
+	if(!g_Config.m_DbgFramePacing)
+		return;
+
+	Graphics()->GetFrameStats(&m_aFrameStats[m_CurFrameStats]);
+	m_CurFrameStats = (m_CurFrameStats+1)%NUM_PACING_FRAMES;
+
+	float Width = 300*Graphics()->ScreenAspect();
+	Graphics()->MapScreen(0, 0, Width, 300);
+
+	// one bar per frame, the submit time at the bottom and the wait for the backend on top of it.
+	// the full height is 1/30 s, the line marks 1/60 s
+	const float GraphW = NUM_PACING_FRAMES*1.0f, GraphH = 40.0f;
+	const float x = Width-GraphW-5.0f, y = 240.0f;
+	const float Scale = GraphH*30.0f/time_freq();
+
+	Graphics()->TextureClear();
+	Graphics()->QuadsBegin();
+	Graphics()->SetColor(0.0f, 0.0f, 0.0f, 0.5f);
+	IGraphics::CQuadItem QuadItem(x, y, GraphW, GraphH);
+	Graphics()->QuadsDrawTL(&QuadItem, 1);
+	Graphics()->SetColor(1.0f, 1.0f, 1.0f, 0.5f);
+	QuadItem = IGraphics::CQuadItem(x, y+GraphH/2, GraphW, 0.5f);
+	Graphics()->QuadsDrawTL(&QuadItem, 1);
+
+	int64 SubmitSum = 0, WaitSum = 0, SubmitMax = 0, WaitMax = 0;
+	int DepthSum = 0;
+	for(int i = 0; i < NUM_PACING_FRAMES; i++)
+	{
+		const IGraphics::CFrameStats *pStats = &m_aFrameStats[(m_CurFrameStats+i)%NUM_PACING_FRAMES];
+		float SubmitH = min(pStats->m_SubmitTime*Scale, GraphH);
+		float WaitH = min(pStats->m_WaitTime*Scale, GraphH-SubmitH);
+		Graphics()->SetColor(0.3f, 0.6f, 1.0f, 1.0f);
+		QuadItem = IGraphics::CQuadItem(x+i, y+GraphH-SubmitH, 1.0f, SubmitH);
+		Graphics()->QuadsDrawTL(&QuadItem, 1);
+		Graphics()->SetColor(1.0f, 0.3f, 0.3f, 1.0f);
+		QuadItem = IGraphics::CQuadItem(x+i, y+GraphH-SubmitH-WaitH, 1.0f, WaitH);
+		Graphics()->QuadsDrawTL(&QuadItem, 1);
+
+		SubmitSum += pStats->m_SubmitTime;
+		WaitSum += pStats->m_WaitTime;
+		SubmitMax = max(SubmitMax, pStats->m_SubmitTime);
+		WaitMax = max(WaitMax, pStats->m_WaitTime);
+		DepthSum += pStats->m_QueueDepth;
+	}
+	Graphics()->QuadsEnd();
+
+	const IGraphics::CFrameStats *pLast = &m_aFrameStats[(m_CurFrameStats+NUM_PACING_FRAMES-1)%NUM_PACING_FRAMES];
+	float ToMs = 1000.0f/time_freq();
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "submit: %.2f ms (max %.2f)", SubmitSum*ToMs/NUM_PACING_FRAMES, SubmitMax*ToMs);
+	TextRender()->Text(0, x, y-18.0f, 5.0f, aBuf, -1.0f);
+	str_format(aBuf, sizeof(aBuf), "wait: %.2f ms (max %.2f)", WaitSum*ToMs/NUM_PACING_FRAMES, WaitMax*ToMs);
+	TextRender()->Text(0, x, y-12.0f, 5.0f, aBuf, -1.0f);
+	str_format(aBuf, sizeof(aBuf), "queue: %.1f of %d buffers", DepthSum/(float)NUM_PACING_FRAMES, pLast->m_NumCommandBuffers);
+	TextRender()->Text(0, x, y-6.0f, 5.0f, aBuf, -1.0f);
+}
+
 void CDebugHud::OnRender()
 {
 	RenderTuning();
 	RenderNetCorrections();
+	RenderFramePacing();
 }
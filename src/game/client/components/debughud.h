@@ -2,13 +2,24 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef GAME_CLIENT_COMPONENTS_DEBUGHUD_H
 #define GAME_CLIENT_COMPONENTS_DEBUGHUD_H
+#include <engine/graphics.h>
 #include <game/client/component.h>
 
 class CDebugHud : public CComponent
 {
+	enum
+	{
+		NUM_PACING_FRAMES = 128,
+	};
+
+	IGraphics::CFrameStats m_aFrameStats[NUM_PACING_FRAMES];
+	int m_CurFrameStats;
+
 	void RenderNetCorrections();
 	void RenderTuning();
+	void RenderFramePacing();
 public:
+	CDebugHud();
 	virtual void OnRender();
 };
 
@@ -39,6 +39,8 @@ void CMapLayers::OnStateChange(int NewState, int OldState)
 
 void CMapLayers::LoadBackgroundMap()
 {
+	FreeTilemapBuffers(m_lTilemapBuffersMenu);
+
 	if(!g_Config.m_ClShowMenuMap)
 		return;
 
@@ -70,6 +72,7 @@ void CMapLayers::LoadBackgroundMap()
 	RenderTools()->RenderTilemapGenerateSkip(m_pMenuLayers);
 	m_pClient->m_pMapimages->OnMenuMapLoad(m_pMenuMap);
 	LoadEnvPoints(m_pMenuLayers, m_lEnvPointsMenu);
+	BuildTilemapBuffers(m_pMenuLayers, m_lTilemapBuffersMenu, true);
 }
 
 void CMapLayers::OnInit()
@@ -142,7 +145,10 @@ static void PlaceEggDoodads(int LayerWidth, int LayerHeight, CTile* aOutTiles, C
 void CMapLayers::OnMapLoad()
 {
 	if(Layers())
+	{
 		LoadEnvPoints(Layers(), m_lEnvPoints);
+		BuildTilemapBuffers(Layers(), m_lTilemapBuffers, false);
+	}
 
 	// easter time, place eggs
 	if(m_pClient->IsEaster())
@@ -197,6 +203,9 @@ void CMapLayers::OnMapLoad()
 
 void CMapLayers::OnShutdown()
 {
+	FreeTilemapBuffers(m_lTilemapBuffers);
+	FreeTilemapBuffers(m_lTilemapBuffersMenu);
+
 	if(m_pEggTiles)
 	{
 		mem_free(m_pEggTiles);
@@ -263,6 +272,43 @@ void CMapLayers::LoadEnvPoints(const CLayers *pLayers, array<CEnvPoint>& lEnvPoi
 	}
 }
 
+void CMapLayers::BuildTilemapBuffers(CLayers *pLayers, array<CTilemapBuffer>& lBuffers, bool MenuMap)
+{
+	FreeTilemapBuffers(lBuffers);
+	lBuffers.set_size(pLayers->NumLayers());
+
+	bool PassedGameLayer = false;
+	for(int g = 0; g < pLayers->NumGroups(); g++)
+	{
+		CMapItemGroup *pGroup = pLayers->GetGroup(g);
+		for(int l = 0; l < pGroup->m_NumLayers; l++)
+		{
+			CMapItemLayer *pLayer = pLayers->GetLayer(pGroup->m_StartLayer+l);
+			if(pLayer == (CMapItemLayer*)pLayers->GameLayer())
+			{
+				PassedGameLayer = true;
+				continue;
+			}
+
+			// the background renders the whole menu map but only what is behind the game layer of a game map
+			bool Render = m_Type == TYPE_BACKGROUND ? (MenuMap || !PassedGameLayer) : PassedGameLayer;
+			if(!Render || pLayer->m_Type != LAYERTYPE_TILES)
+				continue;
+
+			CMapItemLayerTilemap *pTMap = (CMapItemLayerTilemap *)pLayer;
+			CTile *pTiles = (CTile *)pLayers->Map()->GetData(pTMap->m_Data);
+			RenderTools()->RenderTilemapBuild(&lBuffers[pGroup->m_StartLayer+l], pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f);
+		}
+	}
+}
+
+void CMapLayers::FreeTilemapBuffers(array<CTilemapBuffer>& lBuffers)
+{
+	for(int i = 0; i < lBuffers.size(); i++)
+		RenderTools()->RenderTilemapFree(&lBuffers[i]);
+	lBuffers.clear();
+}
+
 void CMapLayers::EnvelopeUpdate()
 {
 	if(Client()->State() == IClient::STATE_DEMOPLAYBACK)
@@ -457,13 +503,27 @@ void CMapLayers::OnRender()
 							Graphics()->TextureSet(m_pClient->m_pMapimages->Get(pTMap->m_Image));
 
 						CTile *pTiles = (CTile *)pLayers->Map()->GetData(pTMap->m_Data);
-						Graphics()->BlendNone();
 						vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f);
-						RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
-														EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
-						Graphics()->BlendNormal();
-						RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
-														EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+						array<CTilemapBuffer> &lBuffers = pLayers == m_pMenuLayers ? m_lTilemapBuffersMenu : m_lTilemapBuffers;
+						int LayerIndex = pGroup->m_StartLayer+l;
+						if(g_Config.m_GfxTileBuffers && LayerIndex < lBuffers.size() && lBuffers[LayerIndex].m_pChunks)
+						{
+							Graphics()->BlendNone();
+							RenderTools()->RenderTilemapBuffered(&lBuffers[LayerIndex], pTiles, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
+															EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+							Graphics()->BlendNormal();
+							RenderTools()->RenderTilemapBuffered(&lBuffers[LayerIndex], pTiles, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
+															EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+						}
+						else
+						{
+							Graphics()->BlendNone();
+							RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
+															EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+							Graphics()->BlendNormal();
+							RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
+															EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+						}
 					}
 					else if(pLayer->m_Type == LAYERTYPE_QUADS)
 					{
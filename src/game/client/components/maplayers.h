@@ -19,6 +19,10 @@ class CMapLayers : public CComponent
 	array<CEnvPoint> m_lEnvPoints;
 	array<CEnvPoint> m_lEnvPointsMenu;
 
+	// by layer index, for the tile layers this component renders
+	array<CTilemapBuffer> m_lTilemapBuffers;
+	array<CTilemapBuffer> m_lTilemapBuffersMenu;
+
 	CTile* m_pEggTiles;
 	int m_EggLayerWidth;
 	int m_EggLayerHeight;
@@ -26,6 +30,8 @@ class CMapLayers : public CComponent
 	static void EnvelopeEval(float TimeOffset, int Env, float *pChannels, void *pUser);
 
 	void LoadEnvPoints(const CLayers *pLayers, array<CEnvPoint>& lEnvPoints);
+	void BuildTilemapBuffers(CLayers *pLayers, array<CTilemapBuffer>& lBuffers, bool MenuMap);
+	void FreeTilemapBuffers(array<CTilemapBuffer>& lBuffers);
 	void LoadBackgroundMap();
 
 public:
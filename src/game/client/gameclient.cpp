@@ -12,6 +12,7 @@
 #include <engine/serverbrowser.h>
 #include <engine/shared/demo.h>
 #include <engine/shared/config.h>
+#include <engine/shared/profiler.h>
 
 #include <generated/protocol.h>
 #include <generated/client_data.h>
@@ -123,7 +124,7 @@ static CMapLayers gs_MapLayersBackGround(CMapLayers::TYPE_BACKGROUND);
 static CMapLayers gs_MapLayersForeGround(CMapLayers::TYPE_FOREGROUND);
 
 CGameClient::CStack::CStack() { m_Num = 0; }
-void CGameClient::CStack::Add(class CComponent *pComponent) { m_paComponents[m_Num++] = pComponent; }
+void CGameClient::CStack::Add(class CComponent *pComponent, const char *pName) { m_paComponents[m_Num] = pComponent; m_apNames[m_Num++] = pName; }
 
 const char *CGameClient::Version() const { return GAME_VERSION; }
 const char *CGameClient::NetVersion() const { return GAME_NETVERSION; }
@@ -134,6 +135,48 @@ const char *CGameClient::GetItemName(int Type) const { return m_NetObjHandler.Ge
 bool CGameClient::IsXmas() const { return g_Config.m_ClShowXmasHats == 2 || (g_Config.m_ClShowXmasHats == 1 && m_IsXmasDay); }
 bool CGameClient::IsEaster() const { return g_Config.m_ClShowEasterEggs == 2 || (g_Config.m_ClShowEasterEggs == 1 && m_IsEasterDay); }
 
+struct CGameClient::CRenderProfile
+{
+	CProfileHistogram m_aHistograms[CStack::MAX_COMPONENTS];
+	int64 m_aTimes[CStack::MAX_COMPONENTS];
+};
+
+void CGameClient::SetRenderProfiling(bool Enabled)
+{
+	if(Enabled && !m_pRenderProfile)
+	{
+		m_pRenderProfile = (CRenderProfile *)mem_alloc(sizeof(CRenderProfile), 1);
+		mem_zero(m_pRenderProfile, sizeof(CRenderProfile));
+	}
+	else if(!Enabled && m_pRenderProfile)
+	{
+		mem_free(m_pRenderProfile);
+		m_pRenderProfile = 0;
+	}
+}
+
+int CGameClient::ReportRenderProfile(void (*pfnLine)(const char *pLine, void *pUser), void *pUser) const
+{
+	if(!m_pRenderProfile)
+		return 0;
+
+	int NumLines = 0;
+	for(int i = 0; i < m_All.m_Num; i++)
+	{
+		const CProfileHistogram *pStats = &m_pRenderProfile->m_aHistograms[i];
+		if(!pStats->Count())
+			continue;
+
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%-22s n=%-6d avg=%8.2fus p50=%6dus p99=%6dus max=%6dus",
+			m_All.m_apNames[i], pStats->Count(), m_pRenderProfile->m_aTimes[i]*1000000.0/time_freq()/pStats->Count(),
+			(int)pStats->Percentile(50), (int)pStats->Percentile(99), (int)pStats->Max());
+		pfnLine(aBuf, pUser);
+		NumLines++;
+	}
+	return NumLines;
+}
+
 enum
 {
 	STR_TEAM_GAME,
@@ -242,55 +285,56 @@ void CGameClient::OnConsoleInit()
 	m_pMapLayersBackGround = &::gs_MapLayersBackGround;
 	m_pMapLayersForeGround = &::gs_MapLayersForeGround;
 	m_pStats = &::gs_Stats;
+	m_pRenderProfile = 0;
 
 	// make a list of all the systems, make sure to add them in the corrent render order
-	m_All.Add(m_pSkins);
-	m_All.Add(m_pCountryFlags);
-	m_All.Add(m_pMapimages);
-	m_All.Add(m_pEffects); // doesn't render anything, just updates effects
-	m_All.Add(m_pParticles); // doesn't render anything, just updates all the particles
-	m_All.Add(m_pBinds);
-	m_All.Add(&m_pBinds->m_SpecialBinds);
-	m_All.Add(m_pControls);
-	m_All.Add(m_pCamera);
-	m_All.Add(m_pSounds);
-	m_All.Add(m_pVoting);
-
-	m_All.Add(&gs_MapLayersBackGround); // first to render
-	m_All.Add(&m_pParticles->m_RenderTrail);
-	m_All.Add(m_pItems);
-	m_All.Add(&gs_Players);
-	m_All.Add(&gs_MapLayersForeGround);
-	m_All.Add(&m_pParticles->m_RenderExplosions);
-	m_All.Add(&gs_NamePlates);
-	m_All.Add(&m_pParticles->m_RenderGeneral);
-	m_All.Add(m_pDamageind);
-	m_All.Add(&gs_Hud);
-	m_All.Add(&gs_Spectator);
-	m_All.Add(&gs_Emoticon);
-	m_All.Add(&gs_InfoMessages);
-	m_All.Add(m_pChat);
-	m_All.Add(&gs_Broadcast);
-	m_All.Add(&gs_DebugHud);
-	m_All.Add(&gs_Notifications);
-	m_All.Add(&gs_Scoreboard);
-	m_All.Add(m_pStats);
-	m_All.Add(m_pMotd);
-	m_All.Add(m_pMenus);
-	m_All.Add(&m_pMenus->m_Binder);
-	m_All.Add(m_pGameConsole);
+	m_All.Add(m_pSkins, "skins");
+	m_All.Add(m_pCountryFlags, "countryflags");
+	m_All.Add(m_pMapimages, "mapimages");
+	m_All.Add(m_pEffects, "effects"); // doesn't render anything, just updates effects
+	m_All.Add(m_pParticles, "particles"); // doesn't render anything, just updates all the particles
+	m_All.Add(m_pBinds, "binds");
+	m_All.Add(&m_pBinds->m_SpecialBinds, "specialbinds");
+	m_All.Add(m_pControls, "controls");
+	m_All.Add(m_pCamera, "camera");
+	m_All.Add(m_pSounds, "sounds");
+	m_All.Add(m_pVoting, "voting");
+
+	m_All.Add(&gs_MapLayersBackGround, "maplayers_background"); // first to render
+	m_All.Add(&m_pParticles->m_RenderTrail, "particles_trail");
+	m_All.Add(m_pItems, "items");
+	m_All.Add(&gs_Players, "players");
+	m_All.Add(&gs_MapLayersForeGround, "maplayers_foreground");
+	m_All.Add(&m_pParticles->m_RenderExplosions, "particles_explosions");
+	m_All.Add(&gs_NamePlates, "nameplates");
+	m_All.Add(&m_pParticles->m_RenderGeneral, "particles_general");
+	m_All.Add(m_pDamageind, "damageind");
+	m_All.Add(&gs_Hud, "hud");
+	m_All.Add(&gs_Spectator, "spectator");
+	m_All.Add(&gs_Emoticon, "emoticon");
+	m_All.Add(&gs_InfoMessages, "infomessages");
+	m_All.Add(m_pChat, "chat");
+	m_All.Add(&gs_Broadcast, "broadcast");
+	m_All.Add(&gs_DebugHud, "debughud");
+	m_All.Add(&gs_Notifications, "notifications");
+	m_All.Add(&gs_Scoreboard, "scoreboard");
+	m_All.Add(m_pStats, "stats");
+	m_All.Add(m_pMotd, "motd");
+	m_All.Add(m_pMenus, "menus");
+	m_All.Add(&m_pMenus->m_Binder, "binder");
+	m_All.Add(m_pGameConsole, "gameconsole");
 
 	// build the input stack
-	m_Input.Add(&m_pMenus->m_Binder); // this will take over all input when we want to bind a key
-	m_Input.Add(&m_pBinds->m_SpecialBinds);
-	m_Input.Add(m_pGameConsole);
-	m_Input.Add(m_pChat); // chat has higher prio due to tha you can quit it by pressing esc
-	m_Input.Add(m_pMotd); // for pressing esc to remove it
-	m_Input.Add(m_pMenus);
-	m_Input.Add(&gs_Spectator);
-	m_Input.Add(&gs_Emoticon);
-	m_Input.Add(m_pControls);
-	m_Input.Add(m_pBinds);
+	m_Input.Add(&m_pMenus->m_Binder, "binder"); // this will take over all input when we want to bind a key
+	m_Input.Add(&m_pBinds->m_SpecialBinds, "specialbinds");
+	m_Input.Add(m_pGameConsole, "gameconsole");
+	m_Input.Add(m_pChat, "chat"); // chat has higher prio due to tha you can quit it by pressing esc
+	m_Input.Add(m_pMotd, "motd"); // for pressing esc to remove it
+	m_Input.Add(m_pMenus, "menus");
+	m_Input.Add(&gs_Spectator, "spectator");
+	m_Input.Add(&gs_Emoticon, "emoticon");
+	m_Input.Add(m_pControls, "controls");
+	m_Input.Add(m_pBinds, "binds");
 
 	// add the some console commands
 	Console()->Register("team", "i", CFGFLAG_CLIENT, ConTeam, this, "Switch team");
@@ -433,6 +477,7 @@ void CGameClient::OnConnected()
 {
 	m_Layers.Init(Kernel());
 	m_Collision.Init(Layers());
+	m_Prediction.Init(Collision());
 
 	RenderTools()->RenderTilemapGenerateSkip(Layers());
 
@@ -452,6 +497,7 @@ void CGameClient::OnReset()
 {
 	// clear out the invalid pointers
 	m_LastNewPredictedTick = -1;
+	m_Prediction.Reset();
 	mem_zero(&m_Snap, sizeof(m_Snap));
 
 	for(int i = 0; i < MAX_CLIENTS; i++)
@@ -546,8 +592,22 @@ void CGameClient::OnRender()
 	UpdatePositions();
 
 	// render all systems
-	for(int i = 0; i < m_All.m_Num; i++)
-		m_All.m_paComponents[i]->OnRender();
+	if(m_pRenderProfile)
+	{
+		for(int i = 0; i < m_All.m_Num; i++)
+		{
+			int64 Start = time_get();
+			m_All.m_paComponents[i]->OnRender();
+			int64 Time = time_get()-Start;
+			m_pRenderProfile->m_aTimes[i] += Time;
+			m_pRenderProfile->m_aHistograms[i].Add(Time*1000000/time_freq());
+		}
+	}
+	else
+	{
+		for(int i = 0; i < m_All.m_Num; i++)
+			m_All.m_paComponents[i]->OnRender();
+	}
 
 	// clear all events/input for this frame
 	Input()->Clear();
@@ -1075,6 +1135,9 @@ bool CompareTime(const CNetObj_PlayerInfo *Pl1, const CNetObj_PlayerInfo *Pl2)
 
 void CGameClient::OnNewSnapshot()
 {
+	// the prediction has to start from the new snapshot
+	m_Prediction.Reset();
+
 	// clear out the invalid pointers
 	mem_zero(&m_Snap, sizeof(m_Snap));
 
@@ -1447,6 +1510,11 @@ void CGameClient::OnDemoRecSnap()
 	pGameInfo->m_MatchCurrent = m_GameInfo.m_MatchCurrent;
 }
 
+static const int *PredictionInputCallback(int Tick, void *pUser)
+{
+	return static_cast<IClient *>(pUser)->GetInput(Tick);
+}
+
 void CGameClient::OnPredict()
 {
 	// store the previous values so we can detect prediction errors
@@ -1455,7 +1523,10 @@ void CGameClient::OnPredict()
 
 	// we can't predict without our own id or own character
 	if(m_LocalClientID == -1 || !m_Snap.m_aCharacters[m_LocalClientID].m_Active)
+	{
+		m_Prediction.Reset();
 		return;
+	}
 
 	// don't predict anything if we are paused or round/game is over
 	if(m_Snap.m_pGameData && m_Snap.m_pGameData->m_GameStateFlags&(GAMESTATEFLAG_PAUSED|GAMESTATEFLAG_ROUNDOVER|GAMESTATEFLAG_GAMEOVER))
@@ -1464,72 +1535,40 @@ void CGameClient::OnPredict()
 			m_PredictedChar.Read(m_Snap.m_pLocalCharacter);
 		if(m_Snap.m_pLocalPrevCharacter)
 			m_PredictedPrevChar.Read(m_Snap.m_pLocalPrevCharacter);
+		m_Prediction.Reset();
 		return;
 	}
 
-	// repredict character
-	CWorldCore World;
-	World.m_Tuning = m_Tuning;
-
 	// search for players
+	const CNetObj_CharacterCore *apSnapCores[MAX_CLIENTS];
 	for(int i = 0; i < MAX_CLIENTS; i++)
-	{
-		if(!m_Snap.m_aCharacters[i].m_Active)
-			continue;
+		apSnapCores[i] = m_Snap.m_aCharacters[i].m_Active ? &m_Snap.m_aCharacters[i].m_Cur : 0;
 
-		m_aClients[i].m_Predicted.Init(&World, Collision());
-		World.m_apCharacters[i] = &m_aClients[i].m_Predicted;
-		m_aClients[i].m_Predicted.Read(&m_Snap.m_aCharacters[i].m_Cur);
-	}
+	// repredict character, the ticks that got predicted in an earlier frame are kept
+	int StartTick = m_Prediction.Begin(Client()->GameTick(), Client()->PredGameTick(), apSnapCores, &m_Tuning,
+		m_LocalClientID, PredictionInputCallback, Client());
 
 	// predict
-	for(int Tick = Client()->GameTick()+1; Tick <= Client()->PredGameTick(); Tick++)
+	for(int Tick = StartTick+1; Tick <= Client()->PredGameTick(); Tick++)
 	{
 		// fetch the local
-		if(Tick == Client()->PredGameTick() && World.m_apCharacters[m_LocalClientID])
-			m_PredictedPrevChar = *World.m_apCharacters[m_LocalClientID];
-
-		// first calculate where everyone should move
-		for(int c = 0; c < MAX_CLIENTS; c++)
-		{
-			if(!World.m_apCharacters[c])
-				continue;
-
-			mem_zero(&World.m_apCharacters[c]->m_Input, sizeof(World.m_apCharacters[c]->m_Input));
-			if(m_LocalClientID == c)
-			{
-				// apply player input
-				const int *pInput = Client()->GetInput(Tick);
-				if(pInput)
-					World.m_apCharacters[c]->m_Input = *((const CNetObj_PlayerInput*)pInput);
-				World.m_apCharacters[c]->Tick(true);
-			}
-			else
-				World.m_apCharacters[c]->Tick(false);
-
-		}
+		CCharacterCore *pLocalChar = m_Prediction.Character(m_LocalClientID);
+		if(Tick == Client()->PredGameTick() && pLocalChar)
+			m_PredictedPrevChar = *pLocalChar;
 
-		// move all players and quantize their data
-		for(int c = 0; c < MAX_CLIENTS; c++)
-		{
-			if(!World.m_apCharacters[c])
-				continue;
-
-			World.m_apCharacters[c]->Move();
-			World.m_apCharacters[c]->Quantize();
-		}
+		m_Prediction.Tick(Client()->GetInput(Tick));
 
 		// check if we want to trigger effects
 		if(Tick > m_LastNewPredictedTick)
 		{
 			m_LastNewPredictedTick = Tick;
 
-			if(m_LocalClientID != -1 && World.m_apCharacters[m_LocalClientID])
-				ProcessTriggeredEvents(World.m_apCharacters[m_LocalClientID]->m_TriggeredEvents, World.m_apCharacters[m_LocalClientID]->m_Pos);
+			if(pLocalChar)
+				ProcessTriggeredEvents(pLocalChar->m_TriggeredEvents, pLocalChar->m_Pos);
 		}
 
-		if(Tick == Client()->PredGameTick() && World.m_apCharacters[m_LocalClientID])
-			m_PredictedChar = *World.m_apCharacters[m_LocalClientID];
+		if(Tick == Client()->PredGameTick() && pLocalChar)
+			m_PredictedChar = *pLocalChar;
 	}
 
 	if(g_Config.m_Debug && g_Config.m_ClPredict && m_PredictedTick == Client()->PredGameTick())
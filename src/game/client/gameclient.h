@@ -8,6 +8,7 @@
 #include <engine/console.h>
 #include <game/layers.h>
 #include <game/gamecore.h>
+#include <game/prediction.h>
 #include "render.h"
 
 class CGameClient : public IGameClient
@@ -21,14 +22,19 @@ class CGameClient : public IGameClient
 		};
 
 		CStack();
-		void Add(class CComponent *pComponent);
+		void Add(class CComponent *pComponent, const char *pName);
 
 		class CComponent *m_paComponents[MAX_COMPONENTS];
+		const char *m_apNames[MAX_COMPONENTS];
 		int m_Num;
 	};
 
 	CStack m_All;
 	CStack m_Input;
+
+	// the CPU time of the OnRender of each component, 0 unless a benchmark asks for it
+	struct CRenderProfile;
+	CRenderProfile *m_pRenderProfile;
 	CNetObjHandler m_NetObjHandler;
 
 	class IEngine *m_pEngine;
@@ -54,6 +60,7 @@ class CGameClient : public IGameClient
 	void ProcessTriggeredEvents(int Events, vec2 Pos);
 	void UpdatePositions();
 
+	CPrediction m_Prediction;
 	int m_PredictedTick;
 	int m_LastNewPredictedTick;
 
@@ -187,7 +194,6 @@ public:
 		int m_Team;
 		int m_Emoticon;
 		int m_EmoticonStart;
-		CCharacterCore m_Predicted;
 
 		CTeeRenderInfo m_SkinInfo; // this is what the server reports
 		CTeeRenderInfo m_RenderInfo; // this is what we use
@@ -265,6 +271,10 @@ public:
 	virtual const char *NetVersionHashUsed() const;
 	virtual const char *NetVersionHashReal() const;
 	virtual int ClientVersion() const;
+
+	virtual void SetRenderProfiling(bool Enabled);
+	virtual int ReportRenderProfile(void (*pfnLine)(const char *pLine, void *pUser), void *pUser) const;
+
 	static void GetPlayerLabel(char* aBuf, int BufferSize, int ClientID, const char* ClientName);
 	bool IsXmas() const;
 	bool IsEaster() const;
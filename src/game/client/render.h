@@ -20,6 +20,7 @@ enum
 	LAYERRENDERFLAG_TRANSPARENT = 2,
 
 	TILERENDERFLAG_EXTEND = 4,
+	TILERENDERFLAG_OUTSIDE = 8, // only the extended tiles outside of the map
 };
 
 class CTeeRenderInfo
@@ -43,6 +44,33 @@ public:
 	int m_GotAirJump;
 };
 
+// the tiles of a layer in a quad buffer, chunk by chunk so only the ones on the screen get drawn
+class CTilemapBuffer
+{
+public:
+	enum
+	{
+		CHUNK_SIZE=16,
+	};
+
+	struct CChunk
+	{
+		int m_First;
+		int m_NumOpaque; // tiles with TILEFLAG_OPAQUE, they come first
+		int m_NumTransparent;
+	};
+
+	IGraphics::CQuadBufferHandle m_Buffer;
+	CChunk *m_pChunks; // 0 if the layer isn't buffered
+	int m_Width;
+	int m_Height;
+	int m_NumChunksX;
+	int m_NumChunksY;
+	float m_Scale;
+
+	CTilemapBuffer() : m_pChunks(0) {}
+};
+
 typedef void (*ENVELOPE_EVAL)(float TimeOffset, int Env, float *pChannels, void *pUser);
 class CTextCursor;
 
@@ -81,6 +109,9 @@ public:
 	static void RenderEvalEnvelope(CEnvPoint *pPoints, int NumPoints, int Channels, float Time, float *pResult);
 	void RenderQuads(CQuad *pQuads, int NumQuads, int Flags, ENVELOPE_EVAL pfnEval, void *pUser);
 	void RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
+	bool RenderTilemapBuild(CTilemapBuffer *pBuffer, const CTile *pTiles, int w, int h, float Scale);
+	void RenderTilemapFree(CTilemapBuffer *pBuffer);
+	void RenderTilemapBuffered(const CTilemapBuffer *pBuffer, CTile *pTiles, vec4 Color, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
 
 	// helpers
 	void MapScreenToWorld(float CenterX, float CenterY, float ParallaxX, float ParallaxY,
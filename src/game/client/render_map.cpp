@@ -330,6 +330,54 @@ void CRenderTools::RenderQuads(CQuad *pQuads, int NumQuads, int RenderFlags, ENV
 	Graphics()->WrapNormal();
 }
 
+// the texture coordinates of the corners of a tile, in the order of QuadsSetSubsetFree
+static void TileTexCoords(int Flags, float *pTexCoords)
+{
+	float x0 = 0;
+	float y0 = 0;
+	float x1 = 1;
+	float y1 = 0;
+	float x2 = 1;
+	float y2 = 1;
+	float x3 = 0;
+	float y3 = 1;
+
+	if(Flags&TILEFLAG_VFLIP)
+	{
+		x0 = x2;
+		x1 = x3;
+		x2 = x3;
+		x3 = x0;
+	}
+
+	if(Flags&TILEFLAG_HFLIP)
+	{
+		y0 = y3;
+		y2 = y1;
+		y3 = y1;
+		y1 = y0;
+	}
+
+	if(Flags&TILEFLAG_ROTATE)
+	{
+		float Tmp = x0;
+		x0 = x3;
+		x3 = x2;
+		x2 = x1;
+		x1 = Tmp;
+		Tmp = y0;
+		y0 = y3;
+		y3 = y2;
+		y2 = y1;
+		y1 = Tmp;
+	}
+
+	pTexCoords[0] = x0; pTexCoords[1] = y0;
+	pTexCoords[2] = x1; pTexCoords[3] = y1;
+	pTexCoords[4] = x2; pTexCoords[5] = y2;
+	pTexCoords[6] = x3; pTexCoords[7] = y3;
+}
+
 void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags,
 									ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset)
 {
@@ -364,6 +412,13 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 
 			if(RenderFlags&TILERENDERFLAG_EXTEND)
 			{
+				// the rest of the row is inside the map
+				if((RenderFlags&TILERENDERFLAG_OUTSIDE) && mx >= 0 && mx < w && my >= 0 && my < h)
+				{
+					x = w-1;
+					continue;
+				}
+
 				if(mx<0)
 					mx = 0;
 				if(mx>=w)
@@ -406,46 +461,10 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 
 				if(Render)
 				{
-					float x0 = 0;
-					float y0 = 0;
-					float x1 = 1;
-					float y1 = 0;
-					float x2 = 1;
-					float y2 = 1;
-					float x3 = 0;
-					float y3 = 1;
-
-					if(Flags&TILEFLAG_VFLIP)
-					{
-						x0 = x2;
-						x1 = x3;
-						x2 = x3;
-						x3 = x0;
-					}
-
-					if(Flags&TILEFLAG_HFLIP)
-					{
-						y0 = y3;
-						y2 = y1;
-						y3 = y1;
-						y1 = y0;
-					}
-
-					if(Flags&TILEFLAG_ROTATE)
-					{
-						float Tmp = x0;
-						x0 = x3;
-						x3 = x2;
-						x2 = x1;
-						x1 = Tmp;
-						Tmp = y0;
-						y0 = y3;
-						y3 = y2;
-						y2 = y1;
-						y1 = Tmp;
-					}
-
-					Graphics()->QuadsSetSubsetFree(x0, y0, x1, y1, x2, y2, x3, y3, Index);
+					float aTexCoords[8];
+					TileTexCoords(Flags, aTexCoords);
+					Graphics()->QuadsSetSubsetFree(aTexCoords[0], aTexCoords[1], aTexCoords[2], aTexCoords[3],
+						aTexCoords[4], aTexCoords[5], aTexCoords[6], aTexCoords[7], Index);
 					IGraphics::CQuadItem QuadItem(x*Scale, y*Scale, Scale, Scale);
 					Graphics()->QuadsDrawTL(&QuadItem, 1);
 				}
@@ -456,3 +475,142 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 	Graphics()->QuadsEnd();
 	Graphics()->MapScreen(ScreenX0, ScreenY0, ScreenX1, ScreenY1);
 }
+
+bool CRenderTools::RenderTilemapBuild(CTilemapBuffer *pBuffer, const CTile *pTiles, int w, int h, float Scale)
+{
+	RenderTilemapFree(pBuffer);
+
+	int NumTiles = 0;
+	for(int i = 0; i < w*h; i++)
+		if(pTiles[i].m_Index)
+			NumTiles++;
+
+	pBuffer->m_Width = w;
+	pBuffer->m_Height = h;
+	pBuffer->m_NumChunksX = (w+CTilemapBuffer::CHUNK_SIZE-1)/CTilemapBuffer::CHUNK_SIZE;
+	pBuffer->m_NumChunksY = (h+CTilemapBuffer::CHUNK_SIZE-1)/CTilemapBuffer::CHUNK_SIZE;
+	pBuffer->m_Scale = Scale;
+	pBuffer->m_pChunks = (CTilemapBuffer::CChunk *)mem_alloc(sizeof(CTilemapBuffer::CChunk)*pBuffer->m_NumChunksX*pBuffer->m_NumChunksY, 1);
+
+	IGraphics::CQuadBufferItem *pItems = (IGraphics::CQuadBufferItem *)mem_alloc(sizeof(IGraphics::CQuadBufferItem)*max(NumTiles, 1), 1);
+	int Num = 0;
+	for(int cy = 0; cy < pBuffer->m_NumChunksY; cy++)
+		for(int cx = 0; cx < pBuffer->m_NumChunksX; cx++)
+		{
+			CTilemapBuffer::CChunk *pChunk = &pBuffer->m_pChunks[cy*pBuffer->m_NumChunksX+cx];
+			pChunk->m_First = Num;
+
+			// the opaque tiles first, that way both passes draw one range of the chunk
+			for(int Pass = 0; Pass < 2; Pass++)
+			{
+				for(int y = cy*CTilemapBuffer::CHUNK_SIZE; y < min((cy+1)*CTilemapBuffer::CHUNK_SIZE, h); y++)
+					for(int x = cx*CTilemapBuffer::CHUNK_SIZE; x < min((cx+1)*CTilemapBuffer::CHUNK_SIZE, w); x++)
+					{
+						const CTile *pTile = &pTiles[y*w+x];
+						if(!pTile->m_Index || ((pTile->m_Flags&TILEFLAG_OPAQUE) != 0) != (Pass == 0))
+							continue;
+
+						IGraphics::CQuadBufferItem *pItem = &pItems[Num++];
+						pItem->m_Quad = IGraphics::CQuadItem(x*Scale, y*Scale, Scale, Scale);
+						TileTexCoords(pTile->m_Flags, pItem->m_aTexCoords);
+						pItem->m_TextureIndex = pTile->m_Index;
+					}
+
+				if(Pass == 0)
+					pChunk->m_NumOpaque = Num-pChunk->m_First;
+				else
+					pChunk->m_NumTransparent = Num-pChunk->m_First-pChunk->m_NumOpaque;
+			}
+		}
+
+	// an empty layer is buffered without a buffer
+	if(Num)
+	{
+		pBuffer->m_Buffer = Graphics()->CreateQuadBuffer(pItems, Num);
+		if(!pBuffer->m_Buffer.IsValid())
+			RenderTilemapFree(pBuffer);
+	}
+	mem_free(pItems);
+	return pBuffer->m_pChunks != 0;
+}
+
+void CRenderTools::RenderTilemapFree(CTilemapBuffer *pBuffer)
+{
+	Graphics()->DestroyQuadBuffer(&pBuffer->m_Buffer);
+	if(pBuffer->m_pChunks)
+		mem_free(pBuffer->m_pChunks);
+	pBuffer->m_pChunks = 0;
+}
+
+void CRenderTools::RenderTilemapBuffered(const CTilemapBuffer *pBuffer, CTile *pTiles, vec4 Color, int RenderFlags,
+									ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset)
+{
+	float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+	Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+
+	float r=1, g=1, b=1, a=1;
+	if(ColorEnv >= 0)
+	{
+		float aChannels[4];
+		pfnEval(ColorEnvOffset/1000.0f, ColorEnv, aChannels, pUser);
+		r = aChannels[0];
+		g = aChannels[1];
+		b = aChannels[2];
+		a = aChannels[3];
+	}
+
+	const float Alpha = Color.a*a;
+	const float Scale = pBuffer->m_Scale;
+	int StartY = (int)(ScreenY0/Scale)-1;
+	int StartX = (int)(ScreenX0/Scale)-1;
+	int EndY = (int)(ScreenY1/Scale)+1;
+	int EndX = (int)(ScreenX1/Scale)+1;
+
+	// like RenderTilemap, opaque tiles only go with the opaque pass while the layer is opaque
+	bool Opaque = Alpha > 254.0f/255.0f;
+	bool DrawOpaqueTiles = (RenderFlags&(Opaque ? LAYERRENDERFLAG_OPAQUE : LAYERRENDERFLAG_TRANSPARENT)) != 0;
+	bool DrawTransparentTiles = (RenderFlags&LAYERRENDERFLAG_TRANSPARENT) != 0;
+
+	if(StartX < pBuffer->m_Width && EndX > 0 && StartY < pBuffer->m_Height && EndY > 0)
+	{
+		int ChunkX0 = max(StartX, 0)/CTilemapBuffer::CHUNK_SIZE;
+		int ChunkY0 = max(StartY, 0)/CTilemapBuffer::CHUNK_SIZE;
+		int ChunkX1 = (min(EndX, pBuffer->m_Width)-1)/CTilemapBuffer::CHUNK_SIZE;
+		int ChunkY1 = (min(EndY, pBuffer->m_Height)-1)/CTilemapBuffer::CHUNK_SIZE;
+		vec4 DrawColor = vec4(Color.r*r*Alpha, Color.g*g*Alpha, Color.b*b*Alpha, Alpha);
+
+		IGraphics::CQuadBufferRange aRanges[128];
+		int NumRanges = 0;
+		for(int cy = ChunkY0; cy <= ChunkY1; cy++)
+			for(int cx = ChunkX0; cx <= ChunkX1; cx++)
+			{
+				const CTilemapBuffer::CChunk *pChunk = &pBuffer->m_pChunks[cy*pBuffer->m_NumChunksX+cx];
+				int First = DrawOpaqueTiles ? pChunk->m_First : pChunk->m_First+pChunk->m_NumOpaque;
+				int End = DrawTransparentTiles ? pChunk->m_First+pChunk->m_NumOpaque+pChunk->m_NumTransparent : pChunk->m_First+pChunk->m_NumOpaque;
+				if(First >= End)
+					continue;
+
+				// neighbouring chunks often continue the last range
+				if(NumRanges && aRanges[NumRanges-1].m_First+aRanges[NumRanges-1].m_Num == First)
+				{
+					aRanges[NumRanges-1].m_Num += End-First;
+					continue;
+				}
+
+				if(NumRanges == (int)(sizeof(aRanges)/sizeof(aRanges[0])))
+				{
+					Graphics()->QuadBufferDraw(pBuffer->m_Buffer, aRanges, NumRanges, DrawColor);
+					NumRanges = 0;
+				}
+				aRanges[NumRanges].m_First = First;
+				aRanges[NumRanges].m_Num = End-First;
+				NumRanges++;
+			}
+
+		Graphics()->QuadBufferDraw(pBuffer->m_Buffer, aRanges, NumRanges, DrawColor);
+	}
+
+	// the map's border tiles continue outside of it
+	if((RenderFlags&TILERENDERFLAG_EXTEND) && (StartX < 0 || StartY < 0 || EndX > pBuffer->m_Width || EndY > pBuffer->m_Height))
+		RenderTilemap(pTiles, pBuffer->m_Width, pBuffer->m_Height, Scale, Color, RenderFlags|TILERENDERFLAG_OUTSIDE, pfnEval, pUser, ColorEnv, ColorEnvOffset);
+}
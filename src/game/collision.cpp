@@ -12,51 +12,178 @@
 #include <game/layers.h>
 #include <game/collision.h>
 
+// sample points closer than this to a tile border are always checked
+static const float s_TileMargin = 1.0f/16.0f;
+
+// the tile a position ends up in, without clamping it to the map
+static int PixelToTile(float Value)
+{
+	return round_to_int(Value)/32;
+}
+
+// narrows the line parameter range [*pIn, *pOut] to where Start+Delta*t lies within [Min, Max]
+static void ClipLineAxis(float Start, float Delta, float InvDelta, float Min, float Max, float *pIn, float *pOut)
+{
+	if(Delta == 0.0f)
+	{
+		if(Start < Min || Start > Max)
+			*pOut = -1.0f;
+		return;
+	}
+
+	float t0 = (Min-Start)*InvDelta;
+	float t1 = (Max-Start)*InvDelta;
+	if(t0 > t1)
+	{
+		float Temp = t0;
+		t0 = t1;
+		t1 = Temp;
+	}
+	*pIn = max(*pIn, t0);
+	*pOut = min(*pOut, t1);
+}
+
 CCollision::CCollision()
 {
-	m_pTiles = 0;
+	m_pFlags = 0;
+	m_pDistances = 0;
 	m_Width = 0;
 	m_Height = 0;
 	m_pLayers = 0;
+	ResetStats();
+}
+
+CCollision::~CCollision()
+{
+	mem_free(m_pFlags);
+	mem_free(m_pDistances);
 }
 
-void CCollision::Init(class CLayers *pLayers)
+void CCollision::Init(class CLayers *pLayers, bool DistanceField)
 {
 	m_pLayers = pLayers;
-	m_Width = m_pLayers->GameLayer()->m_Width;
-	m_Height = m_pLayers->GameLayer()->m_Height;
-	m_pTiles = static_cast<CTile *>(m_pLayers->Map()->GetData(m_pLayers->GameLayer()->m_Data));
+	Init(static_cast<CTile *>(m_pLayers->Map()->GetData(m_pLayers->GameLayer()->m_Data)),
+		m_pLayers->GameLayer()->m_Width, m_pLayers->GameLayer()->m_Height, DistanceField);
+}
 
-	for(int i = 0; i < m_Width*m_Height; i++)
-	{
-		int Index = m_pTiles[i].m_Index;
+void CCollision::Init(const class CTile *pTiles, int Width, int Height, bool DistanceField)
+{
+	m_Width = Width;
+	m_Height = Height;
+	ResetStats();
 
-		if(Index > 128)
-			continue;
+	// the map data stays untouched, the flags go into their own compact buffer
+	mem_free(m_pFlags);
+	m_pFlags = (unsigned char *)mem_alloc((m_Width*m_Height+1)/2, 1);
+	mem_zero(m_pFlags, (m_Width*m_Height+1)/2);
 
-		switch(Index)
+	for(int i = 0; i < m_Width*m_Height; i++)
+	{
+		int Flags;
+		switch(pTiles[i].m_Index)
 		{
 		case TILE_DEATH:
-			m_pTiles[i].m_Index = COLFLAG_DEATH;
+			Flags = COLFLAG_DEATH;
 			break;
 		case TILE_SOLID:
-			m_pTiles[i].m_Index = COLFLAG_SOLID;
+			Flags = COLFLAG_SOLID;
 			break;
 		case TILE_NOHOOK:
-			m_pTiles[i].m_Index = COLFLAG_SOLID|COLFLAG_NOHOOK;
+			Flags = COLFLAG_SOLID|COLFLAG_NOHOOK;
 			break;
 		default:
-			m_pTiles[i].m_Index = 0;
+			Flags = 0;
 		}
+		m_pFlags[i>>1] |= Flags<<((i&1)*4);
 	}
+
+	mem_free(m_pDistances);
+	m_pDistances = 0;
+	if(DistanceField)
+		BuildDistances();
+}
+
+// chessboard distance in tiles to the nearest tile with any collision flag, in two sweeps
+void CCollision::BuildDistances()
+{
+	m_pDistances = (unsigned char *)mem_alloc(m_Width*m_Height, 1);
+	for(int i = 0; i < m_Width*m_Height; i++)
+		m_pDistances[i] = (m_pFlags[i>>1]>>((i&1)*4))&0xf ? 0 : MAX_DISTANCE;
+
+	for(int y = 0; y < m_Height; y++)
+		for(int x = 0; x < m_Width; x++)
+		{
+			int Dist = m_pDistances[y*m_Width+x];
+			if(x > 0)
+				Dist = min(Dist, m_pDistances[y*m_Width+x-1]+1);
+			if(y > 0)
+			{
+				for(int n = max(x-1, 0); n <= min(x+1, m_Width-1); n++)
+					Dist = min(Dist, m_pDistances[(y-1)*m_Width+n]+1);
+			}
+			m_pDistances[y*m_Width+x] = Dist;
+		}
+
+	for(int y = m_Height-1; y >= 0; y--)
+		for(int x = m_Width-1; x >= 0; x--)
+		{
+			int Dist = m_pDistances[y*m_Width+x];
+			if(x < m_Width-1)
+				Dist = min(Dist, m_pDistances[y*m_Width+x+1]+1);
+			if(y < m_Height-1)
+			{
+				for(int n = max(x-1, 0); n <= min(x+1, m_Width-1); n++)
+					Dist = min(Dist, m_pDistances[(y+1)*m_Width+n]+1);
+			}
+			m_pDistances[y*m_Width+x] = Dist;
+		}
+}
+
+void CCollision::GetStats(CStats *pStats) const
+{
+	pStats->m_FlagBytes = (m_Width*m_Height+1)/2;
+	pStats->m_DistanceBytes = m_pDistances ? m_Width*m_Height : 0;
+	pStats->m_NumLineQueries = m_NumLineQueries;
+	pStats->m_NumBoxQueries = m_NumBoxQueries;
+	pStats->m_NumTileProbes = m_NumTileProbes;
+}
+
+void CCollision::ResetStats() const
+{
+	m_NumLineQueries = 0;
+	m_NumBoxQueries = 0;
+	m_NumTileProbes = 0;
 }
 
 int CCollision::GetTile(int x, int y) const
 {
 	int Nx = clamp(x/32, 0, m_Width-1);
 	int Ny = clamp(y/32, 0, m_Height-1);
+	int Index = Ny*m_Width+Nx;
+
+	m_NumTileProbes++;
+	return (m_pFlags[Index>>1]>>((Index&1)*4))&0xf;
+}
 
-	return m_pTiles[Ny*m_Width+Nx].m_Index > 128 ? 0 : m_pTiles[Ny*m_Width+Nx].m_Index;
+// tiles to the nearest tile with collision flags, -1 without a distance field
+int CCollision::GetTileDistance(int TileX, int TileY) const
+{
+	if(!m_pDistances)
+		return -1;
+	return m_pDistances[clamp(TileY, 0, m_Height-1)*m_Width+clamp(TileX, 0, m_Width-1)];
+}
+
+// how many tiles around the tile are certainly free of the flags, -1 if the tile itself isn't
+int CCollision::GetFreeRadius(int TileX, int TileY, int Flag) const
+{
+	if(!m_pDistances)
+		return IsTile(TileX*32, TileY*32, Flag) ? -1 : 0;
+
+	// clamping can only move a position closer to the tile, so the map's border tiles do for the outside too
+	int Dist = GetTileDistance(TileX, TileY);
+	if(Dist == 0)
+		return IsTile(TileX*32, TileY*32, Flag) ? -1 : 0;
+	return Dist-1;
 }
 
 bool CCollision::IsTile(int x, int y, int Flag) const
@@ -64,14 +191,70 @@ bool CCollision::IsTile(int x, int y, int Flag) const
 	return GetTile(x, y)&Flag;
 }
 
-// TODO: rewrite this smarter!
+bool CCollision::IsAreaFree(int TileX0, int TileY0, int TileX1, int TileY1, int Flag) const
+{
+	for(int y = TileY0; y <= TileY1; y++)
+		for(int x = TileX0; x <= TileX1; x++)
+			if(IsTile(x*32, y*32, Flag))
+				return false;
+	return true;
+}
+
+// finds the positions around Pos in which none of the box corners can hit a tile with the flags
+void CCollision::GetFreeBox(vec2 Pos, vec2 HalfSize, int Flag, vec2 *pMin, vec2 *pMax) const
+{
+	int x0 = PixelToTile(Pos.x-HalfSize.x);
+	int y0 = PixelToTile(Pos.y-HalfSize.y);
+	int x1 = PixelToTile(Pos.x+HalfSize.x);
+	int y1 = PixelToTile(Pos.y+HalfSize.y);
+
+	// every tile within the smallest free radius of the covered tiles is free as well
+	int Radius = MAX_DISTANCE;
+	for(int y = y0; y <= y1 && Radius >= 0; y++)
+		for(int x = x0; x <= x1 && Radius >= 0; x++)
+			Radius = min(Radius, GetFreeRadius(x, y, Flag));
+	if(Radius < 0)
+	{
+		*pMin = vec2(0.0f, 0.0f);
+		*pMax = vec2(-1.0f, -1.0f);
+		return;
+	}
+
+	if(Radius > 0)
+	{
+		x0 -= Radius;
+		y0 -= Radius;
+		x1 += Radius;
+		y1 += Radius;
+	}
+	else
+	{
+		// widen it by a tile to every side that is free
+		if(IsAreaFree(x0-1, y0, x0-1, y1, Flag))
+			x0--;
+		if(IsAreaFree(x1+1, y0, x1+1, y1, Flag))
+			x1++;
+		if(IsAreaFree(x0, y0-1, x1, y0-1, Flag))
+			y0--;
+		if(IsAreaFree(x0, y1+1, x1, y1+1, Flag))
+			y1++;
+	}
+
+	*pMin = vec2(x0*32-0.5f+HalfSize.x+s_TileMargin, y0*32-0.5f+HalfSize.y+s_TileMargin);
+	*pMax = vec2(x1*32+31.5f-HalfSize.x-s_TileMargin, y1*32+31.5f-HalfSize.y-s_TileMargin);
+}
+
 int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const
 {
 	float Distance = distance(Pos0, Pos1);
 	int End(Distance+1);
-	vec2 Last = Pos0;
+	vec2 Delta = Pos1-Pos0;
+	vec2 InvDelta(Delta.x != 0.0f ? 1.0f/Delta.x : 0.0f, Delta.y != 0.0f ? 1.0f/Delta.y : 0.0f);
+	m_NumLineQueries++;
 
-	for(int i = 0; i <= End; i++)
+	// goes over the samples of the line like checking every pixel would, but
+	// jumps over the ones that surely end up in empty tiles
+	for(int i = 0; i <= End; )
 	{
 		float a = i/float(End);
 		vec2 Pos = mix(Pos0, Pos1, a);
@@ -80,10 +263,25 @@ int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *p
 			if(pOutCollision)
 				*pOutCollision = Pos;
 			if(pOutBeforeCollision)
-				*pOutBeforeCollision = Last;
+				*pOutBeforeCollision = i > 0 ? mix(Pos0, Pos1, (i-1)/float(End)) : Pos0;
 			return GetCollisionAt(Pos.x, Pos.y);
 		}
-		Last = Pos;
+
+		int Next = i+1;
+		int TileX = PixelToTile(Pos.x);
+		int TileY = PixelToTile(Pos.y);
+		int Radius = GetFreeRadius(TileX, TileY, COLFLAG_SOLID);
+		if(Radius >= 0)
+		{
+			// the part of the line that stays inside of the free tiles, away from their borders
+			float In = 0.0f;
+			float Out = 1.0f;
+			ClipLineAxis(Pos0.x, Delta.x, InvDelta.x, (TileX-Radius)*32-0.5f+s_TileMargin, (TileX+Radius)*32+31.5f-s_TileMargin, &In, &Out);
+			ClipLineAxis(Pos0.y, Delta.y, InvDelta.y, (TileY-Radius)*32-0.5f+s_TileMargin, (TileY+Radius)*32+31.5f-s_TileMargin, &In, &Out);
+			if(In <= a && Out > a)
+				Next = max(Next, (int)(Out*End)+1);
+		}
+		i = Next;
 	}
 	if(pOutCollision)
 		*pOutCollision = Pos1;
@@ -157,18 +355,25 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elas
 	if(pDeath)
 		*pDeath = false;
 
+	m_NumBoxQueries++;
 	if(Distance > 0.00001f)
 	{
-		//vec2 old_pos = pos;
+		// the box tests get skipped while the box stays in free space
+		vec2 FreeMin(0.0f, 0.0f);
+		vec2 FreeMax(-1.0f, -1.0f);
+		bool FindFree = true;
+
 		float Fraction = 1.0f/(float)(Max+1);
 		for(int i = 0; i <= Max; i++)
 		{
-			//float amount = i/(float)max;
-			//if(max == 0)
-				//amount = 0;
-
 			vec2 NewPos = Pos + Vel*Fraction; // TODO: this row is not nice
 
+			if(NewPos.x >= FreeMin.x && NewPos.x <= FreeMax.x && NewPos.y >= FreeMin.y && NewPos.y <= FreeMax.y)
+			{
+				Pos = NewPos;
+				continue;
+			}
+
 			//You hit a deathtile, congrats to that :)
 			//Deathtiles are a bit smaller
 			if(pDeath && TestBox(vec2(NewPos.x, NewPos.y), Size*(2.0f/3.0f), COLFLAG_DEATH))
@@ -204,6 +409,14 @@ void CCollision::MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elas
 					Vel.x *= -Elasticity;
 				}
 			}
+			else if(FindFree)
+			{
+				GetFreeBox(NewPos, Size*0.5f, pDeath && !*pDeath ? COLFLAG_SOLID|COLFLAG_DEATH : COLFLAG_SOLID, &FreeMin, &FreeMax);
+
+				// too close to a tile border, don't bother for the rest of the move
+				if(!(NewPos.x >= FreeMin.x && NewPos.x <= FreeMax.x && NewPos.y >= FreeMin.y && NewPos.y <= FreeMax.y))
+					FindFree = false;
+			}
 
 			Pos = NewPos;
 		}
@@ -3,17 +3,27 @@
 #ifndef GAME_COLLISION_H
 #define GAME_COLLISION_H
 
+#include <base/system.h>
 #include <base/vmath.h>
 
 class CCollision
 {
-	class CTile *m_pTiles;
+	unsigned char *m_pFlags; // collision flags, four bits per tile
+	unsigned char *m_pDistances; // tiles to the nearest one with collision flags, optional
 	int m_Width;
 	int m_Height;
 	class CLayers *m_pLayers;
 
+	mutable int64 m_NumLineQueries;
+	mutable int64 m_NumBoxQueries;
+	mutable int64 m_NumTileProbes;
+
 	bool IsTile(int x, int y, int Flag=COLFLAG_SOLID) const;
 	int GetTile(int x, int y) const;
+	int GetFreeRadius(int TileX, int TileY, int Flag) const;
+	bool IsAreaFree(int TileX0, int TileY0, int TileX1, int TileY1, int Flag) const;
+	void GetFreeBox(vec2 Pos, vec2 HalfSize, int Flag, vec2 *pMin, vec2 *pMax) const;
+	void BuildDistances();
 
 public:
 	enum
@@ -21,15 +31,31 @@ public:
 		COLFLAG_SOLID=1,
 		COLFLAG_DEATH=2,
 		COLFLAG_NOHOOK=4,
+
+		MAX_DISTANCE=255,
+	};
+
+	struct CStats
+	{
+		int m_FlagBytes;
+		int m_DistanceBytes;
+		int64 m_NumLineQueries;
+		int64 m_NumBoxQueries;
+		int64 m_NumTileProbes;
 	};
 
 	CCollision();
-	void Init(class CLayers *pLayers);
+	~CCollision();
+	void Init(class CLayers *pLayers, bool DistanceField=true);
+	void Init(const class CTile *pTiles, int Width, int Height, bool DistanceField=true);
+	void GetStats(CStats *pStats) const;
+	void ResetStats() const;
 	bool CheckPoint(float x, float y, int Flag=COLFLAG_SOLID) const { return IsTile(round_to_int(x), round_to_int(y), Flag); }
 	bool CheckPoint(vec2 Pos, int Flag=COLFLAG_SOLID) const { return CheckPoint(Pos.x, Pos.y, Flag); }
 	int GetCollisionAt(float x, float y) const { return GetTile(round_to_int(x), round_to_int(y)); }
 	int GetWidth() const { return m_Width; };
 	int GetHeight() const { return m_Height; };
+	int GetTileDistance(int TileX, int TileY) const;
 	int IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision) const;
 	void MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, int *pBounces) const;
 	void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath=0) const;
@@ -55,6 +55,35 @@ float VelocityRamp(float Value, float Start, float Range, float Curvature)
 	return 1.0f/powf(Curvature, (Value-Start)/Range);
 }
 
+int CWorldCore::IntersectCharacters(vec2 Pos0, vec2 Pos1, float Radius, const CCharacterCore *pNotThis, int *pIDs) const
+{
+	// a pixel of slack so rounding never drops a character the exact checks would hit
+	Radius += 1.0f;
+	vec2 Min = vec2(min(Pos0.x, Pos1.x)-Radius, min(Pos0.y, Pos1.y)-Radius);
+	vec2 Max = vec2(max(Pos0.x, Pos1.x)+Radius, max(Pos0.y, Pos1.y)+Radius);
+	vec2 Dir = Pos1-Pos0;
+	float Length2 = dot(Dir, Dir);
+
+	int Num = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CCharacterCore *pCharCore = m_apCharacters[i];
+		if(!pCharCore || pCharCore == pNotThis)
+			continue;
+
+		vec2 Pos = pCharCore->m_Pos;
+		if(Pos.x < Min.x || Pos.x > Max.x || Pos.y < Min.y || Pos.y > Max.y)
+			continue;
+
+		vec2 Rel = Pos-Pos0;
+		float t = Length2 > 0.0f ? clamp(dot(Rel, Dir)/Length2, 0.0f, 1.0f) : 0.0f;
+		vec2 Diff = Rel-Dir*t;
+		if(dot(Diff, Diff) < Radius*Radius)
+			pIDs[Num++] = i;
+	}
+	return Num;
+}
+
 void CCharacterCore::Init(CWorldCore *pWorld, CCollision *pCollision)
 {
 	m_pWorld = pWorld;
@@ -199,11 +228,12 @@ void CCharacterCore::Tick(bool UseInput)
 		if(m_pWorld && m_pWorld->m_Tuning.m_PlayerHooking)
 		{
 			float Distance = 0.0f;
-			for(int i = 0; i < MAX_CLIENTS; i++)
+			int aIDs[MAX_CLIENTS];
+			int Num = m_pWorld->IntersectCharacters(m_HookPos, NewPos, PhysSize+2.0f, this, aIDs);
+			for(int c = 0; c < Num; c++)
 			{
+				int i = aIDs[c];
 				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
-				if(!pCharCore || pCharCore == this)
-					continue;
 
 				vec2 ClosestPoint = closest_point_on_line(m_HookPos, NewPos, pCharCore->m_Pos);
 				if(distance(pCharCore->m_Pos, ClosestPoint) < PhysSize+2.0f)
@@ -305,9 +335,9 @@ void CCharacterCore::Tick(bool UseInput)
 
 			// handle player <-> player collision
 			float Distance = distance(m_Pos, pCharCore->m_Pos);
-			vec2 Dir = normalize(m_Pos - pCharCore->m_Pos);
 			if(m_pWorld->m_Tuning.m_PlayerCollision && Distance < PhysSize*1.25f && Distance > 0.0f)
 			{
+				vec2 Dir = normalize(m_Pos - pCharCore->m_Pos);
 				float a = (PhysSize*1.45f - Distance);
 				float Velocity = 0.5f;
 
@@ -325,6 +355,7 @@ void CCharacterCore::Tick(bool UseInput)
 			{
 				if(Distance > PhysSize*1.50f) // TODO: fix tweakable variable
 				{
+					vec2 Dir = normalize(m_Pos - pCharCore->m_Pos);
 					float Accel = m_pWorld->m_Tuning.m_HookDragAccel * (Distance/m_pWorld->m_Tuning.m_HookLength);
 					float DragSpeed = m_pWorld->m_Tuning.m_HookDragSpeed;
 
@@ -362,19 +393,19 @@ void CCharacterCore::Move()
 
 	if(m_pWorld->m_Tuning.m_PlayerCollision)
 	{
-		// check player collision
+		// check player collision, only against the players that are close to the path
+		int aIDs[MAX_CLIENTS];
+		int Num = m_pWorld->IntersectCharacters(m_Pos, NewPos, PhysSize, this, aIDs);
 		float Distance = distance(m_Pos, NewPos);
-		int End = Distance+1;
+		int End = Num ? Distance+1 : 0;
 		vec2 LastPos = m_Pos;
 		for(int i = 0; i < End; i++)
 		{
 			float a = i/Distance;
 			vec2 Pos = mix(m_Pos, NewPos, a);
-			for(int p = 0; p < MAX_CLIENTS; p++)
+			for(int c = 0; c < Num; c++)
 			{
-				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
-				if(!pCharCore || pCharCore == this)
-					continue;
+				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[aIDs[c]];
 				float D = distance(Pos, pCharCore->m_Pos);
 				if(D < PhysSize && D > 0.0f)
 				{
@@ -140,6 +140,10 @@ public:
 
 	CTuningParams m_Tuning;
 	class CCharacterCore *m_apCharacters[MAX_CLIENTS];
+
+	// finds the characters that come closer than Radius to the line from Pos0 to Pos1,
+	// in the order of their ids. may return a few more that are just out of reach
+	int IntersectCharacters(vec2 Pos0, vec2 Pos1, float Radius, const class CCharacterCore *pNotThis, int *pIDs) const;
 };
 
 class CCharacterCore
@@ -0,0 +1,113 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include "prediction.h"
+
+static void GetPlayerInput(const int *pInput, CNetObj_PlayerInput *pPlayerInput)
+{
+	mem_zero(pPlayerInput, sizeof(*pPlayerInput));
+	if(pInput)
+		*pPlayerInput = *((const CNetObj_PlayerInput*)pInput);
+}
+
+CPrediction::CPrediction()
+{
+	m_SnapTick = -1;
+	m_Tick = -1;
+	m_LocalClientID = -1;
+	m_NumSimulatedTicks = 0;
+	m_NumReusedTicks = 0;
+}
+
+void CPrediction::Init(CCollision *pCollision)
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_aCores[i].Init(&m_World, pCollision);
+	Reset();
+}
+
+bool CPrediction::CanContinue(int SnapTick, int PredTick, const CTuningParams *pTuning, int LocalClientID, FGetInput pfnGetInput, void *pUser) const
+{
+	if(m_SnapTick == -1 || m_SnapTick != SnapTick || m_LocalClientID != LocalClientID)
+		return false;
+	if(m_Tick > PredTick || m_Tick-m_SnapTick >= MAX_TICKS)
+		return false;
+	if(mem_comp(&m_World.m_Tuning, pTuning, sizeof(CTuningParams)) != 0)
+		return false;
+
+	// the own input of a tick that got predicted already might have changed
+	for(int Tick = m_SnapTick+1; Tick <= m_Tick; Tick++)
+	{
+		CNetObj_PlayerInput Input;
+		GetPlayerInput(pfnGetInput(Tick, pUser), &Input);
+		if(mem_comp(&Input, &m_aInputs[Tick%MAX_TICKS], sizeof(Input)) != 0)
+			return false;
+	}
+	return true;
+}
+
+int CPrediction::Begin(int SnapTick, int PredTick, const CNetObj_CharacterCore *const *ppSnapCores, const CTuningParams *pTuning,
+	int LocalClientID, FGetInput pfnGetInput, void *pUser)
+{
+	if(CanContinue(SnapTick, PredTick, pTuning, LocalClientID, pfnGetInput, pUser))
+	{
+		m_NumReusedTicks += m_Tick-m_SnapTick;
+		return m_Tick;
+	}
+
+	m_World.m_Tuning = *pTuning;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!ppSnapCores[i])
+		{
+			m_World.m_apCharacters[i] = 0;
+			continue;
+		}
+
+		m_World.m_apCharacters[i] = &m_aCores[i];
+		m_aCores[i].Read(ppSnapCores[i]);
+	}
+
+	m_SnapTick = SnapTick;
+	m_Tick = SnapTick;
+	m_LocalClientID = LocalClientID;
+	return m_Tick;
+}
+
+void CPrediction::Tick(const int *pLocalInput)
+{
+	m_Tick++;
+	m_NumSimulatedTicks++;
+	CNetObj_PlayerInput *pInput = &m_aInputs[m_Tick%MAX_TICKS];
+	GetPlayerInput(pLocalInput, pInput);
+
+	// first calculate where everyone should move
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		CCharacterCore *pCore = m_World.m_apCharacters[c];
+		if(!pCore)
+			continue;
+
+		if(m_LocalClientID == c)
+		{
+			// apply player input
+			pCore->m_Input = *pInput;
+			pCore->Tick(true);
+		}
+		else
+		{
+			mem_zero(&pCore->m_Input, sizeof(pCore->m_Input));
+			pCore->Tick(false);
+		}
+	}
+
+	// move all players and quantize their data
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		CCharacterCore *pCore = m_World.m_apCharacters[c];
+		if(!pCore)
+			continue;
+
+		pCore->Move();
+		pCore->Quantize();
+	}
+}
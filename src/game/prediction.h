@@ -0,0 +1,63 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_PREDICTION_H
+#define GAME_PREDICTION_H
+
+#include "gamecore.h"
+
+/*
+	Class: CPrediction
+		The characters of a snapshot, predicted up to the tick of the own
+		input. The predicted world is kept between frames. As long as it
+		started from the same snapshot and the own input for the ticks it
+		predicted stays the same, only the ticks that got added since the
+		last prediction are simulated.
+*/
+class CPrediction
+{
+public:
+	enum
+	{
+		MAX_TICKS=64, // the client never predicts a second ahead
+	};
+
+	typedef const int *(*FGetInput)(int Tick, void *pUser);
+
+	CPrediction();
+
+	void Init(CCollision *pCollision);
+
+	// drops the predicted world, the next prediction starts from the snapshot again
+	void Reset() { m_SnapTick = -1; }
+
+	// keeps the predicted world if it can be continued, otherwise reads the characters from the
+	// snapshot, 0 for the ones that are not in it. returns the tick the predicted world is at
+	int Begin(int SnapTick, int PredTick, const CNetObj_CharacterCore *const *ppSnapCores, const CTuningParams *pTuning,
+		int LocalClientID, FGetInput pfnGetInput, void *pUser);
+
+	// predicts the next tick, the input is 0 if there is none for the tick
+	void Tick(const int *pLocalInput);
+
+	int CurrentTick() const { return m_Tick; }
+	CCharacterCore *Character(int ClientID) { return m_World.m_apCharacters[ClientID]; }
+
+	// ticks that got simulated and ticks that were taken from the predicted world instead
+	int64 NumSimulatedTicks() const { return m_NumSimulatedTicks; }
+	int64 NumReusedTicks() const { return m_NumReusedTicks; }
+
+private:
+	CWorldCore m_World;
+	CCharacterCore m_aCores[MAX_CLIENTS];
+
+	int m_SnapTick;
+	int m_Tick;
+	int m_LocalClientID;
+	CNetObj_PlayerInput m_aInputs[MAX_TICKS]; // the own input of the predicted ticks
+
+	int64 m_NumSimulatedTicks;
+	int64 m_NumReusedTicks;
+
+	bool CanContinue(int SnapTick, int PredTick, const CTuningParams *pTuning, int LocalClientID, FGetInput pfnGetInput, void *pUser) const;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #define GAME_SERVER_ALLOC_H
 
 #include <new>
+#include <string.h> // memset
 
 #include <base/system.h>
 
@@ -59,4 +60,147 @@
 		mem_zero(ms_PoolData##POOLTYPE[id], sizeof(POOLTYPE)); \
 	}
 
+/*
+	Class: CPool
+		Growable free list for the objects of one type. The memory comes in
+		chunks that are kept until the pool goes away, so once the pool has
+		grown to the peak number of live objects, new and delete don't touch
+		the heap anymore. Debug builds fill deleted objects with a pattern
+		and check it on the next new to catch writes after delete.
+*/
+class CPool
+{
+	enum
+	{
+		POISON=0xdd,
+	};
+
+	struct CChunk
+	{
+		CChunk *m_pNext;
+	};
+
+	const char *m_pName;
+	int m_ObjectSize;
+	int m_ChunkSize;
+	CChunk *m_pChunks;
+	void *m_pFreeList;
+
+	int m_Live;
+	int m_Peak;
+	int m_Capacity;
+	CPool *m_pNextPool;
+
+	static CPool *&FirstPool() { static CPool *s_pFirst = 0; return s_pFirst; }
+
+	void Grow()
+	{
+		CChunk *pChunk = (CChunk *)mem_alloc(sizeof(double)*2+m_ObjectSize*m_ChunkSize, 1);
+		pChunk->m_pNext = m_pChunks;
+		m_pChunks = pChunk;
+		m_Capacity += m_ChunkSize;
+
+		// the first object ends up first in the free list
+		char *pObjects = (char *)pChunk+sizeof(double)*2;
+		for(int i = m_ChunkSize-1; i >= 0; i--)
+			Push(pObjects+i*m_ObjectSize);
+	}
+
+	void Push(void *pObject)
+	{
+#ifdef CONF_DEBUG
+		memset(pObject, POISON, m_ObjectSize);
+#endif
+		*(void **)pObject = m_pFreeList;
+		m_pFreeList = pObject;
+	}
+
+public:
+	CPool(const char *pName, int ObjectSize, int ChunkSize)
+	{
+		m_pName = pName;
+		m_ObjectSize = (ObjectSize+sizeof(double)*2-1)&~(sizeof(double)*2-1);
+		m_ChunkSize = ChunkSize;
+		m_pChunks = 0;
+		m_pFreeList = 0;
+		m_Live = 0;
+		m_Peak = 0;
+		m_Capacity = 0;
+		m_pNextPool = FirstPool();
+		FirstPool() = this;
+	}
+
+	~CPool()
+	{
+		for(CPool **ppPool = &FirstPool(); *ppPool; ppPool = &(*ppPool)->m_pNextPool)
+		{
+			if(*ppPool == this)
+			{
+				*ppPool = m_pNextPool;
+				break;
+			}
+		}
+
+		while(m_pChunks)
+		{
+			CChunk *pNext = m_pChunks->m_pNext;
+			mem_free(m_pChunks);
+			m_pChunks = pNext;
+		}
+	}
+
+	void *Alloc()
+	{
+		if(!m_pFreeList)
+			Grow();
+
+		void *pObject = m_pFreeList;
+		m_pFreeList = *(void **)pObject;
+#ifdef CONF_DEBUG
+		for(int i = sizeof(void *); i < m_ObjectSize; i++)
+			dbg_assert(((unsigned char *)pObject)[i] == POISON, "pool object written after delete");
+#endif
+		mem_zero(pObject, m_ObjectSize);
+
+		m_Live++;
+		if(m_Live > m_Peak)
+			m_Peak = m_Live;
+		return pObject;
+	}
+
+	void Free(void *pObject)
+	{
+		dbg_assert(m_Live > 0, "pool has no live objects");
+		m_Live--;
+		Push(pObject);
+	}
+
+	const char *Name() const { return m_pName; }
+	int Live() const { return m_Live; }
+	int Peak() const { return m_Peak; }
+	int Capacity() const { return m_Capacity; }
+
+	// all pools, for reporting
+	static const CPool *First() { return FirstPool(); }
+	const CPool *Next() const { return m_pNextPool; }
+};
+
+#define MACRO_ALLOC_POOL() \
+	public: \
+	void *operator new(size_t Size); \
+	void operator delete(void *p); \
+	private:
+
+#define MACRO_ALLOC_POOL_IMPL(POOLTYPE, ChunkSize) \
+	static CPool ms_Pool##POOLTYPE(#POOLTYPE, sizeof(POOLTYPE), ChunkSize); \
+	void *POOLTYPE::operator new(size_t Size) \
+	{ \
+		dbg_assert(sizeof(POOLTYPE) == Size, "size error"); \
+		return ms_Pool##POOLTYPE.Alloc(); \
+	} \
+	void POOLTYPE::operator delete(void *p) \
+	{ \
+		ms_Pool##POOLTYPE.Free(p); \
+	}
+
 #endif
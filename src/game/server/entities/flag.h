@@ -7,6 +7,8 @@
 
 class CFlag : public CEntity
 {
+	MACRO_ALLOC_POOL()
+
 private:
 	/* Identity */
 	int m_Team;
@@ -37,6 +39,7 @@ public:
 	virtual void Reset();
 	virtual void TickPaused();
 	virtual void Snap(int SnappingClient);
+	virtual bool SnapShared();
 	virtual void TickDefered();
 
 	/* Functions */
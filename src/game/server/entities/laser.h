@@ -7,6 +7,8 @@
 
 class CLaser : public CEntity
 {
+	MACRO_ALLOC_POOL()
+
 public:
 	CLaser(CGameWorld *pGameWorld, vec2 Pos, vec2 Direction, float StartEnergy, int Owner);
 
@@ -14,6 +16,7 @@ public:
 	virtual void Tick();
 	virtual void TickPaused();
 	virtual void Snap(int SnappingClient);
+	virtual bool SnapShared();
 
 protected:
 	bool HitCharacter(vec2 From, vec2 To);
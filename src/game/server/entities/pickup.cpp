@@ -7,6 +7,8 @@
 #include "character.h"
 #include "pickup.h"
 
+MACRO_ALLOC_POOL_IMPL(CPickup, 64)
+
 CPickup::CPickup(CGameWorld *pGameWorld, int Type, vec2 Pos)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_PICKUP, Pos, PickupPhysSize)
 {
@@ -147,3 +149,22 @@ void CPickup::Snap(int SnappingClient)
 	pP->m_Y = (int)m_Pos.y;
 	pP->m_Type = m_Type;
 }
+
+bool CPickup::SnapShared()
+{
+	if(m_SpawnTick != -1)
+		return true;
+
+	CClientMask Mask = NetworkClippedMask(m_Pos);
+	if(Mask.IsEmpty())
+		return true;
+
+	CNetObj_Pickup *pP = static_cast<CNetObj_Pickup *>(Server()->SnapNewSharedItem(NETOBJTYPE_PICKUP, GetID(), sizeof(CNetObj_Pickup), Mask));
+	if(!pP)
+		return true;
+
+	pP->m_X = (int)m_Pos.x;
+	pP->m_Y = (int)m_Pos.y;
+	pP->m_Type = m_Type;
+	return true;
+}
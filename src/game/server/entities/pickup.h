@@ -9,6 +9,8 @@ const int PickupPhysSize = 14;
 
 class CPickup : public CEntity
 {
+	MACRO_ALLOC_POOL()
+
 public:
 	CPickup(CGameWorld *pGameWorld, int Type, vec2 Pos);
 
@@ -16,6 +18,7 @@ public:
 	virtual void Tick();
 	virtual void TickPaused();
 	virtual void Snap(int SnappingClient);
+	virtual bool SnapShared();
 
 private:
 	int m_Type;
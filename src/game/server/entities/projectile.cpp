@@ -6,6 +6,8 @@
 #include "character.h"
 #include "projectile.h"
 
+MACRO_ALLOC_POOL_IMPL(CProjectile, 256)
+
 CProjectile::CProjectile(CGameWorld *pGameWorld, int Type, int Owner, vec2 Pos, vec2 Dir, int Span,
 		int Damage, bool Explosive, float Force, int SoundImpact, int Weapon)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_PROJECTILE, Pos)
@@ -118,3 +120,17 @@ void CProjectile::Snap(int SnappingClient)
 	if(pProj)
 		FillInfo(pProj);
 }
+
+bool CProjectile::SnapShared()
+{
+	float Ct = (Server()->Tick()-m_StartTick)/(float)Server()->TickSpeed();
+
+	CClientMask Mask = NetworkClippedMask(GetPos(Ct));
+	if(Mask.IsEmpty())
+		return true;
+
+	CNetObj_Projectile *pProj = static_cast<CNetObj_Projectile *>(Server()->SnapNewSharedItem(NETOBJTYPE_PROJECTILE, GetID(), sizeof(CNetObj_Projectile), Mask));
+	if(pProj)
+		FillInfo(pProj);
+	return true;
+}
@@ -11,6 +11,8 @@ enum
 
 class CProjectile : public CEntity
 {
+	MACRO_ALLOC_POOL()
+
 public:
 	CProjectile(CGameWorld *pGameWorld, int Type, int Owner, vec2 Pos, vec2 Dir, int Span,
 		int Damage, bool Explosive, float Force, int SoundImpact, int Weapon);
@@ -25,6 +27,7 @@ public:
 	virtual void Tick();
 	virtual void TickPaused();
 	virtual void Snap(int SnappingClient);
+	virtual bool SnapShared();
 
 private:
 	vec2 m_Direction;
@@ -3,7 +3,6 @@
 
 #include "entity.h"
 #include "gamecontext.h"
-#include "player.h"
 
 CEntity::CEntity(CGameWorld *pGameWorld, int ObjType, vec2 Pos, int ProximityRadius)
 {
@@ -12,12 +11,15 @@ CEntity::CEntity(CGameWorld *pGameWorld, int ObjType, vec2 Pos, int ProximityRad
 	m_pPrevTypeEntity = 0;
 	m_pNextTypeEntity = 0;
 
+	m_Index = -1;
+
 	m_ID = Server()->SnapNewID();
 	m_ObjType = ObjType;
 
 	m_ProximityRadius = ProximityRadius;
 
 	m_MarkedForDestroy = false;
+	m_SnappedShared = false;
 	m_Pos = Pos;
 }
 
@@ -37,17 +39,22 @@ int CEntity::NetworkClipped(int SnappingClient, vec2 CheckPos)
 	if(SnappingClient == -1)
 		return 0;
 
-	float dx = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.x-CheckPos.x;
-	float dy = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos.y-CheckPos.y;
-
-	if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-		return 1;
-
-	if(distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, CheckPos) > 1100.0f)
+	int Range = m_SnapVisibleMask.IsSet(SnappingClient) ? CGameWorld::CLIPRANGE_ENTITY_KEEP : CGameWorld::CLIPRANGE_ENTITY;
+	if(m_pGameWorld->NetworkClipped(SnappingClient, CheckPos, Range))
 		return 1;
+	m_VisibleMask.Set(SnappingClient);
 	return 0;
 }
 
+CClientMask CEntity::NetworkClippedMask(vec2 CheckPos)
+{
+	CClientMask Mask = m_pGameWorld->NetworkClippedMask(CheckPos, CGameWorld::CLIPRANGE_ENTITY);
+	if(!m_SnapVisibleMask.IsEmpty())
+		Mask |= m_pGameWorld->NetworkClippedMask(CheckPos, CGameWorld::CLIPRANGE_ENTITY_KEEP) & m_SnapVisibleMask;
+	m_VisibleMask |= Mask;
+	return Mask;
+}
+
 bool CEntity::GameLayerClipped(vec2 CheckPos)
 {
 	int rx = round_to_int(CheckPos.x) / 32;
@@ -26,6 +26,9 @@ private:
 	CEntity *m_pPrevTypeEntity;
 	CEntity *m_pNextTypeEntity;
 
+	// index in the entity arrays of the world, -1 while not in the world
+	int m_Index;
+
 	int m_ID;
 	int m_ObjType;
 
@@ -37,6 +40,12 @@ private:
 
 	/* State */
 	bool m_MarkedForDestroy;
+	bool m_SnappedShared;
+
+	// the clients that got the entity with their last snapshot and the ones
+	// that get it with the current one. it stays visible to them a bit longer
+	CClientMask m_SnapVisibleMask;
+	CClientMask m_VisibleMask;
 
 protected:
 	/* State */
@@ -44,9 +53,13 @@ protected:
 	/*
 		Variable: m_Pos
 			Contains the current posititon of the entity.
+			Use SetPos to change it, so the world can keep track.
 	*/
 	vec2 m_Pos;
 
+	/* Setters */
+	void SetPos(vec2 Pos)				{ m_Pos = Pos; m_pGameWorld->MoveEntity(this); }
+
 	/* Getters */
 	int GetID() const					{ return m_ID; }
 
@@ -70,7 +83,7 @@ public:
 	bool IsMarkedForDestroy() const		{ return m_MarkedForDestroy; }
 
 	/* Setters */
-	void MarkForDestroy()				{ m_MarkedForDestroy = true; }
+	void MarkForDestroy()				{ m_pGameWorld->DestroyEntity(this); }
 
 	/* Other functions */
 
@@ -119,12 +132,26 @@ public:
 	*/
 	virtual void Snap(int SnappingClient) {}
 
+	/*
+		Function: SnapShared
+			Called once per snapshot when shared snapshots are enabled.
+			Entities whose snapshot items are the same for every client
+			create them here, tagged with the clients that can see them.
+
+		Returns:
+			True if the entity was snapped and Snap should not be
+			called for the individual clients.
+	*/
+	virtual bool SnapShared() { return false; }
+
 	virtual void PostSnap() {}
 
 	/*
 		Function: networkclipped(int snapping_client)
 			Performs a series of test to see if a client can see the
-			entity.
+			entity. A client that got the entity with its last
+			snapshot keeps it until it is a bit further away, so it
+			doesn't flicker at the edge of the view.
 
 		Arguments:
 			SnappingClient - ID of the client which snapshot is
@@ -138,6 +165,15 @@ public:
 	int NetworkClipped(int SnappingClient);
 	int NetworkClipped(int SnappingClient, vec2 CheckPos);
 
+	/*
+		Function: NetworkClippedMask(vec2 CheckPos)
+			Performs the network clipping test for all clients at once.
+
+		Returns:
+			Mask of the clients that can see the position.
+	*/
+	CClientMask NetworkClippedMask(vec2 CheckPos);
+
 	bool GameLayerClipped(vec2 CheckPos);
 };
 
@@ -3,7 +3,6 @@
 #include <base/system.h>
 #include "eventhandler.h"
 #include "gamecontext.h"
-#include "player.h"
 
 //////////////////////////////////////////////////
 // Event handler
@@ -19,7 +18,7 @@ void CEventHandler::SetGameServer(CGameContext *pGameServer)
 	m_pGameServer = pGameServer;
 }
 
-void *CEventHandler::Create(int Type, int Size, int64 Mask)
+void *CEventHandler::Create(int Type, int Size, const CClientMask &Mask)
 {
 	if(m_NumEvents == MAX_EVENTS)
 		return 0;
@@ -40,16 +39,20 @@ void CEventHandler::Clear()
 {
 	m_NumEvents = 0;
 	m_CurrentOffset = 0;
+	m_SnappedShared = false;
 }
 
 void CEventHandler::Snap(int SnappingClient)
 {
+	if(SnappingClient != -1 && m_SnappedShared)
+		return;
+
 	for(int i = 0; i < m_NumEvents; i++)
 	{
 		if(SnappingClient == -1 || CmaskIsSet(m_aClientMasks[i], SnappingClient))
 		{
 			CNetEvent_Common *ev = (CNetEvent_Common *)&m_aData[m_aOffsets[i]];
-			if(SnappingClient == -1 || distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, vec2(ev->m_X, ev->m_Y)) < 1500.0f)
+			if(SnappingClient == -1 || !GameServer()->m_World.NetworkClipped(SnappingClient, vec2(ev->m_X, ev->m_Y), CGameWorld::CLIPRANGE_EVENT))
 			{
 				void *d = GameServer()->Server()->SnapNewItem(m_aTypes[i], i, m_aSizes[i]);
 				if(d)
@@ -58,3 +61,21 @@ void CEventHandler::Snap(int SnappingClient)
 		}
 	}
 }
+
+void CEventHandler::SnapShared()
+{
+	for(int i = 0; i < m_NumEvents; i++)
+	{
+		CNetEvent_Common *ev = (CNetEvent_Common *)&m_aData[m_aOffsets[i]];
+		CClientMask Mask = GameServer()->m_World.NetworkClippedMask(vec2(ev->m_X, ev->m_Y), CGameWorld::CLIPRANGE_EVENT) & m_aClientMasks[i];
+
+		if(!Mask.IsEmpty())
+		{
+			void *d = GameServer()->Server()->SnapNewSharedItem(m_aTypes[i], i, m_aSizes[i], Mask);
+			if(d)
+				mem_copy(d, &m_aData[m_aOffsets[i]], m_aSizes[i]);
+		}
+	}
+
+	m_SnappedShared = true;
+}
@@ -3,6 +3,8 @@
 #ifndef GAME_SERVER_EVENTHANDLER_H
 #define GAME_SERVER_EVENTHANDLER_H
 
+#include <engine/shared/protocol.h>
+
 //
 class CEventHandler
 {
@@ -12,21 +14,23 @@ class CEventHandler
 	int m_aTypes[MAX_EVENTS]; // TODO: remove some of these arrays
 	int m_aOffsets[MAX_EVENTS];
 	int m_aSizes[MAX_EVENTS];
-	int64 m_aClientMasks[MAX_EVENTS];
+	CClientMask m_aClientMasks[MAX_EVENTS];
 	char m_aData[MAX_DATASIZE];
 
 	class CGameContext *m_pGameServer;
 
 	int m_CurrentOffset;
 	int m_NumEvents;
+	bool m_SnappedShared;
 public:
 	CGameContext *GameServer() const { return m_pGameServer; }
 	void SetGameServer(CGameContext *pGameServer);
 
 	CEventHandler();
-	void *Create(int Type, int Size, int64 Mask = -1);
+	void *Create(int Type, int Size, const CClientMask &Mask = CClientMask::All());
 	void Clear();
 	void Snap(int SnappingClient);
+	void SnapShared();
 };
 
 #endif
@@ -174,7 +174,7 @@ void CGameContext::CreateDeath(vec2 Pos, int ClientID)
 	}
 }
 
-void CGameContext::CreateSound(vec2 Pos, int Sound, int64 Mask)
+void CGameContext::CreateSound(vec2 Pos, int Sound, const CClientMask &Mask)
 {
 	if (Sound < 0)
 		return;
@@ -1141,6 +1141,24 @@ void CGameContext::ConTuneDump(IConsole::IResult *pResult, void *pUserData)
 	}
 }
 
+void CGameContext::ConCollisionStats(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	CCollision::CStats Stats;
+	pSelf->Collision()->GetStats(&Stats);
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "map %dx%d tiles, flags %d bytes, distance field %d bytes",
+		pSelf->Collision()->GetWidth(), pSelf->Collision()->GetHeight(), Stats.m_FlagBytes, Stats.m_DistanceBytes);
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "collision", aBuf);
+	str_format(aBuf, sizeof(aBuf), "line queries=%lld box moves=%lld tile probes=%lld",
+		Stats.m_NumLineQueries, Stats.m_NumBoxQueries, Stats.m_NumTileProbes);
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "collision", aBuf);
+
+	if(pResult->NumArguments() && pResult->GetInteger(0))
+		pSelf->Collision()->ResetStats();
+}
+
 void CGameContext::ConPause(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *)pUserData;
@@ -1462,6 +1480,7 @@ void CGameContext::OnConsoleInit()
 	Console()->Register("tune", "si", CFGFLAG_SERVER, ConTuneParam, this, "Tune variable to value");
 	Console()->Register("tune_reset", "", CFGFLAG_SERVER, ConTuneReset, this, "Reset tuning");
 	Console()->Register("tune_dump", "", CFGFLAG_SERVER, ConTuneDump, this, "Dump tuning");
+	Console()->Register("collision_stats", "?i", CFGFLAG_SERVER, ConCollisionStats, this, "Show collision memory and query counts (1 = reset the counts)");
 
 	Console()->Register("pause", "?i", CFGFLAG_SERVER|CFGFLAG_STORE, ConPause, this, "Pause/unpause game");
 	Console()->Register("change_map", "?r", CFGFLAG_SERVER|CFGFLAG_STORE, ConChangeMap, this, "Change map");
@@ -1497,6 +1516,7 @@ void CGameContext::OnInit()
 
 	m_Layers.Init(Kernel());
 	m_Collision.Init(&m_Layers);
+	m_World.InitGrid(m_Collision.GetWidth(), m_Collision.GetHeight());
 
 	// select gametype
 	if(str_comp_nocase(g_Config.m_SvGametype, "mod") == 0)
@@ -1587,13 +1607,63 @@ void CGameContext::OnSnap(int ClientID)
 			m_apPlayers[i]->Snap(ClientID);
 	}
 }
-void CGameContext::OnPreSnap() {}
+void CGameContext::OnPreSnap()
+{
+	m_World.UpdateViews();
+}
+void CGameContext::OnSnapShared()
+{
+	m_World.SnapShared();
+	m_Events.SnapShared();
+}
 void CGameContext::OnPostSnap()
 {
 	m_World.PostSnap();
 	m_Events.Clear();
 }
 
+int CGameContext::SnapItemPriority(int ClientID, int Type, int ID, const void *pData, int Size)
+{
+	// only the world around the player can wait, closer and livelier things first
+	int Weight;
+	vec2 Pos;
+	if(Type == NETOBJTYPE_CHARACTER && Size >= (int)sizeof(CNetObj_Character))
+	{
+		// the own character and the one that gets watched are always up to date
+		if(ID == ClientID || (m_apPlayers[ClientID] && m_apPlayers[ClientID]->GetSpectatorID() == ID))
+			return -1;
+		Weight = 3;
+		Pos = vec2(((const CNetObj_Character *)pData)->m_X, ((const CNetObj_Character *)pData)->m_Y);
+	}
+	else if(Type == NETOBJTYPE_FLAG && Size >= (int)sizeof(CNetObj_Flag))
+	{
+		Weight = 3;
+		Pos = vec2(((const CNetObj_Flag *)pData)->m_X, ((const CNetObj_Flag *)pData)->m_Y);
+	}
+	else if(Type == NETOBJTYPE_LASER && Size >= (int)sizeof(CNetObj_Laser))
+	{
+		Weight = 2;
+		Pos = vec2(((const CNetObj_Laser *)pData)->m_X, ((const CNetObj_Laser *)pData)->m_Y);
+	}
+	else if(Type == NETOBJTYPE_PROJECTILE && Size >= (int)sizeof(CNetObj_Projectile))
+	{
+		Weight = 1;
+		Pos = vec2(((const CNetObj_Projectile *)pData)->m_X, ((const CNetObj_Projectile *)pData)->m_Y);
+	}
+	else if(Type == NETOBJTYPE_PICKUP && Size >= (int)sizeof(CNetObj_Pickup))
+	{
+		Weight = 0;
+		Pos = vec2(((const CNetObj_Pickup *)pData)->m_X, ((const CNetObj_Pickup *)pData)->m_Y);
+	}
+	else
+		return -1;
+
+	if(!m_apPlayers[ClientID])
+		return Weight*1000;
+	float Dist = distance(m_apPlayers[ClientID]->m_ViewPos, Pos);
+	return Weight*1000+1000-min(round_to_int(Dist), 1000);
+}
+
 bool CGameContext::IsClientReady(int ClientID) const
 {
 	return m_apPlayers[ClientID] && m_apPlayers[ClientID]->m_IsReadyToEnter;
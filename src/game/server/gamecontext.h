@@ -32,6 +32,12 @@
 			Events handler (EVENT_HANDLER::snap)
 			All players (CPlayer::snap)
 
+	Shared snap (once per snapshot, only with sv_snap_shared)
+		Game Context (CGameContext::snap_shared)
+			Game World (GAMEWORLD::snap_shared)
+				All entities in the world (ENTITY::snap_shared)
+			Events handler (EVENT_HANDLER::snap_shared)
+
 */
 class CGameContext : public IGameServer
 {
@@ -45,6 +51,7 @@ class CGameContext : public IGameServer
 	static void ConTuneParam(IConsole::IResult *pResult, void *pUserData);
 	static void ConTuneReset(IConsole::IResult *pResult, void *pUserData);
 	static void ConTuneDump(IConsole::IResult *pResult, void *pUserData);
+	static void ConCollisionStats(IConsole::IResult *pResult, void *pUserData);
 	static void ConPause(IConsole::IResult *pResult, void *pUserData);
 	static void ConChangeMap(IConsole::IResult *pResult, void *pUserData);
 	static void ConRestart(IConsole::IResult *pResult, void *pUserData);
@@ -133,7 +140,7 @@ public:
 	void CreateHammerHit(vec2 Pos);
 	void CreatePlayerSpawn(vec2 Pos);
 	void CreateDeath(vec2 Pos, int Who);
-	void CreateSound(vec2 Pos, int Sound, int64 Mask=-1);
+	void CreateSound(vec2 Pos, int Sound, const CClientMask &Mask=CClientMask::All());
 
 	// network
 	void SendChat(int ChatterClientID, int Mode, int To, const char *pText);
@@ -162,8 +169,10 @@ public:
 
 	virtual void OnTick();
 	virtual void OnPreSnap();
+	virtual void OnSnapShared();
 	virtual void OnSnap(int ClientID);
 	virtual void OnPostSnap();
+	virtual int SnapItemPriority(int ClientID, int Type, int ID, const void *pData, int Size);
 
 	virtual void OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID);
 
@@ -186,8 +195,8 @@ public:
 	virtual const char *NetVersionHashReal() const;
 };
 
-inline int64 CmaskAll() { return -1; }
-inline int64 CmaskOne(int ClientID) { return (int64)1<<ClientID; }
-inline int64 CmaskAllExceptOne(int ClientID) { return CmaskAll()^CmaskOne(ClientID); }
-inline bool CmaskIsSet(int64 Mask, int ClientID) { return (Mask&CmaskOne(ClientID)) != 0; }
+inline CClientMask CmaskAll() { return CClientMask::All(); }
+inline CClientMask CmaskOne(int ClientID) { return CClientMask::One(ClientID); }
+inline CClientMask CmaskAllExceptOne(int ClientID) { CClientMask Mask = CmaskAll(); Mask.Unset(ClientID); return Mask; }
+inline bool CmaskIsSet(const CClientMask &Mask, int ClientID) { return Mask.IsSet(ClientID); }
 #endif
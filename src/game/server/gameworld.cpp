@@ -1,16 +1,29 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <engine/shared/profiler.h>
+
 #include "entities/character.h"
 #include "entity.h"
 #include "gamecontext.h"
 #include "gamecontroller.h"
 #include "gameworld.h"
+#include "player.h"
 
 
 //////////////////////////////////////////////////
 // game world
 //////////////////////////////////////////////////
+template<class T>
+static void GrowArray(T **ppArray, int Num, int Capacity)
+{
+	T *pArray = new T[Capacity];
+	if(Num)
+		mem_copy(pArray, *ppArray, sizeof(T)*Num);
+	delete[] *ppArray;
+	*ppArray = pArray;
+}
+
 CGameWorld::CGameWorld()
 {
 	m_pGameServer = 0x0;
@@ -19,7 +32,47 @@ CGameWorld::CGameWorld()
 	m_Paused = false;
 	m_ResetRequested = false;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
 		m_apFirstEntityTypes[i] = 0;
+		m_aMaxProximityRadius[i] = 0.0f;
+	}
+	mem_zero(m_aEntityArrays, sizeof(m_aEntityArrays));
+	m_NextListOrder = 0;
+	m_NumViewClients = 0;
+
+	// half width, half height and radius. entities leave the view a bit further out than
+	// they come into it, so they don't flicker at its edge
+	static const float s_aClipRanges[NUM_CLIPRANGES][3] = {
+		{1000.0f, 800.0f, 1100.0f},
+		{1100.0f, 900.0f, 1200.0f},
+		{1500.0f, 1500.0f, 1500.0f},
+	};
+	for(int i = 0; i < NUM_CLIPRANGES; i++)
+	{
+		// the widest, the highest and the square rectangle that fit, half a pixel smaller
+		// so rounding doesn't make them disagree with the distance
+		CClipRange *pRange = &m_aClipRanges[i];
+		pRange->m_HalfWidth = s_aClipRanges[i][0];
+		pRange->m_HalfHeight = s_aClipRanges[i][1];
+		pRange->m_Radius = s_aClipRanges[i][2];
+		float Radius = pRange->m_Radius-0.5f;
+		float Width = min(pRange->m_HalfWidth, Radius);
+		float Height = min(pRange->m_HalfHeight, Radius);
+		float Square = min(min(pRange->m_HalfWidth, pRange->m_HalfHeight), Radius*sqrtf(0.5f));
+		pRange->m_aInner[0] = vec2(Width, min(pRange->m_HalfHeight, sqrtf(Radius*Radius-Width*Width)));
+		pRange->m_aInner[1] = vec2(min(pRange->m_HalfWidth, sqrtf(Radius*Radius-Height*Height)), Height);
+		pRange->m_aInner[2] = vec2(Square, Square);
+	}
+
+	// a single cell until the map size is known
+	m_GridWidth = 1;
+	m_GridHeight = 1;
+	m_aGridCells = new int[NUM_ENTTYPES];
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		m_aGridCells[i] = -1;
+	m_MaxCandidates = 64;
+	m_aCandidates = new int[m_MaxCandidates];
+	m_apCandidates = new CEntity *[m_MaxCandidates];
 }
 
 CGameWorld::~CGameWorld()
@@ -28,6 +81,21 @@ CGameWorld::~CGameWorld()
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 		while(m_apFirstEntityTypes[i])
 			delete m_apFirstEntityTypes[i];
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
+		CEntityArrays *pArrays = &m_aEntityArrays[i];
+		delete[] pArrays->m_apEntities;
+		delete[] pArrays->m_aPos;
+		delete[] pArrays->m_aProximityRadius;
+		delete[] pArrays->m_aMarkedForDestroy;
+		delete[] pArrays->m_aListOrder;
+		delete[] pArrays->m_aGridCell;
+		delete[] pArrays->m_aPrevInCell;
+		delete[] pArrays->m_aNextInCell;
+	}
+	delete[] m_aGridCells;
+	delete[] m_aCandidates;
+	delete[] m_apCandidates;
 }
 
 void CGameWorld::SetGameServer(CGameContext *pGameServer)
@@ -36,27 +104,150 @@ void CGameWorld::SetGameServer(CGameContext *pGameServer)
 	m_pServer = m_pGameServer->Server();
 }
 
+void CGameWorld::InitGrid(int Width, int Height)
+{
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		dbg_assert(!m_apFirstEntityTypes[i], "grid has to be set up before adding entities");
+
+	m_GridWidth = max(((Width-1)>>GRID_CELL_SHIFT)+1, 1);
+	m_GridHeight = max(((Height-1)>>GRID_CELL_SHIFT)+1, 1);
+	delete[] m_aGridCells;
+	m_aGridCells = new int[NUM_ENTTYPES*m_GridWidth*m_GridHeight];
+	for(int i = 0; i < NUM_ENTTYPES*m_GridWidth*m_GridHeight; i++)
+		m_aGridCells[i] = -1;
+}
+
 CEntity *CGameWorld::FindFirst(int Type)
 {
 	return Type < 0 || Type >= NUM_ENTTYPES ? 0 : m_apFirstEntityTypes[Type];
 }
 
+void CGameWorld::GrowArrays(CEntityArrays *pArrays)
+{
+	int Num = pArrays->m_Num;
+	int Capacity = max(pArrays->m_Capacity*2, 64);
+	GrowArray(&pArrays->m_apEntities, Num, Capacity);
+	GrowArray(&pArrays->m_aPos, Num, Capacity);
+	GrowArray(&pArrays->m_aProximityRadius, Num, Capacity);
+	GrowArray(&pArrays->m_aMarkedForDestroy, Num, Capacity);
+	GrowArray(&pArrays->m_aListOrder, Num, Capacity);
+	GrowArray(&pArrays->m_aGridCell, Num, Capacity);
+	GrowArray(&pArrays->m_aPrevInCell, Num, Capacity);
+	GrowArray(&pArrays->m_aNextInCell, Num, Capacity);
+	pArrays->m_Capacity = Capacity;
+}
+
+// entities outside of the map end up in the border cells
+int CGameWorld::GridCell(vec2 Pos, int Type) const
+{
+	int x = (int)clamp(Pos.x/GRID_CELL_SIZE, 0.0f, (float)(m_GridWidth-1));
+	int y = (int)clamp(Pos.y/GRID_CELL_SIZE, 0.0f, (float)(m_GridHeight-1));
+	return (Type*m_GridHeight+y)*m_GridWidth+x;
+}
+
+void CGameWorld::GridRange(vec2 Min, vec2 Max, int *pX0, int *pY0, int *pX1, int *pY1) const
+{
+	*pX0 = (int)clamp(Min.x/GRID_CELL_SIZE, 0.0f, (float)(m_GridWidth-1));
+	*pY0 = (int)clamp(Min.y/GRID_CELL_SIZE, 0.0f, (float)(m_GridHeight-1));
+	*pX1 = (int)clamp(Max.x/GRID_CELL_SIZE, 0.0f, (float)(m_GridWidth-1));
+	*pY1 = (int)clamp(Max.y/GRID_CELL_SIZE, 0.0f, (float)(m_GridHeight-1));
+}
+
+void CGameWorld::GridInsert(int Type, int Index)
+{
+	CEntityArrays *pArrays = &m_aEntityArrays[Type];
+	int Cell = GridCell(pArrays->m_aPos[Index], Type);
+	int First = m_aGridCells[Cell];
+	if(First != -1)
+		pArrays->m_aPrevInCell[First] = Index;
+	pArrays->m_aNextInCell[Index] = First;
+	pArrays->m_aPrevInCell[Index] = -1;
+	pArrays->m_aGridCell[Index] = Cell;
+	m_aGridCells[Cell] = Index;
+}
+
+void CGameWorld::GridRemove(int Type, int Index)
+{
+	CEntityArrays *pArrays = &m_aEntityArrays[Type];
+	int Prev = pArrays->m_aPrevInCell[Index];
+	int Next = pArrays->m_aNextInCell[Index];
+	if(Prev != -1)
+		pArrays->m_aNextInCell[Prev] = Next;
+	else
+		m_aGridCells[pArrays->m_aGridCell[Index]] = Next;
+	if(Next != -1)
+		pArrays->m_aPrevInCell[Next] = Prev;
+}
+
+// newer entities come first in the type lists, the queries report them in that order
+void CGameWorld::SortByListOrder(int Type, int *pIndices, int Num) const
+{
+	const int64 *pListOrder = m_aEntityArrays[Type].m_aListOrder;
+	for(int i = 1; i < Num; i++)
+	{
+		int Index = pIndices[i];
+		int j = i;
+		for(; j > 0 && pListOrder[pIndices[j-1]] < pListOrder[Index]; j--)
+			pIndices[j] = pIndices[j-1];
+		pIndices[j] = Index;
+	}
+}
+
+// keeps the found indices, the entity pointers are scratch space
+void CGameWorld::GrowCandidates(int Num)
+{
+	int MaxCandidates = m_MaxCandidates;
+	while(MaxCandidates < Num)
+		MaxCandidates *= 2;
+	GrowArray(&m_aCandidates, m_MaxCandidates, MaxCandidates);
+	delete[] m_apCandidates;
+	m_apCandidates = new CEntity *[MaxCandidates];
+	m_MaxCandidates = MaxCandidates;
+}
+
+// collects the entities of the cells that overlap the box
+int CGameWorld::FindCandidates(vec2 Min, vec2 Max, int Type)
+{
+	int x0, y0, x1, y1;
+	GridRange(Min, Max, &x0, &y0, &x1, &y1);
+
+	const int *pNextInCell = m_aEntityArrays[Type].m_aNextInCell;
+	int Num = 0;
+	for(int y = y0; y <= y1; y++)
+		for(int x = x0; x <= x1; x++)
+			for(int Index = m_aGridCells[(Type*m_GridHeight+y)*m_GridWidth+x]; Index != -1; Index = pNextInCell[Index])
+			{
+				if(Num == m_MaxCandidates)
+					GrowCandidates(Num+1);
+				m_aCandidates[Num++] = Index;
+			}
+	return Num;
+}
+
 int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max, int Type)
 {
 	if(Type < 0 || Type >= NUM_ENTTYPES)
 		return 0;
 
-	int Num = 0;
-	for(CEntity *pEnt = m_apFirstEntityTypes[Type];	pEnt; pEnt = pEnt->m_pNextTypeEntity)
+	float Range = Radius+m_aMaxProximityRadius[Type];
+	int NumCandidates = FindCandidates(Pos-vec2(Range, Range), Pos+vec2(Range, Range), Type);
+
+	// keep the matches in list order so they are the same as with a walk over the list
+	const CEntityArrays *pArrays = &m_aEntityArrays[Type];
+	int NumMatches = 0;
+	for(int i = 0; i < NumCandidates; i++)
 	{
-		if(distance(pEnt->m_Pos, Pos) < Radius+pEnt->m_ProximityRadius)
-		{
-			if(ppEnts)
-				ppEnts[Num] = pEnt;
-			Num++;
-			if(Num == Max)
-				break;
-		}
+		int Index = m_aCandidates[i];
+		if(distance(pArrays->m_aPos[Index], Pos) < Radius+pArrays->m_aProximityRadius[Index])
+			m_aCandidates[NumMatches++] = Index;
+	}
+	SortByListOrder(Type, m_aCandidates, NumMatches);
+
+	int Num = min(NumMatches, Max);
+	if(ppEnts)
+	{
+		for(int i = 0; i < Num; i++)
+			ppEnts[i] = pArrays->m_apEntities[m_aCandidates[i]];
 	}
 
 	return Num;
@@ -70,29 +261,71 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 #endif
 
 	// insert it
-	if(m_apFirstEntityTypes[pEnt->m_ObjType])
-		m_apFirstEntityTypes[pEnt->m_ObjType]->m_pPrevTypeEntity = pEnt;
-	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
+	int Type = pEnt->m_ObjType;
+	if(m_apFirstEntityTypes[Type])
+		m_apFirstEntityTypes[Type]->m_pPrevTypeEntity = pEnt;
+	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[Type];
 	pEnt->m_pPrevTypeEntity = 0x0;
-	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+	m_apFirstEntityTypes[Type] = pEnt;
+
+	CEntityArrays *pArrays = &m_aEntityArrays[Type];
+	if(pArrays->m_Num == pArrays->m_Capacity)
+		GrowArrays(pArrays);
+	int Index = pArrays->m_Num++;
+	pEnt->m_Index = Index;
+	pArrays->m_apEntities[Index] = pEnt;
+	pArrays->m_aPos[Index] = pEnt->m_Pos;
+	pArrays->m_aProximityRadius[Index] = pEnt->m_ProximityRadius;
+	pArrays->m_aMarkedForDestroy[Index] = pEnt->m_MarkedForDestroy;
+	pArrays->m_aListOrder[Index] = m_NextListOrder++;
+	if(pEnt->m_MarkedForDestroy)
+		pArrays->m_NumMarked++;
+
+	m_aMaxProximityRadius[Type] = max(m_aMaxProximityRadius[Type], pEnt->m_ProximityRadius);
+	GridInsert(Type, Index);
+}
+
+void CGameWorld::MoveEntity(CEntity *pEnt)
+{
+	if(pEnt->m_Index == -1)
+		return;
+
+	int Type = pEnt->m_ObjType;
+	CEntityArrays *pArrays = &m_aEntityArrays[Type];
+	pArrays->m_aPos[pEnt->m_Index] = pEnt->m_Pos;
+	if(pArrays->m_aGridCell[pEnt->m_Index] == GridCell(pEnt->m_Pos, Type))
+		return;
+
+	GridRemove(Type, pEnt->m_Index);
+	GridInsert(Type, pEnt->m_Index);
 }
 
 void CGameWorld::DestroyEntity(CEntity *pEnt)
 {
-	pEnt->MarkForDestroy();
+	if(pEnt->m_MarkedForDestroy)
+		return;
+
+	pEnt->m_MarkedForDestroy = true;
+	if(pEnt->m_Index != -1)
+	{
+		CEntityArrays *pArrays = &m_aEntityArrays[pEnt->m_ObjType];
+		pArrays->m_aMarkedForDestroy[pEnt->m_Index] = true;
+		pArrays->m_NumMarked++;
+	}
 }
 
 void CGameWorld::RemoveEntity(CEntity *pEnt)
 {
 	// not in the list
-	if(!pEnt->m_pNextTypeEntity && !pEnt->m_pPrevTypeEntity && m_apFirstEntityTypes[pEnt->m_ObjType] != pEnt)
+	if(pEnt->m_Index == -1)
 		return;
 
 	// remove
+	int Type = pEnt->m_ObjType;
 	if(pEnt->m_pPrevTypeEntity)
 		pEnt->m_pPrevTypeEntity->m_pNextTypeEntity = pEnt->m_pNextTypeEntity;
 	else
-		m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt->m_pNextTypeEntity;
+		m_apFirstEntityTypes[Type] = pEnt->m_pNextTypeEntity;
 	if(pEnt->m_pNextTypeEntity)
 		pEnt->m_pNextTypeEntity->m_pPrevTypeEntity = pEnt->m_pPrevTypeEntity;
 
@@ -102,16 +335,63 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 
 	pEnt->m_pNextTypeEntity = 0;
 	pEnt->m_pPrevTypeEntity = 0;
+
+	// the last entity of the type takes the place in the arrays
+	CEntityArrays *pArrays = &m_aEntityArrays[Type];
+	int Index = pEnt->m_Index;
+	int Last = --pArrays->m_Num;
+	GridRemove(Type, Index);
+	if(pArrays->m_aMarkedForDestroy[Index])
+		pArrays->m_NumMarked--;
+	pEnt->m_Index = -1;
+
+	if(Index != Last)
+	{
+		CEntity *pMoved = pArrays->m_apEntities[Last];
+		pMoved->m_Index = Index;
+		pArrays->m_apEntities[Index] = pMoved;
+		pArrays->m_aPos[Index] = pArrays->m_aPos[Last];
+		pArrays->m_aProximityRadius[Index] = pArrays->m_aProximityRadius[Last];
+		pArrays->m_aMarkedForDestroy[Index] = pArrays->m_aMarkedForDestroy[Last];
+		pArrays->m_aListOrder[Index] = pArrays->m_aListOrder[Last];
+
+		int Prev = pArrays->m_aPrevInCell[Last];
+		int Next = pArrays->m_aNextInCell[Last];
+		pArrays->m_aGridCell[Index] = pArrays->m_aGridCell[Last];
+		pArrays->m_aPrevInCell[Index] = Prev;
+		pArrays->m_aNextInCell[Index] = Next;
+		if(Prev != -1)
+			pArrays->m_aNextInCell[Prev] = Index;
+		else
+			m_aGridCells[pArrays->m_aGridCell[Index]] = Index;
+		if(Next != -1)
+			pArrays->m_aPrevInCell[Next] = Index;
+	}
 }
 
 //
 void CGameWorld::Snap(int SnappingClient)
 {
+	if(SnappingClient != -1)
+		m_SnappedClients.Set(SnappingClient);
+
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 		{
 			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-			pEnt->Snap(SnappingClient);
+			if(SnappingClient == -1 || !pEnt->m_SnappedShared)
+				pEnt->Snap(SnappingClient);
+			pEnt = m_pNextTraverseEntity;
+		}
+}
+
+void CGameWorld::SnapShared()
+{
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
+		{
+			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
+			pEnt->m_SnappedShared = pEnt->SnapShared();
 			pEnt = m_pNextTraverseEntity;
 		}
 }
@@ -122,9 +402,57 @@ void CGameWorld::PostSnap()
 		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 		{
 			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
+			pEnt->m_SnappedShared = false;
+			pEnt->m_SnapVisibleMask = (pEnt->m_SnapVisibleMask & ~m_SnappedClients) | (pEnt->m_VisibleMask & m_SnappedClients);
+			pEnt->m_VisibleMask.Clear();
 			pEnt->PostSnap();
 			pEnt = m_pNextTraverseEntity;
 		}
+	m_SnappedClients.Clear();
+}
+
+void CGameWorld::UpdateViews()
+{
+	m_NumViewClients = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!GameServer()->m_apPlayers[i])
+			continue;
+		m_aViewPos[i] = GameServer()->m_apPlayers[i]->m_ViewPos;
+		m_aViewClients[m_NumViewClients++] = i;
+	}
+}
+
+bool CGameWorld::NetworkClipped(int SnappingClient, vec2 CheckPos, int Range) const
+{
+	const CClipRange *pRange = &m_aClipRanges[Range];
+	float dx = absolute(m_aViewPos[SnappingClient].x-CheckPos.x);
+	float dy = absolute(m_aViewPos[SnappingClient].y-CheckPos.y);
+
+	if(dx > pRange->m_HalfWidth || dy > pRange->m_HalfHeight)
+		return true;
+
+	for(int i = 0; i < 3; i++)
+	{
+		if(dx <= pRange->m_aInner[i].x && dy <= pRange->m_aInner[i].y)
+			return false;
+	}
+
+	if(distance(m_aViewPos[SnappingClient], CheckPos) > pRange->m_Radius)
+		return true;
+	return false;
+}
+
+CClientMask CGameWorld::NetworkClippedMask(vec2 CheckPos, int Range) const
+{
+	CClientMask Mask;
+	for(int i = 0; i < m_NumViewClients; i++)
+	{
+		int ClientID = m_aViewClients[i];
+		if(!NetworkClipped(ClientID, CheckPos, Range))
+			Mask.Set(ClientID);
+	}
+	return Mask;
 }
 
 void CGameWorld::Reset()
@@ -147,18 +475,33 @@ void CGameWorld::Reset()
 
 void CGameWorld::RemoveEntities()
 {
-	// destroy objects marked for destruction
+	// destroy objects marked for destruction, in list order like a walk over the list
 	for(int i = 0; i < NUM_ENTTYPES; i++)
-		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
+	{
+		CEntityArrays *pArrays = &m_aEntityArrays[i];
+		if(!pArrays->m_NumMarked)
+			continue;
+
+		if(pArrays->m_NumMarked > m_MaxCandidates)
+			GrowCandidates(pArrays->m_NumMarked);
+
+		int Num = 0;
+		for(int Index = 0; Index < pArrays->m_Num; Index++)
 		{
-			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-			if(pEnt->IsMarkedForDestroy())
-			{
-				RemoveEntity(pEnt);
-				pEnt->Destroy();
-			}
-			pEnt = m_pNextTraverseEntity;
+			if(pArrays->m_aMarkedForDestroy[Index])
+				m_aCandidates[Num++] = Index;
+		}
+		SortByListOrder(i, m_aCandidates, Num);
+
+		// removing them moves the others around in the arrays
+		for(int e = 0; e < Num; e++)
+			m_apCandidates[e] = pArrays->m_apEntities[m_aCandidates[e]];
+		for(int e = 0; e < Num; e++)
+		{
+			RemoveEntity(m_apCandidates[e]);
+			m_apCandidates[e]->Destroy();
 		}
+	}
 }
 
 void CGameWorld::Tick()
@@ -169,6 +512,7 @@ void CGameWorld::Tick()
 	if(!m_Paused)
 	{
 		// update all objects
+		CProfileScope PhaseScope(Server()->Profiler(), PROFILE_WORLD_TICK);
 		for(int i = 0; i < NUM_ENTTYPES; i++)
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
@@ -177,6 +521,7 @@ void CGameWorld::Tick()
 				pEnt = m_pNextTraverseEntity;
 			}
 
+		PhaseScope.Switch(PROFILE_WORLD_TICK_DEFERED);
 		for(int i = 0; i < NUM_ENTTYPES; i++)
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
@@ -198,6 +543,18 @@ void CGameWorld::Tick()
 	}
 
 	RemoveEntities();
+
+#ifdef CONF_DEBUG
+	// positions have to be changed with SetPos, or the queries miss the entity
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		{
+			const CEntityArrays *pArrays = &m_aEntityArrays[i];
+			dbg_assert(pArrays->m_apEntities[pEnt->m_Index] == pEnt, "entity arrays out of sync");
+			dbg_assert(pArrays->m_aPos[pEnt->m_Index] == pEnt->m_Pos, "entity moved without updating its position in the world");
+			dbg_assert(pArrays->m_aGridCell[pEnt->m_Index] == GridCell(pEnt->m_Pos, i), "entity moved without updating its grid cell");
+		}
+#endif
 }
 
 
@@ -206,54 +563,85 @@ CCharacter *CGameWorld::IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, v
 {
 	// Find other players
 	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
-	CCharacter *pClosest = 0;
-
-	CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER);
-	for(; p; p = (CCharacter *)p->TypeNext())
- 	{
-		if(p == pNotThis)
-			continue;
-
-		vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, p->m_Pos);
-		float Len = distance(p->m_Pos, IntersectPos);
-		if(Len < p->m_ProximityRadius+Radius)
+	int Closest = -1;
+
+	// only visit the cells the thick line passes through. the border
+	// cells also hold everything outside of the map, always visit them
+	float Range = Radius+m_aMaxProximityRadius[ENTTYPE_CHARACTER];
+	float CellRange = Range+GRID_CELL_SIZE*0.71f+1.0f;
+	int x0, y0, x1, y1;
+	GridRange(vec2(min(Pos0.x, Pos1.x), min(Pos0.y, Pos1.y))-vec2(Range, Range),
+		vec2(max(Pos0.x, Pos1.x), max(Pos0.y, Pos1.y))+vec2(Range, Range), &x0, &y0, &x1, &y1);
+
+	const CEntityArrays *pArrays = &m_aEntityArrays[ENTTYPE_CHARACTER];
+	int NotThis = pNotThis && pNotThis->m_ObjType == ENTTYPE_CHARACTER ? pNotThis->m_Index : -1;
+	for(int y = y0; y <= y1; y++)
+		for(int x = x0; x <= x1; x++)
 		{
-			Len = distance(Pos0, IntersectPos);
-			if(Len < ClosestLen)
+			if(x > 0 && y > 0 && x < m_GridWidth-1 && y < m_GridHeight-1)
 			{
-				NewPos = IntersectPos;
-				ClosestLen = Len;
-				pClosest = p;
+				vec2 Center = vec2((x+0.5f)*GRID_CELL_SIZE, (y+0.5f)*GRID_CELL_SIZE);
+				if(distance(Center, closest_point_on_line(Pos0, Pos1, Center)) > CellRange)
+					continue;
+			}
+
+			int Index = m_aGridCells[(ENTTYPE_CHARACTER*m_GridHeight+y)*m_GridWidth+x];
+			for(; Index != -1; Index = pArrays->m_aNextInCell[Index])
+			{
+				if(Index == NotThis)
+					continue;
+
+				vec2 Pos = pArrays->m_aPos[Index];
+				vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, Pos);
+				float Len = distance(Pos, IntersectPos);
+				if(Len < pArrays->m_aProximityRadius[Index]+Radius)
+				{
+					// on a tie the one earlier in the list wins
+					Len = distance(Pos0, IntersectPos);
+					if(Len < ClosestLen || (Closest != -1 && Len == ClosestLen && pArrays->m_aListOrder[Index] > pArrays->m_aListOrder[Closest]))
+					{
+						NewPos = IntersectPos;
+						ClosestLen = Len;
+						Closest = Index;
+					}
+				}
 			}
 		}
-	}
 
-	return pClosest;
+	return Closest == -1 ? 0 : (CCharacter *)pArrays->m_apEntities[Closest];
 }
 
 
 CEntity *CGameWorld::ClosestEntity(vec2 Pos, float Radius, int Type, CEntity *pNotThis)
 {
+	if(Type < 0 || Type >= NUM_ENTTYPES)
+		return 0;
+
 	// Find other players
 	float ClosestRange = Radius*2;
-	CEntity *pClosest = 0;
+	int Closest = -1;
 
-	CEntity *p = FindFirst(Type);
-	for(; p; p = p->TypeNext())
- 	{
-		if(p == pNotThis)
+	float Range = Radius+m_aMaxProximityRadius[Type];
+	int NumCandidates = FindCandidates(Pos-vec2(Range, Range), Pos+vec2(Range, Range), Type);
+	const CEntityArrays *pArrays = &m_aEntityArrays[Type];
+	int NotThis = pNotThis && pNotThis->m_ObjType == Type ? pNotThis->m_Index : -1;
+	for(int i = 0; i < NumCandidates; i++)
+	{
+		int Index = m_aCandidates[i];
+		if(Index == NotThis)
 			continue;
 
-		float Len = distance(Pos, p->m_Pos);
-		if(Len < p->m_ProximityRadius+Radius)
+		float Len = distance(Pos, pArrays->m_aPos[Index]);
+		if(Len < pArrays->m_aProximityRadius[Index]+Radius)
 		{
-			if(Len < ClosestRange)
+			// on a tie the one earlier in the list wins
+			if(Len < ClosestRange || (Closest != -1 && Len == ClosestRange && pArrays->m_aListOrder[Index] > pArrays->m_aListOrder[Closest]))
 			{
 				ClosestRange = Len;
-				pClosest = p;
+				Closest = Index;
 			}
 		}
 	}
 
-	return pClosest;
+	return Closest == -1 ? 0 : pArrays->m_apEntities[Closest];
 }
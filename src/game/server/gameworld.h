@@ -15,6 +15,8 @@ class CCharacter;
 */
 class CGameWorld
 {
+	friend class GameWorld; // the tests run it without a game context
+
 public:
 	enum
 	{
@@ -26,12 +28,85 @@ public:
 		NUM_ENTTYPES
 	};
 
+	enum
+	{
+		CLIPRANGE_ENTITY=0, // what a client sees of the world
+		CLIPRANGE_ENTITY_KEEP, // a bit more, entities stay in a snapshot until they leave it
+		CLIPRANGE_EVENT,
+		NUM_CLIPRANGES
+	};
+
 private:
+	enum
+	{
+		GRID_CELL_SHIFT=2, // a grid cell spans 4x4 tiles
+		GRID_CELL_SIZE=32<<GRID_CELL_SHIFT,
+	};
+
+	// the fields of the entities of a type that the loops over the whole world
+	// read, packed so they don't have to visit the entities themselves. an entity
+	// knows its index, removing one moves the last entity of the type into its place
+	struct CEntityArrays
+	{
+		CEntity **m_apEntities;
+		vec2 *m_aPos;
+		float *m_aProximityRadius;
+		bool *m_aMarkedForDestroy;
+		int64 *m_aListOrder;
+
+		// the entity lists of the grid cells, by index
+		int *m_aGridCell;
+		int *m_aPrevInCell;
+		int *m_aNextInCell;
+
+		int m_Num;
+		int m_Capacity;
+		int m_NumMarked;
+	};
+
 	void Reset();
 	void RemoveEntities();
 
+	void GrowArrays(CEntityArrays *pArrays);
+	int GridCell(vec2 Pos, int Type) const;
+	void GridRange(vec2 Min, vec2 Max, int *pX0, int *pY0, int *pX1, int *pY1) const;
+	void GridInsert(int Type, int Index);
+	void GridRemove(int Type, int Index);
+	void SortByListOrder(int Type, int *pIndices, int Num) const;
+	void GrowCandidates(int Num);
+	int FindCandidates(vec2 Min, vec2 Max, int Type);
+
 	CEntity *m_pNextTraverseEntity;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
+	CEntityArrays m_aEntityArrays[NUM_ENTTYPES];
+
+	// uniform grid over the map, one entity list per type and cell.
+	// the spatial queries only visit the cells around the query
+	int m_GridWidth;
+	int m_GridHeight;
+	int *m_aGridCells; // index of the first entity, -1 for none
+	float m_aMaxProximityRadius[NUM_ENTTYPES];
+	int64 m_NextListOrder;
+	int *m_aCandidates;
+	CEntity **m_apCandidates;
+	int m_MaxCandidates;
+
+	// the view positions of the players, gathered before every snapshot
+	vec2 m_aViewPos[MAX_CLIENTS];
+	int m_aViewClients[MAX_CLIENTS];
+	int m_NumViewClients;
+
+	// the area around the view a client sees: a box cut by a circle. the
+	// rectangles inside of it spare the distance for most positions
+	struct CClipRange
+	{
+		float m_HalfWidth;
+		float m_HalfHeight;
+		float m_Radius;
+		vec2 m_aInner[3];
+	};
+	CClipRange m_aClipRanges[NUM_CLIPRANGES];
+	CClientMask m_SnappedClients;
 
 	class CGameContext *m_pGameServer;
 	class IServer *m_pServer;
@@ -49,6 +124,16 @@ public:
 
 	void SetGameServer(CGameContext *pGameServer);
 
+	/*
+		Function: InitGrid
+			Sizes the grid of the spatial queries to the map.
+
+		Arguments:
+			Width - Width of the map in tiles.
+			Height - Height of the map in tiles.
+	*/
+	void InitGrid(int Width, int Height);
+
 	CEntity *FindFirst(int Type);
 
 	/*
@@ -117,6 +202,16 @@ public:
 	*/
 	void RemoveEntity(CEntity *pEntity);
 
+	/*
+		Function: MoveEntity
+			Updates the grid cell of an entity after its position changed.
+			Called by CEntity::SetPos.
+
+		Arguments:
+			entity - Entity that moved
+	*/
+	void MoveEntity(CEntity *pEntity);
+
 	/*
 		Function: destroy_entity
 			Destroys an entity in the world.
@@ -136,9 +231,52 @@ public:
 			is being created.
 	*/
 	void Snap(int SnappingClient);
-	
+
+	/*
+		Function: snap_shared
+			Lets all entities create the snapshot items that are
+			the same for every client.
+	*/
+	void SnapShared();
+
 	void PostSnap();
 
+	/*
+		Function: UpdateViews
+			Gathers the view positions of the players for the
+			network clipping of the next snapshot.
+	*/
+	void UpdateViews();
+
+	/*
+		Function: NetworkClipped
+			Checks if a position is too far from the view of a
+			client to be in its snapshot. Uses the views of the
+			last UpdateViews.
+
+		Arguments:
+			SnappingClient - Client whose view to check.
+			CheckPos - Position to check.
+			Range - One of the CLIPRANGE_* values.
+
+		Returns:
+			True if the client can't see the position.
+	*/
+	bool NetworkClipped(int SnappingClient, vec2 CheckPos, int Range=CLIPRANGE_ENTITY) const;
+
+	/*
+		Function: NetworkClippedMask
+			Performs the network clipping test for all clients at once.
+
+		Arguments:
+			CheckPos - Position to check.
+			Range - One of the CLIPRANGE_* values.
+
+		Returns:
+			Mask of the clients that can see the position.
+	*/
+	CClientMask NetworkClippedMask(vec2 CheckPos, int Range=CLIPRANGE_ENTITY) const;
+
 	/*
 		Function: tick
 			Calls tick on all the entities in the world to progress
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <game/server/alloc.h>
+
+class CPooled
+{
+	MACRO_ALLOC_POOL()
+
+public:
+	int m_Value;
+	char m_aPadding[20];
+
+	CPooled(int Value) : m_Value(Value) {}
+};
+
+MACRO_ALLOC_POOL_IMPL(CPooled, 4)
+
+static const CPool *FindPool(const char *pName)
+{
+	for(const CPool *pPool = CPool::First(); pPool; pPool = pPool->Next())
+		if(str_comp(pPool->Name(), pName) == 0)
+			return pPool;
+	return 0;
+}
+
+TEST(Alloc, PoolGrowsAndReuses)
+{
+	// the pool is global and keeps its chunks over repeated runs
+	const CPool *pPool = FindPool("CPooled");
+	ASSERT_TRUE(pPool);
+	EXPECT_EQ(pPool->Live(), 0);
+	int StartCapacity = pPool->Capacity();
+
+	CPooled *apObjects[10];
+	for(int i = 0; i < 10; i++)
+	{
+		apObjects[i] = new CPooled(i);
+		for(int j = 0; j < i; j++)
+			EXPECT_NE(apObjects[i], apObjects[j]);
+	}
+	EXPECT_EQ(pPool->Live(), 10);
+	EXPECT_EQ(pPool->Peak(), 10);
+	EXPECT_EQ(pPool->Capacity(), max(StartCapacity, 12));
+	for(int i = 0; i < 10; i++)
+		EXPECT_EQ(apObjects[i]->m_Value, i);
+
+	// freed objects get handed out again, zeroed like fresh ones
+	CPooled *pFreed = apObjects[3];
+	pFreed->m_aPadding[0] = 1;
+	delete pFreed;
+	apObjects[3] = new CPooled(33);
+	EXPECT_EQ(apObjects[3], pFreed);
+	EXPECT_EQ(apObjects[3]->m_aPadding[0], 0);
+
+	for(int i = 0; i < 10; i++)
+		delete apObjects[i];
+	EXPECT_EQ(pPool->Live(), 0);
+	EXPECT_EQ(pPool->Peak(), 10);
+
+	// once grown, the pool doesn't grow for the same number of objects again
+	for(int i = 0; i < 10; i++)
+		apObjects[i] = new CPooled(i);
+	EXPECT_EQ(pPool->Capacity(), max(StartCapacity, 12));
+	for(int i = 0; i < 10; i++)
+		delete apObjects[i];
+}
+
+TEST(Alloc, PoolGrowsInChunks)
+{
+	{
+		CPool Pool("CPoolOwned", 24, 4);
+		EXPECT_EQ(FindPool("CPoolOwned"), &Pool);
+		EXPECT_EQ(Pool.Capacity(), 0);
+
+		void *apObjects[5];
+		for(int i = 0; i < 5; i++)
+			apObjects[i] = Pool.Alloc();
+		EXPECT_EQ(Pool.Live(), 5);
+		EXPECT_EQ(Pool.Capacity(), 8);
+
+		for(int i = 0; i < 5; i++)
+			Pool.Free(apObjects[i]);
+		EXPECT_EQ(Pool.Live(), 0);
+		EXPECT_EQ(Pool.Peak(), 5);
+	}
+
+	// a destroyed pool leaves the list
+	EXPECT_FALSE(FindPool("CPoolOwned"));
+	EXPECT_TRUE(FindPool("CPooled"));
+}
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#include <engine/shared/protocol.h>
+
+TEST(ClientMask, SetAndUnset)
+{
+	CClientMask Mask;
+	EXPECT_TRUE(Mask.IsEmpty());
+
+	Mask.Set(0);
+	Mask.Set(MAX_CLIENTS-1);
+	EXPECT_FALSE(Mask.IsEmpty());
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		EXPECT_EQ(Mask.IsSet(i), i == 0 || i == MAX_CLIENTS-1);
+
+	Mask.Unset(0);
+	Mask.Unset(MAX_CLIENTS-1);
+	EXPECT_TRUE(Mask.IsEmpty());
+}
+
+TEST(ClientMask, AllAndUnion)
+{
+	CClientMask All = CClientMask::All();
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		EXPECT_TRUE(All.IsSet(i));
+
+	CClientMask Even, Odd;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(i%2)
+			Odd.Set(i);
+		else
+			Even.Set(i);
+	}
+	CClientMask Both = Even|Odd;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		EXPECT_TRUE(Both.IsSet(i));
+		EXPECT_EQ(Even.IsSet(i), i%2 == 0);
+	}
+
+	Even |= CClientMask::One(1);
+	EXPECT_TRUE(Even.IsSet(1));
+	EXPECT_FALSE(Even.IsSet(3));
+}
@@ -0,0 +1,300 @@
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+// the per pixel versions of the collision functions, the results have to match them exactly
+static int RefIntersectLine(const CCollision *pCol, vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
+{
+	float Distance = distance(Pos0, Pos1);
+	int End(Distance+1);
+	vec2 Last = Pos0;
+
+	for(int i = 0; i <= End; i++)
+	{
+		float a = i/float(End);
+		vec2 Pos = mix(Pos0, Pos1, a);
+		if(pCol->CheckPoint(Pos.x, Pos.y))
+		{
+			*pOutCollision = Pos;
+			*pOutBeforeCollision = Last;
+			return pCol->GetCollisionAt(Pos.x, Pos.y);
+		}
+		Last = Pos;
+	}
+	*pOutCollision = Pos1;
+	*pOutBeforeCollision = Pos1;
+	return 0;
+}
+
+static void RefMoveBox(const CCollision *pCol, vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity, bool *pDeath)
+{
+	vec2 Pos = *pInoutPos;
+	vec2 Vel = *pInoutVel;
+
+	float Distance = length(Vel);
+	int Max = (int)Distance;
+
+	if(pDeath)
+		*pDeath = false;
+
+	if(Distance > 0.00001f)
+	{
+		float Fraction = 1.0f/(float)(Max+1);
+		for(int i = 0; i <= Max; i++)
+		{
+			vec2 NewPos = Pos + Vel*Fraction;
+
+			if(pDeath && pCol->TestBox(vec2(NewPos.x, NewPos.y), Size*(2.0f/3.0f), CCollision::COLFLAG_DEATH))
+				*pDeath = true;
+
+			if(pCol->TestBox(vec2(NewPos.x, NewPos.y), Size))
+			{
+				int Hits = 0;
+
+				if(pCol->TestBox(vec2(Pos.x, NewPos.y), Size))
+				{
+					NewPos.y = Pos.y;
+					Vel.y *= -Elasticity;
+					Hits++;
+				}
+
+				if(pCol->TestBox(vec2(NewPos.x, Pos.y), Size))
+				{
+					NewPos.x = Pos.x;
+					Vel.x *= -Elasticity;
+					Hits++;
+				}
+
+				if(Hits == 0)
+				{
+					NewPos.y = Pos.y;
+					Vel.y *= -Elasticity;
+					NewPos.x = Pos.x;
+					Vel.x *= -Elasticity;
+				}
+			}
+
+			Pos = NewPos;
+		}
+	}
+
+	*pInoutPos = Pos;
+	*pInoutVel = Vel;
+}
+
+enum
+{
+	MAP_NOISE=0,
+	MAP_PLATFORMS,
+	MAP_EMPTY,
+	MAP_TINY,
+	NUM_MAPS
+};
+
+static void GenerateMap(int Type, CTestRandom *pRandom, CTile **ppTiles, int *pWidth, int *pHeight)
+{
+	int w = Type == MAP_TINY ? 3 : 60+pRandom->Int(40);
+	int h = Type == MAP_TINY ? 2 : 40+pRandom->Int(30);
+	CTile *pTiles = new CTile[w*h];
+	mem_zero(pTiles, sizeof(CTile)*w*h);
+
+	for(int y = 0; y < h; y++)
+		for(int x = 0; x < w; x++)
+		{
+			int Index = TILE_AIR;
+			bool Border = x == 0 || y == 0 || x == w-1 || y == h-1;
+			if(Type == MAP_NOISE)
+			{
+				int r = pRandom->Int(100);
+				Index = r < 25 ? TILE_SOLID : r < 30 ? TILE_NOHOOK : r < 33 ? TILE_DEATH : TILE_AIR;
+			}
+			else if(Type == MAP_PLATFORMS || Type == MAP_EMPTY)
+				Index = Border ? TILE_SOLID : TILE_AIR;
+			else if(Type == MAP_TINY)
+				Index = x == 1 && y == 1 ? TILE_SOLID : TILE_AIR;
+			pTiles[y*w+x].m_Index = Index;
+		}
+
+	if(Type == MAP_PLATFORMS)
+	{
+		// floors, walls and death pits the way maps are usually built
+		for(int p = 0; p < w*h/60; p++)
+		{
+			int x = 1+pRandom->Int(w-2), y = 1+pRandom->Int(h-2);
+			int Len = 2+pRandom->Int(12);
+			bool Vertical = pRandom->Int(3) == 0;
+			int Index = pRandom->Int(8) == 0 ? TILE_NOHOOK : pRandom->Int(10) == 0 ? TILE_DEATH : TILE_SOLID;
+			for(int i = 0; i < Len; i++)
+			{
+				int tx = Vertical ? x : min(x+i, w-2), ty = Vertical ? min(y+i, h-2) : y;
+				pTiles[ty*w+tx].m_Index = Index;
+			}
+		}
+	}
+
+	*ppTiles = pTiles;
+	*pWidth = w;
+	*pHeight = h;
+}
+
+static vec2 RandomPos(CTestRandom *pRandom, int Width, int Height)
+{
+	vec2 Pos(pRandom->Float(-64.0f, Width*32+64.0f), pRandom->Float(-64.0f, Height*32+64.0f));
+	// positions right on the pixel and tile borders
+	switch(pRandom->Int(6))
+	{
+	case 0: Pos.x = round_to_int(Pos.x)+0.5f; break;
+	case 1: Pos.y = (round_to_int(Pos.y)/32)*32-0.5f; break;
+	case 2: Pos = vec2(round_to_int(Pos.x), round_to_int(Pos.y)); break;
+	}
+	return Pos;
+}
+
+static bool SameVec(vec2 a, vec2 b)
+{
+	return mem_comp(&a, &b, sizeof(vec2)) == 0;
+}
+
+static void CheckLines(const CCollision *pCollision, CTestRandom *pRandom, int Num)
+{
+	int Width = pCollision->GetWidth(), Height = pCollision->GetHeight();
+	for(int i = 0; i < Num; i++)
+	{
+		vec2 Pos0 = RandomPos(pRandom, Width, Height);
+		vec2 Pos1;
+		switch(pRandom->Int(4))
+		{
+		case 0: Pos1 = Pos0+vec2(pRandom->Float(-2.0f, 2.0f), pRandom->Float(-2.0f, 2.0f)); break;
+		case 1: Pos1 = vec2(pRandom->Float(-64.0f, Width*32+64.0f), Pos0.y); break;
+		case 2: Pos1 = vec2(Pos0.x, pRandom->Float(-64.0f, Height*32+64.0f)); break;
+		default: Pos1 = RandomPos(pRandom, Width, Height);
+		}
+
+		vec2 Col, Before, RefCol, RefBefore;
+		int Hit = pCollision->IntersectLine(Pos0, Pos1, &Col, &Before);
+		int RefHit = RefIntersectLine(pCollision, Pos0, Pos1, &RefCol, &RefBefore);
+		ASSERT_EQ(Hit, RefHit) << "from " << Pos0.x << "," << Pos0.y << " to " << Pos1.x << "," << Pos1.y;
+		ASSERT_TRUE(SameVec(Col, RefCol)) << "from " << Pos0.x << "," << Pos0.y << " to " << Pos1.x << "," << Pos1.y;
+		ASSERT_TRUE(SameVec(Before, RefBefore)) << "from " << Pos0.x << "," << Pos0.y << " to " << Pos1.x << "," << Pos1.y;
+	}
+}
+
+static void CheckBoxes(const CCollision *pCollision, CTestRandom *pRandom, int Num)
+{
+	int Width = pCollision->GetWidth(), Height = pCollision->GetHeight();
+	for(int i = 0; i < Num; i++)
+	{
+		// a falling and running box, fed back like the character core does
+		vec2 Pos = RandomPos(pRandom, Width, Height);
+		vec2 Vel(pRandom->Float(-30.0f, 30.0f), pRandom->Float(-30.0f, 30.0f));
+		vec2 RefPos = Pos, RefVel = Vel;
+		vec2 Size = pRandom->Int(4) ? vec2(28.0f, 28.0f) : vec2(pRandom->Float(1.0f, 70.0f), pRandom->Float(1.0f, 70.0f));
+		float Elasticity = pRandom->Int(3)*0.5f;
+		bool UseDeath = pRandom->Int(2) == 0;
+
+		for(int Tick = 0; Tick < 50; Tick++)
+		{
+			if(pRandom->Int(10) == 0)
+				Vel = RefVel = vec2(pRandom->Float(-60.0f, 60.0f), pRandom->Float(-60.0f, 60.0f));
+			Vel.y += 0.5f;
+			RefVel.y += 0.5f;
+
+			bool Death = false, RefDeath = false;
+			pCollision->MoveBox(&Pos, &Vel, Size, Elasticity, UseDeath ? &Death : 0);
+			RefMoveBox(pCollision, &RefPos, &RefVel, Size, Elasticity, UseDeath ? &RefDeath : 0);
+			ASSERT_TRUE(SameVec(Pos, RefPos)) << "box " << i << " tick " << Tick;
+			ASSERT_TRUE(SameVec(Vel, RefVel)) << "box " << i << " tick " << Tick;
+			ASSERT_EQ(Death, RefDeath) << "box " << i << " tick " << Tick;
+		}
+	}
+}
+
+TEST(Collision, GeneratedMapsMatchPerPixel)
+{
+	CTestRandom Random(1234);
+	for(int Map = 0; Map < NUM_MAPS; Map++)
+	{
+		CTile *pTiles;
+		int Width, Height;
+		GenerateMap(Map, &Random, &pTiles, &Width, &Height);
+		for(int Field = 0; Field < 2; Field++)
+		{
+			CCollision Collision;
+			Collision.Init(pTiles, Width, Height, Field != 0);
+
+			SCOPED_TRACE(Map*2+Field);
+			CheckLines(&Collision, &Random, 4000);
+			CheckBoxes(&Collision, &Random, 500);
+		}
+		delete[] pTiles;
+	}
+}
+
+TEST(Collision, DistanceField)
+{
+	CTestRandom Random(42);
+	CTile *pTiles;
+	int Width, Height;
+	GenerateMap(MAP_PLATFORMS, &Random, &pTiles, &Width, &Height);
+	CCollision Collision;
+	Collision.Init(pTiles, Width, Height);
+
+	// compare with a brute force search for the nearest tile with flags
+	for(int y = 0; y < Height; y++)
+		for(int x = 0; x < Width; x++)
+		{
+			int Nearest = CCollision::MAX_DISTANCE;
+			for(int v = 0; v < Height; v++)
+				for(int u = 0; u < Width; u++)
+					if(Collision.GetCollisionAt(u*32, v*32))
+						Nearest = min(Nearest, max(absolute(u-x), absolute(v-y)));
+			ASSERT_EQ(Collision.GetTileDistance(x, y), Nearest) << x << "," << y;
+		}
+
+	CCollision::CStats Stats;
+	Collision.GetStats(&Stats);
+	EXPECT_EQ(Stats.m_FlagBytes, (Width*Height+1)/2);
+	EXPECT_EQ(Stats.m_DistanceBytes, Width*Height);
+	EXPECT_GT(Stats.m_NumTileProbes, 0);
+	delete[] pTiles;
+}
+
+TEST(Collision, RealMapsMatchPerPixel)
+{
+	// the menu theme maps, the tests run from the build directory that has them
+	static const char *s_apMaps[] = {"heavens_day", "jungle_day", "winter_day"};
+	IStorage *pStorage = CreateTestStorage();
+	CTestRandom Random(5678);
+	for(unsigned m = 0; m < sizeof(s_apMaps)/sizeof(s_apMaps[0]); m++)
+	{
+		char aPath[128];
+		str_format(aPath, sizeof(aPath), "data/ui/themes/%s.map", s_apMaps[m]);
+		IEngineMap *pMap = CreateEngineMap();
+		if(!pMap->Load(aPath, pStorage))
+		{
+			// the downloaded gtest has no GTEST_SKIP, a missing map fails the test
+			ADD_FAILURE() << "couldn't load " << aPath << ", the build directory should have it";
+			delete pMap;
+			continue;
+		}
+
+		CLayers Layers;
+		Layers.Init(0, pMap);
+		CCollision Collision;
+		Collision.Init(&Layers);
+
+		SCOPED_TRACE(s_apMaps[m]);
+		CheckLines(&Collision, &Random, 4000);
+		CheckBoxes(&Collision, &Random, 500);
+		delete pMap;
+	}
+	delete pStorage;
+}
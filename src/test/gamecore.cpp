@@ -0,0 +1,164 @@
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/mapitems.h>
+
+// the per pixel player collision of CCharacterCore::Move against all players, the results have to match it exactly
+static void RefMove(const CWorldCore *pWorld, CCollision *pCollision, const CCharacterCore *pCore, vec2 *pPos, vec2 *pVel, bool *pDeath)
+{
+	float PhysSize = 28.0f;
+	vec2 Pos = pCore->m_Pos;
+	vec2 Vel = pCore->m_Vel;
+	float RampValue = VelocityRamp(length(Vel)*50, pWorld->m_Tuning.m_VelrampStart, pWorld->m_Tuning.m_VelrampRange, pWorld->m_Tuning.m_VelrampCurvature);
+
+	Vel.x = Vel.x*RampValue;
+
+	vec2 NewPos = Pos;
+	pCollision->MoveBox(&NewPos, &Vel, vec2(PhysSize, PhysSize), 0, pDeath);
+
+	Vel.x = Vel.x*(1.0f/RampValue);
+	*pVel = Vel;
+	*pPos = NewPos;
+
+	float Distance = distance(Pos, NewPos);
+	int End = Distance+1;
+	vec2 LastPos = Pos;
+	for(int i = 0; i < End; i++)
+	{
+		float a = i/Distance;
+		vec2 MovePos = mix(Pos, NewPos, a);
+		for(int p = 0; p < MAX_CLIENTS; p++)
+		{
+			CCharacterCore *pCharCore = pWorld->m_apCharacters[p];
+			if(!pCharCore || pCharCore == pCore)
+				continue;
+			float D = distance(MovePos, pCharCore->m_Pos);
+			if(D < PhysSize && D > 0.0f)
+			{
+				if(a > 0.0f)
+					*pPos = LastPos;
+				else if(distance(NewPos, pCharCore->m_Pos) > D)
+					*pPos = NewPos;
+				else
+					*pPos = Pos;
+				return;
+			}
+		}
+		LastPos = MovePos;
+	}
+}
+
+class GameCore : public ::testing::Test
+{
+protected:
+	enum
+	{
+		WIDTH=40,
+		HEIGHT=30,
+	};
+
+	CTile m_aTiles[WIDTH*HEIGHT];
+	CCollision m_Collision;
+	CWorldCore m_World;
+	CCharacterCore m_aCores[MAX_CLIENTS];
+	CTestRandom m_Random;
+
+	GameCore() : m_Random(4321)
+	{
+		mem_zero(m_aTiles, sizeof(m_aTiles));
+		for(int y = 0; y < HEIGHT; y++)
+			for(int x = 0; x < WIDTH; x++)
+			{
+				bool Border = x == 0 || y == 0 || x == WIDTH-1 || y == HEIGHT-1;
+				m_aTiles[y*WIDTH+x].m_Index = Border || m_Random.Int(40) == 0 ? TILE_SOLID : TILE_AIR;
+			}
+		m_Collision.Init(m_aTiles, WIDTH, HEIGHT);
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			m_aCores[i].Init(&m_World, &m_Collision);
+			m_aCores[i].Reset();
+		}
+	}
+
+	// a crowd in the middle of the map, some of them on the same spot
+	void Scatter(int Num, float Spread)
+	{
+		mem_zero(m_World.m_apCharacters, sizeof(m_World.m_apCharacters));
+		for(int i = 0; i < Num; i++)
+		{
+			int ID = m_Random.Int(MAX_CLIENTS);
+			CCharacterCore *pCore = &m_aCores[ID];
+			m_World.m_apCharacters[ID] = pCore;
+			if(i > 0 && m_Random.Int(8) == 0)
+				pCore->m_Pos = m_aCores[m_Random.Int(MAX_CLIENTS)].m_Pos;
+			else
+				pCore->m_Pos = vec2(WIDTH*16.0f+m_Random.Float(-Spread, Spread), HEIGHT*16.0f+m_Random.Float(-Spread, Spread));
+			float Speed = m_Random.Int(4) == 0 ? 200.0f : 30.0f;
+			pCore->m_Vel = vec2(m_Random.Float(-Speed, Speed), m_Random.Float(-Speed, Speed));
+		}
+	}
+};
+
+TEST_F(GameCore, MoveMatchesAllPlayers)
+{
+	for(int Round = 0; Round < 400; Round++)
+	{
+		Scatter(1+m_Random.Int(MAX_CLIENTS), m_Random.Int(2) ? 100.0f : 300.0f);
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			CCharacterCore *pCore = m_World.m_apCharacters[i];
+			if(!pCore)
+				continue;
+
+			vec2 RefPos, RefVel;
+			bool RefDeath;
+			RefMove(&m_World, &m_Collision, pCore, &RefPos, &RefVel, &RefDeath);
+			pCore->Move();
+			ASSERT_EQ(pCore->m_Pos.x, RefPos.x) << "round " << Round << " core " << i;
+			ASSERT_EQ(pCore->m_Pos.y, RefPos.y) << "round " << Round << " core " << i;
+			ASSERT_EQ(pCore->m_Vel.x, RefVel.x) << "round " << Round << " core " << i;
+			ASSERT_EQ(pCore->m_Vel.y, RefVel.y) << "round " << Round << " core " << i;
+			ASSERT_EQ(pCore->m_Death, RefDeath) << "round " << Round << " core " << i;
+		}
+	}
+}
+
+TEST_F(GameCore, IntersectCharactersFindsHookTargets)
+{
+	const float Radius = 28.0f+2.0f;
+	for(int Round = 0; Round < 2000; Round++)
+	{
+		Scatter(1+m_Random.Int(MAX_CLIENTS), 300.0f);
+		vec2 Pos0 = vec2(WIDTH*16.0f+m_Random.Float(-300.0f, 300.0f), HEIGHT*16.0f+m_Random.Float(-300.0f, 300.0f));
+		vec2 Pos1 = m_Random.Int(10) == 0 ? Pos0 : Pos0+vec2(m_Random.Float(-400.0f, 400.0f), m_Random.Float(-400.0f, 400.0f));
+		const CCharacterCore *pNotThis = &m_aCores[m_Random.Int(MAX_CLIENTS)];
+
+		int aIDs[MAX_CLIENTS];
+		int Num = m_World.IntersectCharacters(Pos0, Pos1, Radius, pNotThis, aIDs);
+		for(int c = 1; c < Num; c++)
+			ASSERT_LT(aIDs[c-1], aIDs[c]);
+
+		// everything the exact check of the hook hits has to be among the candidates
+		int Found = 0;
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			CCharacterCore *pCharCore = m_World.m_apCharacters[i];
+			if(!pCharCore || pCharCore == pNotThis)
+				continue;
+			bool Candidate = Found < Num && aIDs[Found] == i;
+			if(Candidate)
+				Found++;
+			vec2 ClosestPoint = closest_point_on_line(Pos0, Pos1, pCharCore->m_Pos);
+			if(distance(pCharCore->m_Pos, ClosestPoint) < Radius)
+			{
+				ASSERT_TRUE(Candidate) << "round " << Round << " core " << i;
+			}
+		}
+		ASSERT_EQ(Found, Num);
+	}
+}
@@ -0,0 +1,82 @@
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <engine/console.h>
+#include <engine/map.h>
+#include <engine/masterserver.h>
+#include <engine/server.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/econ.h>
+#include <engine/shared/mapchecker.h>
+#include <engine/shared/netban.h>
+#include <engine/shared/network.h>
+#include <engine/server/register.h>
+#include <engine/server/server.h>
+#include <game/server/entity.h>
+#include <game/server/gameworld.h>
+
+class CTestEntity : public CEntity
+{
+public:
+	int m_Number;
+	int *m_pNumDestroyed;
+
+	CTestEntity(CGameWorld *pGameWorld, vec2 Pos, int Number, int *pNumDestroyed) :
+		CEntity(pGameWorld, CGameWorld::ENTTYPE_PROJECTILE, Pos), m_Number(Number), m_pNumDestroyed(pNumDestroyed)
+	{
+		GameWorld()->InsertEntity(this);
+	}
+
+	virtual void Destroy() { (*m_pNumDestroyed)++; delete this; }
+};
+
+class GameWorld : public ::testing::Test
+{
+protected:
+	CServer *m_pServer;
+	CGameWorld *m_pWorld;
+
+	GameWorld()
+	{
+		// the entities only need the server for their snapshot ids
+		m_pServer = new CServer();
+		m_pWorld = new CGameWorld();
+		m_pWorld->m_pServer = m_pServer;
+	}
+
+	~GameWorld()
+	{
+		delete m_pWorld;
+		delete m_pServer;
+	}
+
+	int Count(int Type)
+	{
+		int Num = 0;
+		for(CEntity *pEnt = m_pWorld->FindFirst(Type); pEnt; pEnt = pEnt->TypeNext())
+			Num++;
+		return Num;
+	}
+};
+
+TEST_F(GameWorld, RemovesMoreEntitiesThanCandidates)
+{
+	// more marked entities of one type than the candidate arrays start out with
+	enum { NUM=200 };
+	int NumDestroyed = 0;
+	CTestRandom Random(1);
+	CTestEntity *apEnts[NUM];
+	for(int i = 0; i < NUM; i++)
+		apEnts[i] = new CTestEntity(m_pWorld, vec2(Random.Float(0.0f, 1000.0f), Random.Float(0.0f, 1000.0f)), i, &NumDestroyed);
+	for(int i = 0; i < NUM; i++)
+		if(i%10 != 0)
+			m_pWorld->DestroyEntity(apEnts[i]);
+
+	m_pWorld->Tick();
+	EXPECT_EQ(NumDestroyed, NUM-NUM/10);
+	EXPECT_EQ(Count(CGameWorld::ENTTYPE_PROJECTILE), NUM/10);
+	EXPECT_EQ(m_pWorld->FindEntities(vec2(500.0f, 500.0f), 1000.0f, 0, NUM, CGameWorld::ENTTYPE_PROJECTILE), NUM/10);
+	for(CEntity *pEnt = m_pWorld->FindFirst(CGameWorld::ENTTYPE_PROJECTILE); pEnt; pEnt = pEnt->TypeNext())
+		EXPECT_EQ(static_cast<CTestEntity *>(pEnt)->m_Number%10, 0);
+}
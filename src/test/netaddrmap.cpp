@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/network.h>
+
+static NETADDR Addr(int IP, int Port)
+{
+	NETADDR Addr;
+	mem_zero(&Addr, sizeof(Addr));
+	Addr.type = NETTYPE_IPV4;
+	Addr.ip[0] = 10;
+	Addr.ip[2] = IP>>8;
+	Addr.ip[3] = IP&0xff;
+	Addr.port = Port;
+	return Addr;
+}
+
+TEST(NetAddrMap, FindAndCount)
+{
+	ASSERT_EQ(secure_random_init(), 0);
+	static CNetAddrMap s_Map;
+	s_Map.Init();
+
+	NETADDR A = Addr(1, 8303), B = Addr(1, 8304), C = Addr(2, 8303);
+	s_Map.Add(0, &A);
+	s_Map.Add(5, &B);
+	s_Map.Add(1, &C);
+
+	EXPECT_EQ(s_Map.Find(&A), 0);
+	EXPECT_EQ(s_Map.Find(&B), 5);
+	EXPECT_EQ(s_Map.Find(&C), 1);
+	NETADDR Unknown = Addr(1, 1);
+	EXPECT_EQ(s_Map.Find(&Unknown), -1);
+	EXPECT_EQ(s_Map.NumSlots(&Unknown), 2);
+	EXPECT_EQ(s_Map.NumSlots(&C), 1);
+	EXPECT_EQ(s_Map.FirstFreeSlot(NET_MAX_CLIENTS), 2);
+
+	s_Map.Remove(0);
+	EXPECT_EQ(s_Map.Find(&A), -1);
+	EXPECT_EQ(s_Map.Find(&B), 5);
+	EXPECT_EQ(s_Map.NumSlots(&A), 1);
+	EXPECT_EQ(s_Map.FirstFreeSlot(NET_MAX_CLIENTS), 0);
+}
+
+// fills the map, removes in random order and checks against a plain array
+TEST(NetAddrMap, MatchesLinearSearch)
+{
+	ASSERT_EQ(secure_random_init(), 0);
+	static CNetAddrMap s_Map;
+	s_Map.Init();
+
+	NETADDR aSlots[NET_MAX_CLIENTS];
+	bool aUsed[NET_MAX_CLIENTS] = {false};
+	unsigned Random = 5;
+	for(int Step = 0; Step < 5000; Step++)
+	{
+		Random = Random*1103515245+12345;
+		int Slot = (Random>>8)%NET_MAX_CLIENTS;
+		if(aUsed[Slot])
+		{
+			s_Map.Remove(Slot);
+			aUsed[Slot] = false;
+		}
+		else
+		{
+			// few ips so that they share entries
+			aSlots[Slot] = Addr((Random>>16)%24, 8000+(Random>>20)%4);
+			bool Taken = false;
+			for(int i = 0; i < NET_MAX_CLIENTS; i++)
+				Taken |= aUsed[i] && net_addr_comp(&aSlots[i], &aSlots[Slot]) == 0;
+			if(Taken)
+				continue;
+			s_Map.Add(Slot, &aSlots[Slot]);
+			aUsed[Slot] = true;
+		}
+
+		for(int i = 0; i < NET_MAX_CLIENTS; i++)
+		{
+			if(!aUsed[i])
+				continue;
+			int Count = 0;
+			for(int j = 0; j < NET_MAX_CLIENTS; j++)
+				Count += aUsed[j] && mem_comp(aSlots[j].ip, aSlots[i].ip, sizeof(aSlots[i].ip)) == 0;
+			ASSERT_EQ(s_Map.Find(&aSlots[i]), i);
+			ASSERT_EQ(s_Map.NumSlots(&aSlots[i]), Count);
+		}
+	}
+}
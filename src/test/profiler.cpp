@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <engine/shared/profiler.h>
+
+TEST(Profiler, BucketBounds)
+{
+	for(int64 Value = 0; Value < 1<<22; Value += 1+Value/64)
+	{
+		int Bucket = CProfileHistogram::Bucket(Value);
+		ASSERT_LE(Value, CProfileHistogram::BucketMax(Bucket));
+		if(Bucket > 0)
+		{
+			ASSERT_GT(Value, CProfileHistogram::BucketMax(Bucket-1));
+		}
+		// the bucket is at most an eighth wider than the values in it
+		ASSERT_LE(CProfileHistogram::BucketMax(Bucket), Value+Value/8+1);
+	}
+	EXPECT_EQ(CProfileHistogram::Bucket((int64)1<<40), CProfileHistogram::NUM_BUCKETS-1);
+}
+
+TEST(Profiler, Percentiles)
+{
+	CProfileHistogram Histogram;
+	Histogram.Clear();
+	EXPECT_EQ(Histogram.Percentile(50), 0);
+
+	for(int i = 1; i <= 1000; i++)
+		Histogram.Add(i);
+	EXPECT_EQ(Histogram.Count(), 1000);
+	EXPECT_EQ(Histogram.Max(), 1000);
+	EXPECT_GE(Histogram.Percentile(50), 500);
+	EXPECT_LE(Histogram.Percentile(50), 500+500/8);
+	EXPECT_GE(Histogram.Percentile(99), 990);
+	EXPECT_EQ(Histogram.Percentile(100), 1000);
+
+	CProfileHistogram Other;
+	Other.Clear();
+	Other.Add(5000);
+	Histogram.Merge(&Other);
+	EXPECT_EQ(Histogram.Count(), 1001);
+	EXPECT_EQ(Histogram.Max(), 5000);
+	EXPECT_EQ(Histogram.Percentile(100), 5000);
+}
+
+TEST(Profiler, RollingWindows)
+{
+	CProfiler Profiler;
+	Profiler.SetEnabled(true);
+	int64 Window = time_freq()*CProfiler::WINDOW_SECONDS;
+	int64 Now = Window;
+
+	Profiler.Update(Now);
+	Profiler.Add(PROFILE_TICK, time_freq()/1000);
+
+	CProfileHistogram Stats;
+	Profiler.GetStats(PROFILE_TICK, &Stats);
+	EXPECT_EQ(Stats.Count(), 1);
+	EXPECT_EQ(Stats.Max(), 1000);
+
+	// the sample is still reported from the previous window
+	Now += Window;
+	Profiler.Update(Now);
+	Profiler.GetStats(PROFILE_TICK, &Stats);
+	EXPECT_EQ(Stats.Count(), 1);
+
+	Now += Window;
+	Profiler.Update(Now);
+	Profiler.GetStats(PROFILE_TICK, &Stats);
+	EXPECT_EQ(Stats.Count(), 0);
+}
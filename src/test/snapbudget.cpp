@@ -0,0 +1,246 @@
+#include "test.h"
+
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/console.h>
+#include <engine/map.h>
+#include <engine/masterserver.h>
+#include <engine/server.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/econ.h>
+#include <engine/shared/mapchecker.h>
+#include <engine/shared/netban.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/server/register.h>
+#include <engine/server/server.h>
+#include <generated/protocol.h>
+
+class SnapshotBudget : public ::testing::Test
+{
+protected:
+	enum
+	{
+		NUM_CHARACTERS=5,
+		NUM_PROJECTILES=40,
+		NUM_PICKUPS=40,
+		NUM_ITEMS=NUM_CHARACTERS+NUM_PROJECTILES+NUM_PICKUPS,
+		NUM_NEW_PICKUPS=20, // appear with the third version of the world
+	};
+
+	CServer *m_pServer;
+	IGameServer *m_pGameServer;
+	int m_SnapBudget;
+	char m_aBase[CSnapshot::MAX_SIZE];
+	char m_aSnap[CSnapshot::MAX_SIZE];
+
+	SnapshotBudget()
+	{
+		// the priorities come from the game, a client that never acked a snapshot
+		// gets the whole budget
+		m_pServer = new CServer();
+		m_pGameServer = CreateGameServer();
+		m_pServer->m_pGameServer = m_pGameServer;
+		m_pServer->InitSnapshots(1);
+		CServer::NewClientCallback(0, m_pServer);
+		m_SnapBudget = g_Config.m_SvSnapBudget;
+	}
+
+	~SnapshotBudget()
+	{
+		g_Config.m_SvSnapBudget = m_SnapBudget;
+		m_pServer->m_aClients[0].m_Snapshots.PurgeAll();
+		delete[] m_pServer->m_pSnapClients;
+		delete m_pGameServer;
+		delete m_pServer;
+	}
+
+	static int NumItems(int Version) { return Version >= 3 ? NUM_ITEMS+NUM_NEW_PICKUPS : NUM_ITEMS; }
+
+	// every int of an item holds the version of the world and its id
+	static int Build(void *pData, int Version)
+	{
+		static CSnapshotBuilder s_Builder;
+		s_Builder.Init();
+		for(int i = 0; i < NumItems(Version); i++)
+		{
+			int Type, ID, Size;
+			Item(i, &Type, &ID, &Size);
+			int *pItem = (int *)s_Builder.NewItem(Type, ID, Size);
+			for(int j = 0; j < Size/(int)sizeof(int); j++)
+				pItem[j] = Version*1000+ID;
+		}
+		return s_Builder.Finish(pData);
+	}
+
+	static void Item(int Index, int *pType, int *pID, int *pSize)
+	{
+		if(Index < NUM_CHARACTERS)
+		{
+			*pType = NETOBJTYPE_CHARACTER;
+			*pID = Index;
+			*pSize = sizeof(CNetObj_Character);
+		}
+		else if(Index < NUM_CHARACTERS+NUM_PROJECTILES)
+		{
+			*pType = NETOBJTYPE_PROJECTILE;
+			*pID = Index-NUM_CHARACTERS;
+			*pSize = sizeof(CNetObj_Projectile);
+		}
+		else
+		{
+			*pType = NETOBJTYPE_PICKUP;
+			*pID = Index-NUM_CHARACTERS-NUM_PROJECTILES;
+			*pSize = sizeof(CNetObj_Pickup);
+		}
+	}
+
+	// the client acks what it got, the next snapshot is made on the next tick
+	int Budget(int BaseSize, int Version)
+	{
+		CServer::CClient *pClient = &m_pServer->m_aClients[0];
+		pClient->m_Snapshots.Add(m_pServer->m_CurrentGameTick, time_get(), BaseSize, m_aBase);
+		pClient->m_LastAckedSnapshot = m_pServer->m_CurrentGameTick;
+		pClient->m_LastSnapshot = m_pServer->m_CurrentGameTick;
+		m_pServer->m_CurrentGameTick++;
+		return m_pServer->BudgetSnapshot(0, (CSnapshot *)m_aSnap, Build(m_aSnap, Version));
+	}
+
+	// the client acks the snapshot it got the given number of snapshots before the newest
+	// one, every tick gets a snapshot
+	int BudgetLagging(int Version, int AckLag)
+	{
+		CServer::CClient *pClient = &m_pServer->m_aClients[0];
+		pClient->m_LastAckedSnapshot = max(pClient->m_LastSnapshot-AckLag, 0);
+		m_pServer->m_CurrentGameTick++;
+		int Size = m_pServer->BudgetSnapshot(0, (CSnapshot *)m_aSnap, Build(m_aSnap, Version));
+		pClient->m_Snapshots.Add(m_pServer->m_CurrentGameTick, time_get(), Size, m_aSnap);
+		pClient->m_LastSnapshot = m_pServer->m_CurrentGameTick;
+		return Size;
+	}
+
+	// the version of the world the client has of an item
+	int Version(const CSnapshot *pSnap, int Type, int ID)
+	{
+		int Index = pSnap->GetItemIndex((Type<<16)|ID);
+		return Index < 0 ? -1 : pSnap->GetItem(Index)->Data()[0]/1000;
+	}
+};
+
+TEST_F(SnapshotBudget, DefersLowPriorityItems)
+{
+	// a fifth of a second worth of bytes, less than the changes of all items cost
+	g_Config.m_SvSnapBudget = 5000;
+	int Size = Build(m_aBase, 1);
+
+	Size = Budget(Size, 2);
+	const CSnapshot *pSnap = (const CSnapshot *)m_aSnap;
+	EXPECT_EQ(pSnap->NumItems(), (int)NUM_ITEMS);
+	EXPECT_GT(m_pServer->m_aClients[0].m_NumDeferredItems, 0);
+
+	// the characters and projectiles matter more than the pickups
+	int NumDeferred = 0;
+	for(int i = 0; i < NUM_ITEMS; i++)
+	{
+		int Type, ID, ItemSize;
+		Item(i, &Type, &ID, &ItemSize);
+		int ItemVersion = Version(pSnap, Type, ID);
+		if(Type == NETOBJTYPE_PICKUP)
+		{
+			EXPECT_TRUE(ItemVersion == 1 || ItemVersion == 2);
+			NumDeferred += ItemVersion == 1;
+		}
+		else
+			EXPECT_EQ(ItemVersion, 2);
+	}
+	EXPECT_EQ(NumDeferred, m_pServer->m_aClients[0].m_NumDeferredItems);
+
+	// the deferred changes arrive with the next snapshot
+	mem_copy(m_aBase, m_aSnap, Size);
+	Budget(Size, 2);
+	EXPECT_EQ(m_pServer->m_aClients[0].m_NumDeferredItems, 0);
+	for(int i = 0; i < NUM_ITEMS; i++)
+	{
+		int Type, ID, ItemSize;
+		Item(i, &Type, &ID, &ItemSize);
+		EXPECT_EQ(Version(pSnap, Type, ID), 2);
+	}
+}
+
+TEST_F(SnapshotBudget, KeepsWhatUnackedSnapshotsShowed)
+{
+	// the acks lag two snapshots behind, the client has newer versions of the items than
+	// the acked snapshot. no item may go back to an older version or vanish again
+	g_Config.m_SvSnapBudget = 5000;
+	CServer::CClient *pClient = &m_pServer->m_aClients[0];
+	int aNewest[NUM_ITEMS+NUM_NEW_PICKUPS];
+	for(int i = 0; i < NUM_ITEMS+NUM_NEW_PICKUPS; i++)
+		aNewest[i] = i < NUM_ITEMS ? 1 : -1;
+	pClient->m_Snapshots.Add(0, time_get(), Build(m_aSnap, 1), m_aSnap);
+	pClient->m_LastAckedSnapshot = 0;
+	pClient->m_LastSnapshot = 0;
+
+	const CSnapshot *pSnap = (const CSnapshot *)m_aSnap;
+	int NumDeferred = 0;
+	for(int Round = 0; Round < 20; Round++)
+	{
+		int WorldVersion = Round+2;
+		BudgetLagging(WorldVersion, 2);
+		NumDeferred += pClient->m_NumDeferredItems;
+
+		for(int i = 0; i < NumItems(WorldVersion); i++)
+		{
+			int Type, ID, ItemSize;
+			Item(i, &Type, &ID, &ItemSize);
+			int ItemVersion = Version(pSnap, Type, ID);
+			EXPECT_GE(ItemVersion, aNewest[i]);
+			aNewest[i] = max(aNewest[i], ItemVersion);
+		}
+	}
+	EXPECT_GT(NumDeferred, 0);
+}
+
+TEST_F(SnapshotBudget, FollowsTheSnapshotAcks)
+{
+	g_Config.m_SvSnapBudget = 5000;
+	CServer::CClient *pClient = &m_pServer->m_aClients[0];
+	int64 Freq = time_freq();
+	int64 Now = 0;
+	int Size = Build(m_aSnap, 1);
+	for(int Tick = 0; Tick < 200; Tick++)
+		pClient->m_Snapshots.Add(Tick, 0, Size, m_aSnap);
+	EXPECT_EQ(m_pServer->SnapBudget(0), 5000);
+
+	// every second snapshot gets lost, the budget shrinks
+	pClient->m_LastAckedSnapshot = 0;
+	for(int Tick = 2; Tick < 200; Tick += 2)
+	{
+		int PrevAcked = pClient->m_LastAckedSnapshot;
+		pClient->m_LastAckedSnapshot = Tick;
+		Now += Freq/25;
+		pClient->AckSnapshot(PrevAcked, Freq/20, Now);
+	}
+	EXPECT_NEAR(pClient->m_SnapLoss, 0.5f, 0.05f);
+	EXPECT_LT(m_pServer->SnapBudget(0), 2500);
+
+	// none get lost anymore, but the round trip stays longer after a route change. it
+	// looks like queueing until the short round trips left the windows
+	for(int Tick = 1; Tick < 200; Tick++)
+	{
+		pClient->m_LastAckedSnapshot = Tick;
+		Now += Freq/50;
+		pClient->AckSnapshot(Tick-1, Freq/5, Now);
+	}
+	EXPECT_LT(pClient->m_SnapLoss, 0.01f);
+	EXPECT_LT(m_pServer->SnapBudget(0), 4000);
+	for(int i = 0; i < 2*CServer::CClient::SNAP_RTT_WINDOW*50; i++)
+	{
+		Now += Freq/50;
+		pClient->AckSnapshot(pClient->m_LastAckedSnapshot, Freq/5, Now);
+	}
+	EXPECT_EQ(pClient->SnapMinRtt(), Freq/5);
+	EXPECT_GT(m_pServer->SnapBudget(0), 4950);
+}
@@ -0,0 +1,433 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/snapshot.h>
+
+static const int s_aItemSizes[] = {0, 4, 12, 20, 8, 36, 24};
+static const int NUM_TYPES = sizeof(s_aItemSizes)/sizeof(s_aItemSizes[0]);
+
+class CSnapshotTestRandom
+{
+	unsigned m_State;
+
+public:
+	CSnapshotTestRandom(unsigned Seed) : m_State(Seed) {}
+	int Next(int Max)
+	{
+		m_State = m_State*1103515245+12345;
+		return (int)((m_State>>8)%(unsigned)Max);
+	}
+};
+
+// the hashed implementation CSnapshotDelta::CreateDelta used to have
+static int ReferenceCreateDelta(const short *pItemSizes, const CSnapshot *pFrom, const CSnapshot *pTo, void *pDstData)
+{
+	struct CItemList
+	{
+		int m_Num;
+		int m_aKeys[64];
+		int m_aIndex[64];
+	};
+	static CItemList s_aHashlist[256];
+
+	CSnapshotDelta::CData *pDelta = (CSnapshotDelta::CData *)pDstData;
+	int *pData = (int *)pDelta->m_pData;
+	pDelta->m_NumDeletedItems = 0;
+	pDelta->m_NumUpdateItems = 0;
+	pDelta->m_NumTempItems = 0;
+
+	for(int Pass = 0; Pass < 2; Pass++)
+	{
+		const CSnapshot *pHashed = Pass == 0 ? pTo : pFrom;
+		const CSnapshot *pOther = Pass == 0 ? pFrom : pTo;
+		for(int i = 0; i < 256; i++)
+			s_aHashlist[i].m_Num = 0;
+		for(int i = 0; i < pHashed->NumItems(); i++)
+		{
+			int Key = pHashed->GetItem(i)->Key();
+			CItemList *pList = &s_aHashlist[((Key>>12)&0xf0) | (Key&0xf)];
+			if(pList->m_Num != 64)
+			{
+				pList->m_aIndex[pList->m_Num] = i;
+				pList->m_aKeys[pList->m_Num] = Key;
+				pList->m_Num++;
+			}
+		}
+
+		for(int i = 0; i < pOther->NumItems(); i++)
+		{
+			const CSnapshotItem *pItem = pOther->GetItem(i);
+			int Key = pItem->Key();
+			const CItemList *pList = &s_aHashlist[((Key>>12)&0xf0) | (Key&0xf)];
+			int Index = -1;
+			for(int k = 0; k < pList->m_Num; k++)
+				if(pList->m_aKeys[k] == Key)
+				{
+					Index = pList->m_aIndex[k];
+					break;
+				}
+
+			if(Pass == 0)
+			{
+				if(Index == -1)
+				{
+					pDelta->m_NumDeletedItems++;
+					*pData++ = Key;
+				}
+				continue;
+			}
+
+			int ItemSize = pOther->GetItemSize(i);
+			int *pHeader = pData;
+			*pData++ = pItem->Type();
+			*pData++ = pItem->ID();
+			if(!pItemSizes[pItem->Type()])
+				*pData++ = ItemSize/4;
+
+			if(Index != -1)
+			{
+				int Needed = 0;
+				for(int b = 0; b < ItemSize/4; b++)
+				{
+					pData[b] = pItem->Data()[b]-pHashed->GetItem(Index)->Data()[b];
+					Needed |= pData[b];
+				}
+				if(!Needed)
+				{
+					pData = pHeader;
+					continue;
+				}
+			}
+			else
+				mem_copy(pData, pItem->Data(), ItemSize);
+			pData += ItemSize/4;
+			pDelta->m_NumUpdateItems++;
+		}
+	}
+
+	if(!pDelta->m_NumDeletedItems && !pDelta->m_NumUpdateItems && !pDelta->m_NumTempItems)
+		return 0;
+	return (int)((char *)pData-(char *)pDstData);
+}
+
+// the nested scan CSnapshotDelta::UnpackDelta used to do
+static int ReferenceUnpackDelta(const short *pItemSizes, const CSnapshot *pFrom, CSnapshot *pTo, const void *pSrcData, int DataSize)
+{
+	static CSnapshotBuilder s_Builder;
+	const CSnapshotDelta::CData *pDelta = (const CSnapshotDelta::CData *)pSrcData;
+	const int *pData = (const int *)pDelta->m_pData;
+	const int *pEnd = (const int *)((const char *)pSrcData + DataSize);
+
+	s_Builder.Init();
+
+	const int *pDeleted = pData;
+	pData += pDelta->m_NumDeletedItems;
+	if(pData > pEnd)
+		return -1;
+
+	for(int i = 0; i < pFrom->NumItems(); i++)
+	{
+		const CSnapshotItem *pFromItem = pFrom->GetItem(i);
+		int ItemSize = pFrom->GetItemSize(i);
+		bool Keep = true;
+		for(int d = 0; d < pDelta->m_NumDeletedItems; d++)
+			if(pDeleted[d] == pFromItem->Key())
+			{
+				Keep = false;
+				break;
+			}
+		if(Keep)
+			mem_copy(s_Builder.NewItem(pFromItem->Type(), pFromItem->ID(), ItemSize), pFromItem->Data(), ItemSize);
+	}
+
+	for(int i = 0; i < pDelta->m_NumUpdateItems; i++)
+	{
+		if(pData+2 > pEnd)
+			return -1;
+		int Type = *pData++;
+		if(Type < 0)
+			return -1;
+		int ID = *pData++;
+		int ItemSize;
+		if(pItemSizes[Type])
+			ItemSize = pItemSizes[Type];
+		else
+		{
+			if(pData+1 > pEnd)
+				return -2;
+			ItemSize = (*pData++) * 4;
+		}
+		if((const char *)pData + ItemSize > (const char *)pEnd || ItemSize < 0)
+			return -3;
+
+		int Key = (Type<<16)|(ID&0xffff);
+		int *pNewData = s_Builder.GetItemData(Key);
+		if(!pNewData)
+			pNewData = (int *)s_Builder.NewItem(Key>>16, Key&0xffff, ItemSize);
+
+		int FromIndex = pFrom->GetItemIndex(Key);
+		if(FromIndex != -1)
+		{
+			const int *pPast = pFrom->GetItem(FromIndex)->Data();
+			for(int b = 0; b < ItemSize/4; b++)
+				pNewData[b] = pPast[b]+pData[b];
+		}
+		else
+			mem_copy(pNewData, pData, ItemSize);
+		pData += ItemSize/4;
+	}
+
+	return s_Builder.Finish(pTo);
+}
+
+static void CreateSnapshot(CSnapshotTestRandom *pRandom, CSnapshotBuilder *pBuilder, int NumItems)
+{
+	pBuilder->Init();
+	for(int i = 0; i < NumItems; i++)
+	{
+		int Type = 1+pRandom->Next(NUM_TYPES-1);
+		int ID = pRandom->Next(64);
+		int Key = (Type<<16)|ID;
+		if(pBuilder->GetItemData(Key))
+			continue;
+		int *pData = (int *)pBuilder->NewItem(Type, ID, s_aItemSizes[Type]);
+		for(int b = 0; b < s_aItemSizes[Type]/4; b++)
+			pData[b] = pRandom->Next(8)-4;
+	}
+}
+
+// keeps some items, changes some, drops some and adds new ones
+static void MutateSnapshot(CSnapshotTestRandom *pRandom, const CSnapshot *pFrom, CSnapshotBuilder *pBuilder)
+{
+	pBuilder->Init();
+	for(int i = 0; i < pFrom->NumItems(); i++)
+	{
+		const CSnapshotItem *pItem = pFrom->GetItem(i);
+		int Action = pRandom->Next(4);
+		if(Action == 0)
+			continue;
+
+		int Size = pFrom->GetItemSize(i);
+		int *pData = (int *)pBuilder->NewItem(pItem->Type(), pItem->ID(), Size);
+		mem_copy(pData, pItem->Data(), Size);
+		if(Action == 1 && Size)
+			pData[pRandom->Next(Size/4)] += pRandom->Next(100)-50;
+	}
+
+	for(int i = pRandom->Next(20); i > 0; i--)
+	{
+		int Type = 1+pRandom->Next(NUM_TYPES-1);
+		int ID = pRandom->Next(64);
+		if(pBuilder->GetItemData((Type<<16)|ID))
+			continue;
+		int *pData = (int *)pBuilder->NewItem(Type, ID, s_aItemSizes[Type]);
+		for(int b = 0; b < s_aItemSizes[Type]/4; b++)
+			pData[b] = pRandom->Next(1000);
+	}
+}
+
+// a delta that CreateDelta would never produce: unsorted deletes and repeated updates
+static int CreateUnorderedDelta(CSnapshotTestRandom *pRandom, const short *pItemSizes, const CSnapshot *pFrom, void *pDstData)
+{
+	CSnapshotDelta::CData *pDelta = (CSnapshotDelta::CData *)pDstData;
+	int *pData = (int *)pDelta->m_pData;
+	pDelta->m_NumDeletedItems = pRandom->Next(8);
+	pDelta->m_NumUpdateItems = pRandom->Next(24);
+	pDelta->m_NumTempItems = 0;
+
+	for(int i = 0; i < pDelta->m_NumDeletedItems; i++)
+	{
+		if(pFrom->NumItems() && pRandom->Next(4))
+			*pData++ = pFrom->GetItem(pRandom->Next(pFrom->NumItems()))->Key();
+		else
+			*pData++ = ((1+pRandom->Next(NUM_TYPES-1))<<16)|pRandom->Next(64);
+	}
+
+	for(int i = 0; i < pDelta->m_NumUpdateItems; i++)
+	{
+		int Type = 1+pRandom->Next(NUM_TYPES-1);
+		*pData++ = Type;
+		*pData++ = pRandom->Next(16);
+		if(!pItemSizes[Type])
+			*pData++ = s_aItemSizes[Type]/4;
+		for(int b = 0; b < s_aItemSizes[Type]/4; b++)
+			*pData++ = pRandom->Next(100)-50;
+	}
+
+	return (int)((char *)pData-(char *)pDstData);
+}
+
+TEST(Snapshot, CreateDeltaMatchesReference)
+{
+	static CSnapshotDelta s_Delta;
+	static CSnapshotBuilder s_Builder;
+	static char s_aFrom[CSnapshot::MAX_SIZE];
+	static char s_aTo[CSnapshot::MAX_SIZE];
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	static char s_aReference[CSnapshot::MAX_SIZE];
+
+	short aStaticSizes[64] = {0};
+	for(int Type = 1; Type < NUM_TYPES; Type += 2)
+	{
+		aStaticSizes[Type] = s_aItemSizes[Type];
+		s_Delta.SetStaticsize(Type, s_aItemSizes[Type]);
+	}
+
+	CSnapshotTestRandom Random(1234);
+	for(int Run = 0; Run < 200; Run++)
+	{
+		CSnapshot *pFrom = (CSnapshot *)s_aFrom;
+		CSnapshot *pTo = (CSnapshot *)s_aTo;
+
+		CreateSnapshot(&Random, &s_Builder, Random.Next(120));
+		s_Builder.Finish(pFrom);
+		MutateSnapshot(&Random, pFrom, &s_Builder);
+		s_Builder.Finish(pTo);
+
+		int Size = s_Delta.CreateDelta(pFrom, pTo, s_aDelta);
+		int ReferenceSize = ReferenceCreateDelta(aStaticSizes, pFrom, pTo, s_aReference);
+		ASSERT_EQ(ReferenceSize, Size);
+		EXPECT_EQ(mem_comp(s_aReference, s_aDelta, Size), 0);
+	}
+}
+
+TEST(Snapshot, UnpackDeltaMatchesReference)
+{
+	static CSnapshotDelta s_Delta;
+	static CSnapshotBuilder s_Builder;
+	static char s_aFrom[CSnapshot::MAX_SIZE];
+	static char s_aTo[CSnapshot::MAX_SIZE];
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	static char s_aUnpacked[CSnapshot::MAX_SIZE];
+	static char s_aReference[CSnapshot::MAX_SIZE];
+
+	short aStaticSizes[64] = {0};
+	for(int Type = 1; Type < NUM_TYPES; Type += 2)
+	{
+		aStaticSizes[Type] = s_aItemSizes[Type];
+		s_Delta.SetStaticsize(Type, s_aItemSizes[Type]);
+	}
+
+	CSnapshotTestRandom Random(4321);
+	for(int Run = 0; Run < 300; Run++)
+	{
+		CSnapshot *pFrom = (CSnapshot *)s_aFrom;
+		CSnapshot *pTo = (CSnapshot *)s_aTo;
+
+		CreateSnapshot(&Random, &s_Builder, Random.Next(120));
+		s_Builder.Finish(pFrom);
+
+		int DeltaSize, ToSize = 0;
+		if(Run%3 == 2)
+			DeltaSize = CreateUnorderedDelta(&Random, aStaticSizes, pFrom, s_aDelta);
+		else
+		{
+			MutateSnapshot(&Random, pFrom, &s_Builder);
+			ToSize = s_Builder.Finish(pTo);
+			DeltaSize = s_Delta.CreateDelta(pFrom, pTo, s_aDelta);
+			if(!DeltaSize)
+				continue;
+		}
+
+		// cut some of them short to hit the error paths
+		if(Run%7 == 6)
+			DeltaSize = Random.Next(DeltaSize);
+
+		mem_zero(s_aUnpacked, sizeof(s_aUnpacked));
+		mem_zero(s_aReference, sizeof(s_aReference));
+		int Size = s_Delta.UnpackDelta(pFrom, (CSnapshot *)s_aUnpacked, s_aDelta, DeltaSize);
+		int ReferenceSize = ReferenceUnpackDelta(aStaticSizes, pFrom, (CSnapshot *)s_aReference, s_aDelta, DeltaSize);
+		ASSERT_EQ(ReferenceSize, Size);
+		if(Size > 0)
+		{
+			EXPECT_EQ(mem_comp(s_aReference, s_aUnpacked, Size), 0);
+		}
+		if(Run%3 != 2 && Run%7 != 6)
+		{
+			ASSERT_EQ(ToSize, Size);
+			EXPECT_EQ(mem_comp(pTo, s_aUnpacked, Size), 0);
+		}
+	}
+}
+
+TEST(Snapshot, RingSharesIdenticalSnapshots)
+{
+	static CSnapshotBuilder s_Builder;
+	static char s_aSnap[3][CSnapshot::MAX_SIZE];
+	int aSize[3];
+
+	CSnapshotTestRandom Random(99);
+	for(int i = 0; i < 3; i++)
+	{
+		CreateSnapshot(&Random, &s_Builder, 10+i*10);
+		aSize[i] = s_Builder.Finish(s_aSnap[i]);
+	}
+
+	CSnapshotPool Pool;
+	Pool.Init(CSnapshot::MAX_SIZE, 64);
+	CSnapshotRing aRings[3];
+	for(int i = 0; i < 3; i++)
+		aRings[i].Init(&Pool);
+
+	// the first two rings get the same snapshot
+	CSnapshot *pFirst = aRings[0].Add(10, 100, aSize[0], s_aSnap[0]);
+	CSnapshot *pSecond = aRings[1].Add(10, 200, aSize[0], s_aSnap[0]);
+	CSnapshot *pThird = aRings[2].Add(10, 300, aSize[1], s_aSnap[1]);
+	EXPECT_EQ(pFirst, pSecond);
+	EXPECT_NE(pFirst, pThird);
+	EXPECT_EQ(Pool.NumEntries(), 2);
+	EXPECT_EQ(mem_comp(pFirst, s_aSnap[0], aSize[0]), 0);
+	EXPECT_EQ(mem_comp(pThird, s_aSnap[1], aSize[1]), 0);
+
+	int64 Tagtime;
+	CSnapshot *pSnap;
+	EXPECT_EQ(aRings[1].Get(10, &Tagtime, &pSnap), aSize[0]);
+	EXPECT_EQ(Tagtime, 200);
+	EXPECT_EQ(pSnap, pFirst);
+	EXPECT_EQ(aRings[1].Get(11, 0, 0), -1);
+	EXPECT_EQ(aRings[1].Get(-1, 0, 0), -1);
+
+	// the shared entry stays until every ring let go of it
+	aRings[0].Add(12, 0, aSize[2], s_aSnap[2]);
+	aRings[0].PurgeUntil(11);
+	EXPECT_EQ(aRings[0].Get(10, 0, 0), -1);
+	EXPECT_EQ(aRings[1].Get(10, 0, &pSnap), aSize[0]);
+	EXPECT_EQ(mem_comp(pSnap, s_aSnap[0], aSize[0]), 0);
+	aRings[1].PurgeAll();
+	aRings[2].PurgeAll();
+	EXPECT_EQ(Pool.NumEntries(), 1);
+	EXPECT_EQ(aRings[0].Get(12, 0, &pSnap), aSize[2]);
+	EXPECT_EQ(mem_comp(pSnap, s_aSnap[2], aSize[2]), 0);
+
+	// a ring only keeps MAX_TICKS worth of history
+	aRings[0].Add(12+CSnapshotRing::MAX_TICKS, 0, aSize[1], s_aSnap[1]);
+	EXPECT_EQ(aRings[0].Get(12, 0, 0), -1);
+	EXPECT_EQ(Pool.NumEntries(), 1);
+}
+
+TEST(Snapshot, RingDropsOldestWhenPoolIsFull)
+{
+	static CSnapshotBuilder s_Builder;
+	static char s_aSnap[CSnapshot::MAX_SIZE];
+
+	CSnapshotPool Pool;
+	Pool.Init(CSnapshot::MAX_SIZE, 8);
+	CSnapshotRing Ring;
+	Ring.Init(&Pool);
+
+	CSnapshotTestRandom Random(7);
+	int LastSize = 0;
+	for(int Tick = 0; Tick < 100; Tick++)
+	{
+		CreateSnapshot(&Random, &s_Builder, 60);
+		LastSize = s_Builder.Finish(s_aSnap);
+		CSnapshot *pSnap = Ring.Add(Tick, Tick, LastSize, s_aSnap);
+		ASSERT_TRUE(pSnap != 0);
+		EXPECT_EQ(mem_comp(pSnap, s_aSnap, LastSize), 0);
+		EXPECT_LE(Pool.NumEntries(), 8);
+	}
+
+	// old ticks got dropped, the newest is still there
+	EXPECT_EQ(Ring.Get(0, 0, 0), -1);
+	EXPECT_EQ(Ring.Get(99, 0, 0), LastSize);
+}
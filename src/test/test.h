@@ -6,4 +6,15 @@ public:
 	CTestInfo();
 	char m_aFilename[64];
 };
+
+// xorshift, the same sequence on every platform for the same seed
+class CTestRandom
+{
+	unsigned m_State;
+public:
+	CTestRandom(unsigned Seed) : m_State(Seed) {}
+	unsigned Next() { m_State ^= m_State<<13; m_State ^= m_State>>17; m_State ^= m_State<<5; return m_State; }
+	int Int(int Max) { return Next()%Max; }
+	float Float(float Min, float Max) { return Min+(Max-Min)*(Next()%1000001)/1000000.0f; }
+};
 #endif // TEST_TEST_H
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+
+static const int BATCH_SIZE = 64;
+static const int PACKET_SIZE = 128;
+
+// binds a socket on localhost, the port is returned in pAddr
+static NETSOCKET OpenLoopback(NETADDR *pAddr)
+{
+	mem_zero(pAddr, sizeof(*pAddr));
+	pAddr->type = NETTYPE_IPV4;
+	pAddr->ip[0] = 127;
+	pAddr->ip[3] = 1;
+	for(pAddr->port = 29300; pAddr->port < 29400; pAddr->port++)
+	{
+		NETSOCKET Socket = net_udp_create(*pAddr, 0);
+		if(Socket.type != NETTYPE_INVALID)
+			return Socket;
+	}
+	NETSOCKET Invalid = {NETTYPE_INVALID, -1, -1};
+	return Invalid;
+}
+
+class CLoopback
+{
+public:
+	NETSOCKET m_Socket;
+	NETADDR m_Addr;
+	NETDATAGRAM m_aDatagrams[BATCH_SIZE];
+	unsigned char m_aaData[BATCH_SIZE][PACKET_SIZE];
+
+	CLoopback()
+	{
+		m_Socket = OpenLoopback(&m_Addr);
+		for(int i = 0; i < BATCH_SIZE; i++)
+		{
+			m_aDatagrams[i].addr = m_Addr;
+			m_aDatagrams[i].data = m_aaData[i];
+			m_aDatagrams[i].size = PACKET_SIZE;
+		}
+	}
+	~CLoopback() { net_udp_close(m_Socket); }
+};
+
+TEST(Udp, BatchRoundtrip)
+{
+	CLoopback Loopback;
+	ASSERT_NE(Loopback.m_Socket.type, NETTYPE_INVALID);
+
+	for(int i = 0; i < BATCH_SIZE; i++)
+	{
+		Loopback.m_aDatagrams[i].size = 1+i;
+		mem_zero(Loopback.m_aaData[i], PACKET_SIZE);
+		Loopback.m_aaData[i][0] = i;
+	}
+	EXPECT_EQ(net_udp_send_batch(Loopback.m_Socket, Loopback.m_aDatagrams, BATCH_SIZE), BATCH_SIZE);
+
+	NETDATAGRAM aRecv[BATCH_SIZE];
+	unsigned char aaRecvData[BATCH_SIZE][PACKET_SIZE];
+	for(int i = 0; i < BATCH_SIZE; i++)
+		aRecv[i].data = aaRecvData[i];
+
+	int Received = 0;
+	for(int Tries = 0; Received < BATCH_SIZE && Tries < 100; Tries++)
+	{
+		Received += net_udp_recv_batch(Loopback.m_Socket, aRecv+Received, BATCH_SIZE-Received, PACKET_SIZE);
+		if(Received < BATCH_SIZE)
+			thread_sleep(1);
+	}
+	ASSERT_EQ(Received, BATCH_SIZE);
+
+	for(int i = 0; i < BATCH_SIZE; i++)
+	{
+		EXPECT_EQ(aRecv[i].size, 1+i);
+		EXPECT_EQ(aaRecvData[i][0], i);
+		EXPECT_EQ(net_addr_comp(&aRecv[i].addr, &Loopback.m_Addr), 0);
+	}
+
+	// nothing left
+	EXPECT_EQ(net_udp_recv_batch(Loopback.m_Socket, aRecv, BATCH_SIZE, PACKET_SIZE), 0);
+}
@@ -0,0 +1,274 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/console.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <game/collision.h>
+#include <game/layers.h>
+#include <game/prediction.h>
+#include <game/version.h>
+#include <generated/protocol.h>
+
+/*
+	Replays the snapshots of a demo and predicts the characters on them
+	the way the client does: the prediction runs whenever the predicted
+	tick advances and whenever a snapshot arrives. Every prediction is
+	done twice, once simulating all ticks from the snapshot and once
+	continuing the predicted world of the last one. Reports the CPU time
+	both take per call and per frame, and fails if their results differ.
+
+	The local player gets random input that stays the same for a tick.
+*/
+
+struct CBenchState
+{
+	CNetObj_Character m_aCharacters[MAX_CLIENTS];
+	bool m_aActive[MAX_CLIENTS];
+	int m_NumSnaps;
+};
+
+class CSnapshotListener : public CDemoPlayer::IListner
+{
+public:
+	CBenchState *m_pState;
+
+	virtual void OnDemoPlayerSnapshot(void *pData, int Size)
+	{
+		const CSnapshot *pSnap = (const CSnapshot *)pData;
+		mem_zero(m_pState->m_aActive, sizeof(m_pState->m_aActive));
+		for(int i = 0; i < pSnap->NumItems(); i++)
+		{
+			const CSnapshotItem *pItem = pSnap->GetItem(i);
+			if(pItem->Type() != NETOBJTYPE_CHARACTER || pItem->ID() < 0 || pItem->ID() >= MAX_CLIENTS)
+				continue;
+			if(pSnap->GetItemSize(i) < (int)sizeof(CNetObj_Character))
+				continue;
+			mem_copy(&m_pState->m_aCharacters[pItem->ID()], pItem->Data(), sizeof(CNetObj_Character));
+			m_pState->m_aActive[pItem->ID()] = true;
+		}
+		m_pState->m_NumSnaps++;
+	}
+
+	virtual void OnDemoPlayerMessage(void *pData, int Size) {}
+};
+
+static const int *GetInput(int Tick, void *pUser)
+{
+	static CNetObj_PlayerInput s_Input;
+	unsigned Seed = (unsigned)Tick*2654435761u+*(unsigned *)pUser;
+	Seed ^= Seed>>15;
+	Seed *= 2246822519u;
+	Seed ^= Seed>>13;
+
+	mem_zero(&s_Input, sizeof(s_Input));
+	s_Input.m_Direction = (int)(Seed%3)-1;
+	s_Input.m_TargetX = (int)((Seed>>2)%400)-200;
+	s_Input.m_TargetY = (int)((Seed>>11)%400)-200;
+	s_Input.m_Jump = ((Seed>>20)%8) == 0;
+	s_Input.m_Hook = ((Seed>>24)%4) != 0;
+	s_Input.m_Fire = (Tick/10)&INPUT_STATE_MASK;
+	return (const int *)&s_Input;
+}
+
+struct CRunStats
+{
+	int64 m_Time;
+	int64 m_MaxTime;
+};
+
+static void Predict(CPrediction *pPrediction, int SnapTick, int PredTick, const CNetObj_CharacterCore *const *ppSnapCores,
+	const CTuningParams *pTuning, int LocalClientID, unsigned *pSeed, CRunStats *pStats)
+{
+	int64 Start = time_get();
+	for(int Tick = pPrediction->Begin(SnapTick, PredTick, ppSnapCores, pTuning, LocalClientID, GetInput, pSeed)+1; Tick <= PredTick; Tick++)
+		pPrediction->Tick(GetInput(Tick, pSeed));
+	int64 Time = time_get()-Start;
+	pStats->m_Time += Time;
+	pStats->m_MaxTime = max(pStats->m_MaxTime, Time);
+}
+
+static bool SameWorld(CPrediction *pA, CPrediction *pB)
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		CCharacterCore *pCoreA = pA->Character(i), *pCoreB = pB->Character(i);
+		if(!pCoreA != !pCoreB)
+			return false;
+		if(!pCoreA)
+			continue;
+
+		CNetObj_CharacterCore A = {0}, B = {0};
+		pCoreA->Write(&A);
+		pCoreB->Write(&B);
+		if(mem_comp(&A, &B, sizeof(A)) != 0)
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	const char *pDemo = 0;
+	int Ping = 6;
+	int SnapRate = 2;
+	int Fps = 144;
+	int LocalClientID = -1;
+	unsigned Seed = 1;
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-p") == 0 && i+1 < argc) // ignore_convention
+			Ping = clamp(str_toint(argv[++i]), 1, 49); // ignore_convention
+		else if(str_comp(argv[i], "-r") == 0 && i+1 < argc) // ignore_convention
+			SnapRate = clamp(str_toint(argv[++i]), 1, 10); // ignore_convention
+		else if(str_comp(argv[i], "-f") == 0 && i+1 < argc) // ignore_convention
+			Fps = max(str_toint(argv[++i]), 1); // ignore_convention
+		else if(str_comp(argv[i], "-l") == 0 && i+1 < argc) // ignore_convention
+			LocalClientID = clamp(str_toint(argv[++i]), 0, MAX_CLIENTS-1); // ignore_convention
+		else if(str_comp(argv[i], "-s") == 0 && i+1 < argc) // ignore_convention
+			Seed = str_toint(argv[++i]); // ignore_convention
+		else
+			pDemo = argv[i]; // ignore_convention
+	}
+
+	if(!pDemo)
+	{
+		dbg_msg("bench_predict", "usage: bench_predict [-p ping ticks] [-r snap rate] [-f fps] [-l local client id] [-s seed] <demo>");
+		return -1;
+	}
+
+	CNetBase::Init();
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_CLIENT, argc, argv);
+	IConsole *pConsole = CreateConsole(CFGFLAG_CLIENT);
+	IEngineMap *pMap = CreateEngineMap();
+	if(!pStorage || !pConsole || !pMap)
+		return -1;
+
+	CSnapshotDelta SnapshotDelta;
+	CNetObjHandler NetObjHandler;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		SnapshotDelta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+
+	CBenchState State;
+	mem_zero(&State, sizeof(State));
+	CSnapshotListener Listener;
+	Listener.m_pState = &State;
+
+	CDemoPlayer DemoPlayer(&SnapshotDelta);
+	DemoPlayer.SetListner(&Listener);
+	if(DemoPlayer.Load(pStorage, pConsole, pDemo, IStorage::TYPE_ALL, GAME_NETVERSION))
+		return -1;
+
+	// the demo player keeps the map next to the downloaded ones
+	const CDemoHeader *pHeader = &DemoPlayer.Info()->m_Header;
+	unsigned MapCrc = (pHeader->m_aMapCrc[0]<<24) | (pHeader->m_aMapCrc[1]<<16) | (pHeader->m_aMapCrc[2]<<8) | (pHeader->m_aMapCrc[3]);
+	char aMapFilename[128];
+	str_format(aMapFilename, sizeof(aMapFilename), "downloadedmaps/%s_%08x.map", pHeader->m_aMapName, MapCrc);
+	if(!pMap->Load(aMapFilename, pStorage))
+	{
+		str_format(aMapFilename, sizeof(aMapFilename), "maps/%s.map", pHeader->m_aMapName);
+		if(!pMap->Load(aMapFilename, pStorage))
+		{
+			dbg_msg("bench_predict", "could not load map '%s'", pHeader->m_aMapName);
+			return -1;
+		}
+	}
+
+	CLayers Layers;
+	Layers.Init(0, pMap);
+	CCollision Collision;
+	Collision.Init(&Layers);
+
+	CTuningParams Tuning;
+	CPrediction Full, Cached;
+	Full.Init(&Collision);
+	Cached.Init(&Collision);
+	CRunStats FullStats = {0, 0}, CachedStats = {0, 0};
+
+	int NumTicks = 0;
+	int NumCalls = 0;
+	int NumMismatches = 0;
+	int SnapTick = -1;
+	CNetObj_Character aSnapCharacters[MAX_CLIENTS];
+	const CNetObj_CharacterCore *apSnapCores[MAX_CLIENTS];
+	mem_zero(apSnapCores, sizeof(apSnapCores));
+
+	DemoPlayer.Play();
+	while(DemoPlayer.IsPlaying() && !DemoPlayer.BaseInfo()->m_Paused)
+	{
+		int Tick = DemoPlayer.BaseInfo()->m_CurrentTick;
+		for(int Step = 0; Step < 2; Step++)
+		{
+			if(Step == 1)
+			{
+				// a snapshot arrives, the prediction starts over from it
+				if(Tick%SnapRate != 0)
+					break;
+				SnapTick = Tick;
+				for(int i = 0; i < MAX_CLIENTS; i++)
+				{
+					aSnapCharacters[i] = State.m_aCharacters[i];
+					apSnapCores[i] = State.m_aActive[i] ? &aSnapCharacters[i] : 0;
+				}
+				if(LocalClientID == -1)
+				{
+					for(int i = 0; i < MAX_CLIENTS && LocalClientID == -1; i++)
+						if(apSnapCores[i])
+							LocalClientID = i;
+				}
+				Cached.Reset();
+			}
+
+			if(SnapTick == -1 || LocalClientID == -1 || !apSnapCores[LocalClientID])
+				continue;
+
+			// the predicted tick runs ahead of the snapshot by the ping
+			int PredTick = Tick+Ping;
+			if(PredTick <= SnapTick || PredTick >= SnapTick+50)
+				continue;
+
+			Full.Reset();
+			Predict(&Full, SnapTick, PredTick, apSnapCores, &Tuning, LocalClientID, &Seed, &FullStats);
+			Predict(&Cached, SnapTick, PredTick, apSnapCores, &Tuning, LocalClientID, &Seed, &CachedStats);
+			if(!SameWorld(&Full, &Cached))
+				NumMismatches++;
+			NumCalls++;
+		}
+
+		NumTicks++;
+		DemoPlayer.NextFrame();
+	}
+
+	if(!NumCalls)
+	{
+		dbg_msg("bench_predict", "no character to predict in %d ticks, %d snapshots", NumTicks, State.m_NumSnaps);
+		return -1;
+	}
+
+	// the client runs the prediction 50 times a second plus once per snapshot, every frame pays its share
+	int64 NumFrames = max((int64)NumTicks*Fps/SERVER_TICK_SPEED, (int64)1);
+	int64 Freq = time_freq();
+	dbg_msg("bench_predict", "%d ticks, %d predictions, local client %d, ping %d ticks, snapshot every %d ticks",
+		NumTicks, NumCalls, LocalClientID, Ping, SnapRate);
+	dbg_msg("bench_predict", "full:   %lld ticks simulated, %.2fus per prediction (max %.2fus), %.2fus per frame at %d fps",
+		Full.NumSimulatedTicks(), FullStats.m_Time*1000000.0/Freq/NumCalls, FullStats.m_MaxTime*1000000.0/Freq,
+		FullStats.m_Time*1000000.0/Freq/NumFrames, Fps);
+	dbg_msg("bench_predict", "cached: %lld ticks simulated, %lld reused, %.2fus per prediction (max %.2fus), %.2fus per frame at %d fps",
+		Cached.NumSimulatedTicks(), Cached.NumReusedTicks(), CachedStats.m_Time*1000000.0/Freq/NumCalls, CachedStats.m_MaxTime*1000000.0/Freq,
+		CachedStats.m_Time*1000000.0/Freq/NumFrames, Fps);
+	dbg_msg("bench_predict", "saved %.2fus per frame", (FullStats.m_Time-CachedStats.m_Time)*1000000.0/Freq/NumFrames);
+
+	if(NumMismatches)
+	{
+		dbg_msg("bench_predict", "the cached prediction differs in %d of %d predictions", NumMismatches, NumCalls);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,94 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/client.h>
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/editor.h>
+#include <engine/engine.h>
+#include <engine/input.h>
+#include <engine/map.h>
+#include <engine/masterserver.h>
+#include <engine/serverbrowser.h>
+#include <engine/sound.h>
+#include <engine/storage.h>
+#include <engine/textrender.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/mapchecker.h>
+#include <engine/shared/network.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+#include <engine/client/contacts.h>
+#include <engine/client/serverbrowser.h>
+#include <engine/client/client.h>
+
+/*
+	Plays a demo through the client and its game components as fast as
+	it goes, every frame advances the demo by the same time. The frames
+	go to a graphics backend that only counts the commands it gets, so
+	the bench runs without a window or a GPU and measures the CPU side
+	of the rendering alone: the time each component spends in OnRender,
+	and the commands, draw calls, vertices and state changes per frame.
+
+	The client runs with the default settings. Arguments after the demo
+	are executed as console commands, "gfx_tile_buffers 0" for example.
+	With -o every command goes into a file, to diff two builds.
+*/
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	const char *pDemo = 0;
+	const char *pDumpFilename = 0;
+	int Fps = 60;
+	const char *apCommands[64];
+	int NumCommands = 0;
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-f") == 0 && i+1 < argc) // ignore_convention
+			Fps = clamp(str_toint(argv[++i]), 1, 1000); // ignore_convention
+		else if(str_comp(argv[i], "-o") == 0 && i+1 < argc) // ignore_convention
+			pDumpFilename = argv[++i]; // ignore_convention
+		else if(!pDemo)
+			pDemo = argv[i]; // ignore_convention
+		else if(NumCommands < (int)(sizeof(apCommands)/sizeof(apCommands[0])))
+			apCommands[NumCommands++] = argv[i]; // ignore_convention
+	}
+
+	if(!pDemo)
+	{
+		dbg_msg("bench_render", "usage: bench_render [-f fps] [-o command dump] <demo> [console commands]");
+		return -1;
+	}
+
+	CClient *pClient = CreateClient();
+	IKernel *pKernel = IKernel::Create();
+	if(!pClient->CreateInterfaces(pKernel, argc, argv, false)) // ignore_convention
+		return -1;
+
+	int FlagMask = CFGFLAG_CLIENT;
+	IEngine *pEngine = pKernel->RequestInterface<IEngine>();
+	IConsole *pConsole = pKernel->RequestInterface<IConsole>();
+	IConfig *pConfig = pKernel->RequestInterface<IConfig>();
+
+	pEngine->Init();
+	pConfig->Init(FlagMask);
+	pClient->RegisterCommands();
+	pClient->InitInterfaces();
+	pKernel->RequestInterface<IGameClient>()->OnConsoleInit();
+
+	if(NumCommands)
+		pConsole->ParseArguments(NumCommands, apCommands);
+	pConfig->RestoreStrings();
+
+	int Ret = pClient->RunBenchmark(pDemo, Fps, pDumpFilename);
+
+	pClient->DestroyInterfaces();
+	mem_free(pClient);
+	delete pKernel;
+
+	return Ret;
+}
@@ -0,0 +1,152 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <math.h>
+#include <stdlib.h> // srand
+
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/map.h>
+#include <engine/masterserver.h>
+#include <engine/server.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/econ.h>
+#include <engine/shared/jobs.h>
+#include <engine/shared/mapchecker.h>
+#include <engine/shared/netban.h>
+#include <engine/shared/network.h>
+#include <engine/shared/profiler.h>
+#include <engine/shared/snapshot.h>
+#include <engine/server/register.h>
+#include <engine/server/server.h>
+#include <game/server/alloc.h>
+#include <generated/protocol.h>
+
+/*
+	Runs the game server on a map without network and as fast as it
+	goes, with bots in the first slots that run around, jump, hook,
+	switch weapons and shoot. The bots' input only depends on the seed,
+	the game's randomness gets seeded with it too, so two runs with the
+	same arguments play the same game.
+
+	Arguments that are not options are executed as console commands,
+	"sv_map" picks the map. With -w all bots stick to one weapon.
+*/
+
+struct CBotSetup
+{
+	unsigned m_Seed;
+	int m_Weapon;
+};
+
+static unsigned Hash(unsigned Seed, int ClientID, int Step)
+{
+	unsigned h = Seed*2654435761u+(unsigned)ClientID*2246822519u+(unsigned)Step*3266489917u;
+	h ^= h>>15;
+	h *= 2246822519u;
+	h ^= h>>13;
+	h *= 3266489917u;
+	h ^= h>>16;
+	return h;
+}
+
+static void BotInput(int ClientID, int Tick, int *pInput, void *pUser)
+{
+	const CBotSetup *pSetup = (const CBotSetup *)pUser;
+	unsigned Seed = pSetup->m_Seed;
+	CNetObj_PlayerInput *pPlayerInput = (CNetObj_PlayerInput *)pInput;
+
+	// every bot keeps its mind for a while, each at its own pace
+	int Phase = Hash(Seed, ClientID, -1)%50;
+	unsigned Move = Hash(Seed, ClientID, (Tick+Phase)/25);
+	unsigned Aim = Hash(Seed, ClientID, (Tick+Phase)/10+1000000);
+	unsigned Weapon = Hash(Seed, ClientID, (Tick+Phase)/150+2000000);
+
+	pPlayerInput->m_Direction = (int)(Move%3)-1;
+	pPlayerInput->m_Jump = ((Move>>2)%4) == 0 && (Tick+Phase)%25 < 5;
+	pPlayerInput->m_Hook = ((Move>>4)%3) == 0;
+	float Angle = (Aim%360)*pi/180.0f;
+	pPlayerInput->m_TargetX = (int)(cosf(Angle)*200.0f);
+	pPlayerInput->m_TargetY = (int)(sinf(Angle)*200.0f);
+	pPlayerInput->m_Fire = ((Tick+Phase)/5)&INPUT_STATE_MASK;
+	pPlayerInput->m_WantedWeapon = 1+(pSetup->m_Weapon == -1 ? Weapon%NUM_WEAPONS : pSetup->m_Weapon);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumBots = 16;
+	int NumTicks = SERVER_TICK_SPEED*60;
+	CBotSetup Setup;
+	Setup.m_Seed = 1;
+	Setup.m_Weapon = -1;
+	const char *apCommands[64];
+	int NumCommands = 0;
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-n") == 0 && i+1 < argc) // ignore_convention
+			NumBots = clamp(str_toint(argv[++i]), 1, (int)MAX_CLIENTS); // ignore_convention
+		else if(str_comp(argv[i], "-t") == 0 && i+1 < argc) // ignore_convention
+			NumTicks = max(str_toint(argv[++i]), 1); // ignore_convention
+		else if(str_comp(argv[i], "-s") == 0 && i+1 < argc) // ignore_convention
+			Setup.m_Seed = str_toint(argv[++i]); // ignore_convention
+		else if(str_comp(argv[i], "-w") == 0 && i+1 < argc) // ignore_convention
+			Setup.m_Weapon = clamp(str_toint(argv[++i]), -1, NUM_WEAPONS-1); // ignore_convention
+		else if(NumCommands < (int)(sizeof(apCommands)/sizeof(apCommands[0])))
+			apCommands[NumCommands++] = argv[i]; // ignore_convention
+	}
+
+	CServer *pServer = new CServer();
+	IKernel *pKernel = IKernel::Create();
+	IEngineMap *pEngineMap = CreateEngineMap();
+	IGameServer *pGameServer = CreateGameServer();
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER|CFGFLAG_ECON);
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_SERVER, argc, argv); // ignore_convention
+	IConfig *pConfig = CreateConfig();
+
+	{
+		bool RegisterFail = false;
+
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pServer);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IEngineMap*>(pEngineMap)); // register as both
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(static_cast<IMap*>(pEngineMap));
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pGameServer);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConsole);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pStorage);
+		RegisterFail = RegisterFail || !pKernel->RegisterInterface(pConfig);
+
+		if(RegisterFail)
+			return -1;
+	}
+
+	pConfig->Init(CFGFLAG_SERVER|CFGFLAG_ECON);
+	pServer->RegisterCommands();
+	g_Config.m_SvPlayerSlots = NumBots; // all bots play
+	if(NumCommands)
+		pConsole->ParseArguments(NumCommands, apCommands);
+	pConfig->RestoreStrings();
+
+	// the game uses rand() for spawns and teams
+	srand(Setup.m_Seed);
+
+	dbg_msg("bench", "seed %u", Setup.m_Seed);
+	int Ret = pServer->RunBenchmark(NumBots, NumTicks, BotInput, &Setup);
+
+	// the pools have to be empty again after the shutdown
+	for(const CPool *pPool = CPool::First(); pPool; pPool = pPool->Next())
+		dbg_msg("bench", "pool %-12s live=%d peak=%d capacity=%d", pPool->Name(), pPool->Live(), pPool->Peak(), pPool->Capacity());
+
+	delete pServer;
+	delete pKernel;
+	delete pEngineMap;
+	delete pGameServer;
+	delete pConsole;
+	delete pStorage;
+	delete pConfig;
+
+	return Ret;
+}
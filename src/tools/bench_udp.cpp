@@ -0,0 +1,106 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+/*
+	Sends packets to itself over localhost and reports the packets per
+	second, once sending and receiving every packet on its own and once
+	in batches. Packets that don't come back are reported as lost.
+*/
+
+enum
+{
+	BATCH_SIZE = 64,
+	PACKET_SIZE = 128,
+};
+
+struct CLoopback
+{
+	NETSOCKET m_Socket;
+	NETADDR m_Addr;
+	NETDATAGRAM m_aDatagrams[BATCH_SIZE];
+	unsigned char m_aaData[BATCH_SIZE][PACKET_SIZE];
+};
+
+static double MeasureLoopback(CLoopback *pLoopback, bool Batched, int NumRounds, int *pReceived)
+{
+	*pReceived = 0;
+	int64 Start = time_get();
+	for(int Round = 0; Round < NumRounds; Round++)
+	{
+		if(Batched)
+			net_udp_send_batch(pLoopback->m_Socket, pLoopback->m_aDatagrams, BATCH_SIZE);
+		else
+		{
+			for(int i = 0; i < BATCH_SIZE; i++)
+				net_udp_send(pLoopback->m_Socket, &pLoopback->m_Addr, pLoopback->m_aaData[i], PACKET_SIZE);
+		}
+
+		while(1)
+		{
+			int Num;
+			if(Batched)
+				Num = net_udp_recv_batch(pLoopback->m_Socket, pLoopback->m_aDatagrams, BATCH_SIZE, PACKET_SIZE);
+			else
+			{
+				NETADDR Addr;
+				Num = net_udp_recv(pLoopback->m_Socket, &Addr, pLoopback->m_aaData[0], PACKET_SIZE) > 0 ? 1 : 0;
+			}
+			if(Num <= 0)
+				break;
+			*pReceived += Num;
+		}
+	}
+	double Seconds = (time_get()-Start)/(double)time_freq();
+	return Seconds > 0.0 ? *pReceived/Seconds : 0.0;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumRounds = 1000;
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-r") == 0 && i+1 < argc) // ignore_convention
+			NumRounds = max(str_toint(argv[++i]), 1); // ignore_convention
+	}
+
+	net_init();
+
+	static CLoopback s_Loopback;
+	mem_zero(&s_Loopback.m_Addr, sizeof(s_Loopback.m_Addr));
+	s_Loopback.m_Addr.type = NETTYPE_IPV4;
+	s_Loopback.m_Addr.ip[0] = 127;
+	s_Loopback.m_Addr.ip[3] = 1;
+	s_Loopback.m_Socket.type = NETTYPE_INVALID;
+	for(s_Loopback.m_Addr.port = 29400; s_Loopback.m_Addr.port < 29500; s_Loopback.m_Addr.port++)
+	{
+		s_Loopback.m_Socket = net_udp_create(s_Loopback.m_Addr, 0);
+		if(s_Loopback.m_Socket.type != NETTYPE_INVALID)
+			break;
+	}
+	if(s_Loopback.m_Socket.type == NETTYPE_INVALID)
+	{
+		dbg_msg("bench_udp", "couldn't bind a socket on localhost");
+		return -1;
+	}
+
+	for(int i = 0; i < BATCH_SIZE; i++)
+	{
+		s_Loopback.m_aDatagrams[i].addr = s_Loopback.m_Addr;
+		s_Loopback.m_aDatagrams[i].data = s_Loopback.m_aaData[i];
+		s_Loopback.m_aDatagrams[i].size = PACKET_SIZE;
+	}
+
+	int Sent = NumRounds*BATCH_SIZE;
+	int Single, Batched;
+	double SinglePps = MeasureLoopback(&s_Loopback, false, NumRounds, &Single);
+	double BatchedPps = MeasureLoopback(&s_Loopback, true, NumRounds, &Batched);
+	dbg_msg("bench_udp", "per packet: %d packets, %.0f packets/s, %d lost", Single, SinglePps, Sent-Single);
+	dbg_msg("bench_udp", "batched: %d packets, %.0f packets/s, %d lost", Batched, BatchedPps, Sent-Batched);
+
+	net_udp_close(s_Loopback.m_Socket);
+	return 0;
+}
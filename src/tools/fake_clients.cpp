@@ -0,0 +1,329 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/message.h>
+#include <engine/shared/network.h>
+#include <engine/shared/protocol.h>
+#include <game/version.h>
+#include <generated/protocol.h>
+
+/*
+	Connects a swarm of headless clients to a server, walks them through
+	the connection handshake and lets them send random input. Reports the
+	game tick rate and snapshot gaps the clients see, to soak servers
+	that run with a lot of client slots.
+
+	The server has to be started with sv_max_clients and
+	sv_max_clients_per_ip of at least the number of fake clients.
+*/
+
+enum
+{
+	STATE_CONNECTING=0,
+	STATE_LOADING,
+	STATE_INGAME,
+};
+
+struct CFakeClient
+{
+	CNetClient m_Net;
+	int m_State;
+
+	int m_FirstSnapTick;
+	int m_LastSnapTick;
+	int64 m_FirstSnapTime;
+	int64 m_LastSnapTime;
+	int64 m_MaxSnapGap;
+	int m_NumSnaps;
+};
+
+CFakeClient *pClients;
+int NumClients = 256;
+int Duration = 30;
+int MinTickRate = SERVER_TICK_SPEED*95/100;
+const char *pServerAddr = "127.0.0.1:8303";
+const char *pPassword = "";
+
+static void SendMsg(CFakeClient *pClient, CMsgPacker *pMsg, int Flags)
+{
+	CNetChunk Packet;
+	mem_zero(&Packet, sizeof(Packet));
+	Packet.m_ClientID = 0;
+	Packet.m_pData = pMsg->Data();
+	Packet.m_DataSize = pMsg->Size();
+	if(Flags&MSGFLAG_VITAL)
+		Packet.m_Flags |= NETSENDFLAG_VITAL;
+	if(Flags&MSGFLAG_FLUSH)
+		Packet.m_Flags |= NETSENDFLAG_FLUSH;
+	pClient->m_Net.Send(&Packet);
+}
+
+static void SendInfo(CFakeClient *pClient)
+{
+	CMsgPacker Msg(NETMSG_INFO, true);
+	Msg.AddString(GAME_NETVERSION, 128);
+	Msg.AddString(pPassword, 128);
+	Msg.AddInt(CLIENT_VERSION);
+	SendMsg(pClient, &Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+}
+
+static void SendStartInfo(CFakeClient *pClient, int Index)
+{
+	static const char *s_apSkinPartNames[6] = {"standard", "", "", "standard", "standard", "standard"};
+	char aName[MAX_NAME_LENGTH];
+	str_format(aName, sizeof(aName), "fake%d", Index);
+
+	CNetMsg_Cl_StartInfo StartInfo;
+	StartInfo.m_pName = aName;
+	StartInfo.m_pClan = "";
+	StartInfo.m_Country = -1;
+	for(int p = 0; p < 6; p++)
+	{
+		StartInfo.m_apSkinPartNames[p] = s_apSkinPartNames[p];
+		StartInfo.m_aUseCustomColors[p] = 0;
+		StartInfo.m_aSkinPartColors[p] = 0;
+	}
+
+	CMsgPacker Msg(StartInfo.MsgID());
+	StartInfo.Pack(&Msg);
+	SendMsg(pClient, &Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+}
+
+static void SendInput(CFakeClient *pClient)
+{
+	CNetObj_PlayerInput Input;
+	mem_zero(&Input, sizeof(Input));
+	Input.m_Direction = random_int()%3-1;
+	Input.m_TargetX = random_int()%200-100;
+	Input.m_TargetY = random_int()%200-100;
+	Input.m_Jump = (random_int()%16) == 0;
+	Input.m_Fire = (pClient->m_NumSnaps/8)&INPUT_STATE_MASK;
+	Input.m_Hook = (random_int()%4) == 0;
+
+	CMsgPacker Msg(NETMSG_INPUT, true);
+	Msg.AddInt(pClient->m_LastSnapTick);
+	Msg.AddInt(pClient->m_LastSnapTick+2);
+	Msg.AddInt(sizeof(Input));
+	const int *pData = (const int *)&Input;
+	for(unsigned i = 0; i < sizeof(Input)/sizeof(int); i++)
+		Msg.AddInt(pData[i]);
+	Msg.AddInt(0); // ping correction
+	SendMsg(pClient, &Msg, 0);
+}
+
+static void OnSnapshot(CFakeClient *pClient, int GameTick)
+{
+	int64 Now = time_get();
+	if(GameTick <= pClient->m_LastSnapTick)
+		return;
+
+	if(pClient->m_NumSnaps == 0)
+	{
+		pClient->m_FirstSnapTick = GameTick;
+		pClient->m_FirstSnapTime = Now;
+	}
+	else
+		pClient->m_MaxSnapGap = max(pClient->m_MaxSnapGap, Now-pClient->m_LastSnapTime);
+
+	pClient->m_LastSnapTick = GameTick;
+	pClient->m_LastSnapTime = Now;
+	pClient->m_NumSnaps++;
+
+	SendInput(pClient);
+}
+
+static void ProcessPacket(CFakeClient *pClient, int Index, CNetChunk *pPacket)
+{
+	CUnpacker Unpacker;
+	Unpacker.Reset(pPacket->m_pData, pPacket->m_DataSize);
+
+	int Msg = Unpacker.GetInt();
+	int Sys = Msg&1;
+	Msg >>= 1;
+	if(Unpacker.Error())
+		return;
+
+	if(Sys)
+	{
+		if(Msg == NETMSG_MAP_CHANGE)
+		{
+			// pretend the map is loaded already
+			CMsgPacker Ready(NETMSG_READY, true);
+			SendMsg(pClient, &Ready, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+		}
+		else if(Msg == NETMSG_CON_READY)
+			SendStartInfo(pClient, Index);
+		else if(Msg == NETMSG_SNAP || Msg == NETMSG_SNAPSINGLE || Msg == NETMSG_SNAPEMPTY)
+		{
+			int GameTick = Unpacker.GetInt();
+			if(!Unpacker.Error() && pClient->m_State == STATE_INGAME)
+				OnSnapshot(pClient, GameTick);
+		}
+	}
+	else if(Msg == NETMSGTYPE_SV_READYTOENTER && pClient->m_State == STATE_LOADING)
+	{
+		CMsgPacker EnterGame(NETMSG_ENTERGAME, true);
+		SendMsg(pClient, &EnterGame, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+		pClient->m_State = STATE_INGAME;
+	}
+}
+
+static int Run()
+{
+	NETADDR ServerAddr;
+	if(net_addr_from_str(&ServerAddr, pServerAddr) != 0)
+	{
+		dbg_msg("fake_clients", "invalid server address '%s'", pServerAddr);
+		return -1;
+	}
+
+	NETADDR BindAddr;
+	mem_zero(&BindAddr, sizeof(BindAddr));
+	BindAddr.type = ServerAddr.type;
+
+	pClients = new CFakeClient[NumClients];
+	for(int i = 0; i < NumClients; i++)
+	{
+		CFakeClient *pClient = &pClients[i];
+		if(!pClient->m_Net.Open(BindAddr, 0))
+		{
+			dbg_msg("fake_clients", "could not open socket for client %d", i);
+			return -1;
+		}
+		pClient->m_State = STATE_CONNECTING;
+		pClient->m_FirstSnapTick = 0;
+		pClient->m_LastSnapTick = 0;
+		pClient->m_FirstSnapTime = 0;
+		pClient->m_LastSnapTime = 0;
+		pClient->m_MaxSnapGap = 0;
+		pClient->m_NumSnaps = 0;
+		pClient->m_Net.Connect(&ServerAddr);
+	}
+
+	int64 StartTime = time_get();
+	int64 EndTime = StartTime+time_freq()*Duration;
+	int64 NextReport = StartTime+time_freq();
+	while(time_get() < EndTime)
+	{
+		for(int i = 0; i < NumClients; i++)
+		{
+			CFakeClient *pClient = &pClients[i];
+			pClient->m_Net.Update();
+
+			if(pClient->m_State == STATE_CONNECTING && pClient->m_Net.State() == NETSTATE_ONLINE)
+			{
+				SendInfo(pClient);
+				pClient->m_State = STATE_LOADING;
+			}
+
+			CNetChunk Packet;
+			while(pClient->m_Net.Recv(&Packet))
+			{
+				if(!(Packet.m_Flags&NETSENDFLAG_CONNLESS))
+					ProcessPacket(pClient, i, &Packet);
+			}
+		}
+
+		if(time_get() > NextReport)
+		{
+			int NumIngame = 0;
+			for(int i = 0; i < NumClients; i++)
+				if(pClients[i].m_State == STATE_INGAME)
+					NumIngame++;
+			dbg_msg("fake_clients", "%d/%d clients ingame", NumIngame, NumClients);
+			NextReport += time_freq();
+		}
+
+		thread_sleep(1);
+	}
+
+	// the game tick advances at the server's tick rate as long as it keeps up
+	int NumMeasured = 0;
+	int NumSlow = 0;
+	float MinRate = 0.0f;
+	float SumRate = 0.0f;
+	int64 MaxGap = 0;
+	for(int i = 0; i < NumClients; i++)
+	{
+		CFakeClient *pClient = &pClients[i];
+		if(pClient->m_NumSnaps < 2 || pClient->m_LastSnapTime == pClient->m_FirstSnapTime)
+			continue;
+
+		float Rate = (pClient->m_LastSnapTick-pClient->m_FirstSnapTick)*(float)time_freq()/(pClient->m_LastSnapTime-pClient->m_FirstSnapTime);
+		if(NumMeasured == 0 || Rate < MinRate)
+			MinRate = Rate;
+		SumRate += Rate;
+		MaxGap = max(MaxGap, pClient->m_MaxSnapGap);
+		if(Rate < MinTickRate)
+			NumSlow++;
+		NumMeasured++;
+	}
+
+	for(int i = 0; i < NumClients; i++)
+		pClients[i].m_Net.Disconnect("soak done");
+	delete[] pClients;
+
+	if(NumMeasured == 0)
+	{
+		dbg_msg("fake_clients", "no client received snapshots");
+		return -1;
+	}
+
+	dbg_msg("fake_clients", "%d/%d clients received snapshots, tick rate avg=%.2f min=%.2f, max snapshot gap=%dms",
+		NumMeasured, NumClients, SumRate/NumMeasured, MinRate, (int)(MaxGap*1000/time_freq()));
+	if(NumMeasured < NumClients || NumSlow)
+	{
+		dbg_msg("fake_clients", "tick out of budget for %d clients, %d never got ingame", NumSlow, NumClients-NumMeasured);
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	dbg_logger_stdout();
+
+	argc--; argv++;
+	while(argc)
+	{
+		if(str_comp(*argv, "-n") == 0 && argc > 1)
+		{
+			argc--; argv++;
+			NumClients = clamp(str_toint(*argv), 1, 4096);
+		}
+		else if(str_comp(*argv, "-d") == 0 && argc > 1)
+		{
+			argc--; argv++;
+			Duration = max(str_toint(*argv), 1);
+		}
+		else if(str_comp(*argv, "-r") == 0 && argc > 1)
+		{
+			argc--; argv++;
+			MinTickRate = str_toint(*argv);
+		}
+		else if(str_comp(*argv, "-s") == 0 && argc > 1)
+		{
+			argc--; argv++;
+			pServerAddr = *argv;
+		}
+		else if(str_comp(*argv, "-p") == 0 && argc > 1)
+		{
+			argc--; argv++;
+			pPassword = *argv;
+		}
+
+		argc--; argv++;
+	}
+
+	if(secure_random_init() != 0)
+	{
+		dbg_msg("fake_clients", "could not initialize secure RNG");
+		return -1;
+	}
+
+	net_init();
+	CNetBase::Init();
+	int RunReturn = Run();
+	return RunReturn == 0 ? 0 : 1;
+}